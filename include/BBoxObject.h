@@ -52,6 +52,13 @@ public:
     bool is_sphere_collide(TransformObject* self_transform_object,
                            glm::vec3        other_abs_point,
                            float            other_sphere_radius);
+    bool is_segment_intersect(TransformObject* self_transform_object,
+                              glm::vec3        p1,
+                              glm::vec3        p2);
+    bool is_capsule_collide(TransformObject* self_transform_object,
+                            glm::vec3        p1,
+                            glm::vec3        p2,
+                            float            radius);
     bool is_ray_intersect(TransformObject* self_transform_object,
                           glm::vec3        ray_origin,
                           glm::vec3        ray_dir,
@@ -0,0 +1,103 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_BVH_H_
+#define VT_BVH_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#define BVH_LEAF_SIZE  4
+#define BVH_STACK_SIZE 64 // median splits keep depth at log2(box count / leaf size)
+
+namespace vt {
+
+// bounding volume hierarchy over oriented boxes
+// NOTE: boxes are snapshots -- rebuild whenever a box moves
+class BVH
+{
+public:
+    BVH();
+    virtual ~BVH();
+    void clear();
+    int add(const glm::mat4 &transform,
+            const glm::mat4 &inverse_transform,
+            glm::vec3        min,
+            glm::vec3        max);
+    void build();
+    size_t size() const { return m_boxes.size(); }
+
+    // ray bundles share an origin -- a node is skipped only when every ray in the bundle misses it
+    // NOTE: nearest_distances are in/out -- seed with BIG_NUMBER or a known nearer hit
+    void cast_ray_bundle(glm::vec3        ray_origin,
+                         const glm::vec3* ray_dirs,
+                         int              bundle_size,
+                         float*           nearest_distances) const;
+    void cast_ray_bundles(const glm::vec3* ray_origins,
+                          const glm::vec3* ray_dirs,
+                          int              bundle_size,
+                          float*           nearest_distances,
+                          size_t           bundle_count) const;
+
+    // continuous collision -- first contact of a sphere swept from p1 to p2 (radius 0 sweeps a segment)
+    // hit_t is the free fraction of the move (1 when nothing is hit), hit_normal is 0 when nothing is hit
+    // NOTE: boxes are inflated by the radius (conservative at edges and corners),
+    //       a sphere starting inside a box never hits that box, so it can still leave
+    bool sweep_sphere(glm::vec3  p1,
+                      glm::vec3  p2,
+                      float      radius,
+                      float*     hit_t,
+                      glm::vec3* hit_normal) const;
+    int sweep_spheres(const glm::vec3* p1s,
+                      const glm::vec3* p2s,
+                      float            radius,
+                      float*           hit_ts,
+                      glm::vec3*       hit_normals,
+                      size_t           count) const;
+
+private:
+    struct box_t
+    {
+        glm::mat4 m_inverse_transform;
+        glm::vec3 m_min;       // box-local
+        glm::vec3 m_max;       // box-local
+        glm::vec3 m_inv_scale; // world length to box-local length, per box axis
+        glm::vec3 m_world_min; // enclosing world-space aabb
+        glm::vec3 m_world_max;
+    };
+
+    struct node_t
+    {
+        glm::vec3 m_min;
+        glm::vec3 m_max;
+        int       m_first;       // into m_box_indices (leaf only)
+        int       m_count;       // 0 for inner nodes
+        int       m_child_index; // right child is m_child_index + 1 (inner only)
+    };
+
+    std::vector<box_t>     m_boxes;
+    std::vector<glm::vec3> m_box_centers; // world-space aabb centers -- split keys
+    std::vector<int>       m_box_indices;
+    std::vector<node_t>    m_nodes;
+
+    void build_hier(int node_index, int first, int count);
+};
+
+}
+
+#endif
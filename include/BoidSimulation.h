@@ -0,0 +1,143 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_BOID_SIMULATION_H_
+#define VT_BOID_SIMULATION_H_
+
+#include <Simulation.h>
+#include <BoidStore.h>
+#include <BBoxObject.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <tuple>
+
+#define BOID_COLLISION_SKIN 0.001f // gap left between an agent and the face it was stopped at
+
+namespace vt {
+
+class TransformObject;
+class Octree;
+class BVH;
+
+// flocking with lidar obstacle avoidance
+class BoidSimulation : public Simulation
+{
+public:
+    enum lidar_index_t {
+        LIDAR_INDEX_FORWARD,
+        LIDAR_INDEX_UP,
+        LIDAR_INDEX_LEFT,
+        LIDAR_INDEX_RIGHT,
+        LIDAR_INDEX_COUNT
+    };
+
+    BoidSimulation(glm::vec3         bounds_origin,
+                   glm::vec3         bounds_dim,
+                   const BoidParams &params   = BoidParams(),
+                   float             fixed_dt = SIMULATION_TICK_DT);
+    virtual ~BoidSimulation();
+
+    // agents
+    int add_agent(glm::vec3 origin, glm::vec3 euler, float speed);
+    void randomize_agents(glm::vec3 scatter_min, glm::vec3 scatter_max);
+    void clear_agents();
+    size_t get_agent_count() const                  { return m_store.size(); }
+    glm::vec3 get_agent_origin(int index) const     { return m_store.get_origin(index); }
+    glm::quat get_agent_orientation(int index) const { return m_store.get_orientation(index); }
+    float get_agent_speed(int index) const          { return m_store.get_speed(index); }
+    BoidStore::boid_behavior_t get_agent_behavior(int index) const { return m_store.get_behavior(index); }
+    const BoidStore &get_store() const              { return m_store; }
+
+    // obstacles (bounds are always an obstacle)
+    int add_obstacle(glm::vec3 origin, glm::vec3 euler, glm::vec3 min, glm::vec3 max);
+    void clear_obstacles();
+    size_t get_obstacle_count() const { return m_obstacles.size(); }
+
+    // environment
+    const BBoxObject &get_bounds() const  { return m_bounds; }
+    Octree* get_octree() const            { return m_octree; }
+    glm::vec3 get_target() const          { return m_target; }
+    void set_target(glm::vec3 target)     { m_target = target; }
+    const BoidParams &get_params() const  { return m_params; }
+    void set_params(const BoidParams &params) { m_params = params; }
+
+    // statistics (from the last step)
+    int get_behavior_count(BoidStore::boid_behavior_t behavior) const { return m_behavior_counts[behavior]; }
+    float get_polarization() const { return m_polarization; } // length of mean heading -- 1 when all agents agree
+    int get_collision_count() const { return m_collision_count; } // moves cut short by an obstacle
+
+    // guide wires (for debug) -- lidar readings and flocking neighbors from the last step
+    void get_agent_debug_lines(int                                                              index,
+                               std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3, float>>* debug_lines) const;
+
+protected:
+    void update(float dt);
+    void run_pass(int pass, int chunk_index, size_t begin, size_t end, ScratchArena* scratch_arena);
+
+private:
+    enum pass_t {
+        PASS_WRAP,
+        PASS_FIND_NEIGHBORS,
+        PASS_AVOID_OBSTACLES,
+        PASS_FLOCK,
+        PASS_STEER,
+        PASS_COUNT
+    };
+
+    BoidParams                    m_params;
+    BBoxObject                    m_bounds;
+    TransformObject*              m_bounds_object;
+    Octree*                       m_octree;
+    glm::vec3                     m_target;
+    BoidStore                     m_store;
+    std::vector<TransformObject*> m_obstacles;
+    std::vector<BBoxObject>       m_obstacle_bboxes;
+    BVH*                          m_obstacle_bvh; // obstacle snapshot for the current step
+    glm::mat4                     m_bounds_inverse_transform;
+
+    // statistics
+    int   m_behavior_counts[BoidStore::BOID_BEHAVIOR_COUNT];
+    float m_polarization;
+    int   m_collision_count;
+
+    // per-step scratch
+    float                  m_tick_scale;
+    std::vector<long>      m_neighbors; // m_params.m_nearest_neighbor_count per agent
+    std::vector<int>       m_neighbor_counts;
+    glm::vec3              m_local_lidar_dirs[LIDAR_INDEX_COUNT];
+    std::vector<glm::vec3> m_lidar_origins;
+    std::vector<glm::vec3> m_lidar_dirs;      // LIDAR_INDEX_COUNT per agent
+    std::vector<float>     m_lidar_distances; // LIDAR_INDEX_COUNT per agent
+    std::vector<int>       m_chunk_behavior_counts; // BOID_BEHAVIOR_COUNT per chunk
+    std::vector<glm::vec3> m_chunk_heading_sums;
+    std::vector<int>       m_chunk_collision_counts;
+
+    glm::vec3 get_local_lidar_dir(lidar_index_t lidar_index) const;
+    void update_octree();
+    void snapshot_obstacles();
+    void find_neighbors(size_t begin, size_t end, ScratchArena* scratch_arena);
+    void cast_lidar(size_t begin, size_t end);
+    void avoid_obstacles(size_t begin, size_t end);
+    int collide_obstacles(size_t begin, size_t end, ScratchArena* scratch_arena);
+    void reduce_statistics();
+};
+
+}
+
+#endif
@@ -0,0 +1,138 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_BOID_STORE_H_
+#define VT_BOID_STORE_H_
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vt {
+
+// speeds and angle deltas are per tick (SIMULATION_TICK_DT) and scale with dt
+struct BoidParams
+{
+    float m_avoid_radius;
+    float m_flocking_radius;
+    float m_nearest_neighbor_radius;
+    int   m_nearest_neighbor_count;
+    float m_obstacle_avoid_radius;
+    float m_obstacle_reverse_radius;
+    float m_angle_delta;
+    float m_avoid_angle_delta;
+    float m_cohesion_to_alignment_ratio;
+    float m_max_heading_deviation;
+    float m_max_fov_deviation;
+    float m_forward_speed_min;
+    float m_forward_speed_max;
+    float m_lidar_fov;
+    float m_collision_radius; // swept against obstacles every step -- 0 sweeps the agent's center only
+
+    BoidParams();
+};
+
+// boid state as structure-of-arrays -- one float plane per component
+// kernels are plain loops over [begin, end) so the compiler can vectorize them across agents
+class BoidStore
+{
+public:
+    enum boid_behavior_t {
+        BOID_BEHAVIOR_NONE,
+        BOID_BEHAVIOR_WANDER,
+        BOID_BEHAVIOR_HOMING,
+        BOID_BEHAVIOR_FLOCKING,
+        BOID_BEHAVIOR_SEPARATION,
+        BOID_BEHAVIOR_AVOID_OBSTACLE,
+        BOID_BEHAVIOR_REVERSE,
+        BOID_BEHAVIOR_COUNT
+    };
+
+    BoidStore();
+    virtual ~BoidStore();
+
+    // agents
+    int add(glm::vec3 origin, glm::quat orientation, float speed);
+    void clear();
+    size_t size() const { return m_origin_x.size(); }
+    glm::vec3 get_origin(int index) const;
+    void set_origin(int index, glm::vec3 origin);
+    glm::vec3 get_heading(int index) const;
+    glm::vec3 get_up_direction(int index) const;
+    glm::vec3 get_left_direction(int index) const;
+    glm::quat get_orientation(int index) const;
+    void set_orientation(int index, glm::quat orientation);
+    float get_speed(int index) const                  { return m_speeds[index]; }
+    void set_speed(int index, float speed)            { m_speeds[index] = speed; }
+    boid_behavior_t get_behavior(int index) const     { return static_cast<boid_behavior_t>(m_behaviors[index]); }
+
+    // steering (consumed by steer)
+    // turn_sin < 0 steers away from target, turn_cos/turn_sin of 1/0 holds course
+    void set_steering(int             index,
+                      boid_behavior_t behavior,
+                      glm::vec3       target,
+                      float           turn_cos,
+                      float           turn_sin);
+    void reverse(int index); // head-on -- turn 180 degrees maintaining up direction, hold position this step (applied by steer)
+
+    // kernels
+    void wrap(glm::vec3 min, glm::vec3 max, size_t begin, size_t end);
+    void clear_steering(size_t begin, size_t end);
+    void flock(const long*       neighbors,       // neighbor_stride entries per agent, nearest first
+               const int*        neighbor_counts,
+               int               neighbor_stride,
+               const BoidParams &params,
+               glm::vec3         target,
+               float             tick_scale,
+               size_t            begin,
+               size_t            end);
+    void steer(size_t begin, size_t end);
+    void advance(float tick_scale, size_t begin, size_t end);
+
+    // statistics
+    glm::vec3 sum_headings(size_t begin, size_t end) const;
+    void count_behaviors(int* behavior_counts, size_t begin, size_t end) const; // BOID_BEHAVIOR_COUNT entries
+
+    // flocking neighbor filter (for debug)
+    bool is_flocking_neighbor(int index, int other_index, const BoidParams &params) const;
+
+private:
+    // state
+    std::vector<float> m_origin_x;
+    std::vector<float> m_origin_y;
+    std::vector<float> m_origin_z;
+    std::vector<float> m_heading_x;
+    std::vector<float> m_heading_y;
+    std::vector<float> m_heading_z;
+    std::vector<float> m_up_x;
+    std::vector<float> m_up_y;
+    std::vector<float> m_up_z;
+    std::vector<float> m_speeds;
+
+    // steering
+    std::vector<float> m_target_x;
+    std::vector<float> m_target_y;
+    std::vector<float> m_target_z;
+    std::vector<float> m_turn_cos;
+    std::vector<float> m_turn_sin;
+    std::vector<int>   m_behaviors;
+};
+
+}
+
+#endif
@@ -30,6 +30,7 @@ public:
     Buffer(GLenum target, size_t size, void* data);
     virtual ~Buffer();
     void update();
+    void update(size_t size, void* data); // re-point and stream -- size may change between calls
     void bind();
     size_t size() const
     {
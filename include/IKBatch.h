@@ -0,0 +1,99 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VT_IK_BATCH_H_
+#define VT_IK_BATCH_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#define IK_BATCH_LANES 8 // instances solved side by side -- one AVX register, or two SSE registers
+
+namespace vt {
+
+class KinematicChain;
+
+// N instances of one chain layout solved against N targets (damped least squares, position only)
+// instance data is stored structure-of-arrays so each kernel loop runs across IK_BATCH_LANES instances
+class IKBatch
+{
+public:
+    IKBatch(const KinematicChain &layout);
+    virtual ~IKBatch();
+
+    // instances
+    void resize(size_t count); // new instances start at the layout's pose
+    void reset_values();       // all instances back to the layout's pose
+    void set_base_transform(glm::mat4 base_transform);
+    size_t size() const      { return m_count; }
+    int get_joint_count() const { return m_joint_count; }
+    void set_target(int index, glm::vec3 target);
+    glm::vec3 get_target(int index) const;
+    float get_value(int index, int joint_index) const; // degrees for revolute, units for prismatic
+    void set_value(int index, int joint_index, float value);
+    float get_residual(int index) const { return m_residuals[index]; }
+    bool is_converged(int index) const  { return m_is_converged[index]; }
+
+    // batched solve
+    // NOTE: disjoint ranges may be solved on different threads if they are aligned to IK_BATCH_LANES
+    void solve(int iters, float accept_end_effector_distance, float damping = 0.1f);
+    void solve_range(size_t begin,
+                     size_t end,
+                     int    iters,
+                     float  accept_end_effector_distance,
+                     float  damping = 0.1f);
+
+private:
+    // layout (shared by all instances, revolute limits in radians)
+    int                    m_joint_count;
+    std::vector<int>       m_types;
+    std::vector<glm::vec3> m_offsets;
+    std::vector<glm::vec3> m_axes;
+    std::vector<glm::mat3> m_pre_rotations;
+    std::vector<glm::mat3> m_post_rotations;
+    std::vector<char>      m_enable_limits;
+    std::vector<float>     m_min_values;
+    std::vector<float>     m_max_values;
+    glm::mat3              m_base_rotation;
+    glm::vec3              m_base_origin;
+    glm::vec3              m_local_end_effector_tip;
+    std::vector<float>     m_rest_values;
+
+    // instances (structure-of-arrays, padded to a multiple of IK_BATCH_LANES)
+    size_t             m_count;
+    size_t             m_stride;
+    std::vector<float> m_target_x;
+    std::vector<float> m_target_y;
+    std::vector<float> m_target_z;
+    std::vector<float> m_values; // joint-major -- m_values[joint_index * m_stride + index], radians for revolute
+    std::vector<float> m_residuals;
+    std::vector<char>  m_is_converged;
+
+    void forward_block(const float* values,
+                       float*       abs_origins,
+                       float*       abs_axes,
+                       float*       end_effector_tip) const;
+    void solve_block(size_t first,
+                     int    iters,
+                     float  accept_end_effector_distance,
+                     float  damping,
+                     float* scratch);
+};
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VT_IK_SCHEDULER_H_
+#define VT_IK_SCHEDULER_H_
+
+#include <TransformObject.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vt {
+
+class ThreadPool;
+
+struct IKChain
+{
+    TransformObject*           m_end_effector;
+    TransformObject*           m_root;
+    TransformObject::ik_type_t m_ik_type;
+    glm::vec3                  m_local_end_effector_tip;
+    glm::vec3                  m_target;
+    glm::vec3                  m_end_effector_dir;
+    bool                       m_use_end_effector_dir;
+    int                        m_iters;
+    float                      m_accept_end_effector_distance;
+    float                      m_accept_avg_angle_distance;
+    bool                       m_result;
+
+    IKChain();
+};
+
+// solves independent ik chains concurrently on a ThreadPool -- one chunk per group
+// NOTE: chains that share a segment (or whose root hangs off another chain's segment)
+//       are grouped and solved serially in the order they were added, so results match
+//       a serial solve regardless of thread count
+class IKScheduler
+{
+public:
+    IKScheduler(int thread_count = 0); // 0 -- one worker per hardware thread
+    virtual ~IKScheduler();
+
+    // chains
+    int add_chain(TransformObject*           end_effector,
+                  TransformObject::ik_type_t ik_type,
+                  TransformObject*           root,
+                  glm::vec3                  local_end_effector_tip,
+                  glm::vec3                  target,
+                  glm::vec3*                 end_effector_dir,
+                  int                        iters,
+                  float                      accept_end_effector_distance,
+                  float                      accept_avg_angle_distance);
+    void clear();
+    size_t size() const                     { return m_chains.size(); }
+    const IKChain &get_chain(int index) const { return m_chains[index]; }
+    bool get_result(int index) const        { return m_chains[index].m_result; }
+
+    // batched solve
+    void solve();
+    int get_thread_count() const;
+
+private:
+    class GroupTask;
+
+    std::vector<IKChain>          m_chains;
+    std::vector<std::vector<int>> m_groups; // chain indices, each group solved serially
+    ThreadPool*                   m_thread_pool;
+
+    void snapshot();
+    void build_groups();
+    void solve_group(int group_index);
+};
+
+}
+
+#endif
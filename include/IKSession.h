@@ -0,0 +1,88 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VT_IK_SESSION_H_
+#define VT_IK_SESSION_H_
+
+#include <TransformObject.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+
+namespace vt {
+
+// what a session remembers about one chain between frames
+struct IKSessionState
+{
+    glm::vec3              m_target;
+    glm::vec3              m_end_effector_tip;
+    glm::vec3              m_end_effector_dir;
+    bool                   m_use_end_effector_dir;
+    std::vector<glm::vec3> m_origins;           // last solved pose (end effector first)
+    std::vector<glm::quat> m_orientations;
+    std::vector<glm::vec3> m_prev_origins;      // pose solved the frame before
+    std::vector<glm::quat> m_prev_orientations;
+    bool                   m_has_prev_pose;
+    int                    m_iters;
+    float                  m_residual;
+    bool                   m_is_solved;
+
+    IKSessionState();
+};
+
+// per-frame ik with temporal coherence
+// -- skips the solve when neither target nor chain moved since a solve that converged
+// -- warm-starts from the last pose extrapolated by the last frame's joint velocities
+// -- grows the iteration budget while unsolved, shrinks it back while solved
+class IKSession
+{
+public:
+    IKSession(int   min_iters      = 1,
+              int   max_iters      = 20,
+              float skip_distance  = EPSILON,
+              float extrapolation  = 1);
+    virtual ~IKSession();
+
+    bool solve(TransformObject*           end_effector,
+               TransformObject::ik_type_t ik_type,
+               TransformObject*           root,
+               glm::vec3                  local_end_effector_tip,
+               glm::vec3                  target,
+               glm::vec3*                 end_effector_dir,
+               float                      accept_end_effector_distance,
+               float                      accept_avg_angle_distance);
+    void forget(TransformObject* end_effector);
+    void clear();
+
+    // telemetry (for debug)
+    unsigned long get_solve_count() const { return m_solve_count; }
+    unsigned long get_skip_count() const  { return m_skip_count; }
+
+private:
+    std::map<TransformObject*, IKSessionState> m_states;
+    int                                        m_min_iters;
+    int                                        m_max_iters;
+    float                                      m_skip_distance;
+    float                                      m_extrapolation;
+    unsigned long                              m_solve_count;
+    unsigned long                              m_skip_count;
+};
+
+}
+
+#endif
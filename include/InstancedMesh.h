@@ -0,0 +1,68 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_INSTANCED_MESH_H_
+#define VT_INSTANCED_MESH_H_
+
+#include <Mesh.h>
+#include <MeshBase.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace vt {
+
+class Buffer;
+
+// one geometry and material drawn for every instance in a single draw call
+// NOTE: the mesh's own transform applies to all instances, each instance adds its own on top --
+//       per-instance state is a matrix (plus a color), streamed to the gpu once per frame
+class InstancedMesh : public Mesh
+{
+public:
+    InstancedMesh(const std::string& name,
+                  const MeshBase*    geometry, // copied -- source can be discarded
+                  size_t             instance_count = 0);
+    virtual ~InstancedMesh();
+
+    // instances
+    void resize_instances(size_t instance_count);
+    size_t get_instance_count() const                        { return m_instance_transforms.size(); }
+    const glm::mat4 &get_instance_transform(int index) const { return m_instance_transforms[index]; }
+    void set_instance_transform(int index, glm::mat4 transform);
+    void set_instance_transform(int index, glm::vec3 origin, glm::quat orientation);
+    glm::vec3 get_instance_color(int index) const            { return m_instance_colors[index]; }
+    void set_instance_color(int index, glm::vec3 color);
+
+    // instancing
+    Buffer* get_vbo_instance_transforms();
+    Buffer* get_vbo_instance_colors();
+    void update_instance_buffers(); // no-op unless instances changed since last call
+
+private:
+    std::vector<glm::mat4> m_instance_transforms;
+    std::vector<glm::vec3> m_instance_colors;
+    Buffer*                m_vbo_instance_transforms;
+    Buffer*                m_vbo_instance_colors;
+    bool                   m_is_dirty_instances;
+};
+
+}
+
+#endif
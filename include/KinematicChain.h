@@ -0,0 +1,127 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VT_KINEMATIC_CHAIN_H_
+#define VT_KINEMATIC_CHAIN_H_
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vt {
+
+class TransformObject;
+
+// headless serial chain -- one degree of freedom per joint, stored as flat arrays
+// joint i local transform: translate(offset) * pre * (rotate or slide along axis by value) * post
+// NOTE: ignores scale
+class KinematicChain
+{
+public:
+    enum joint_type_t {
+        JOINT_TYPE_REVOLUTE,  // value in degrees
+        JOINT_TYPE_PRISMATIC, // value in units
+        JOINT_TYPE_FIXED
+    };
+
+    KinematicChain();
+    virtual ~KinematicChain();
+
+    // construction
+    int add_joint(joint_type_t type,
+                  glm::vec3    offset,
+                  glm::vec3    axis,
+                  float        value            = 0,
+                  glm::quat    pre_orientation  = glm::quat(1, 0, 0, 0),
+                  glm::quat    post_orientation = glm::quat(1, 0, 0, 0));
+    void set_limits(int index, float min_value, float max_value);
+    bool build_from(TransformObject* root,
+                    TransformObject* end_effector,
+                    glm::vec3        local_end_effector_tip);
+    void clear();
+    size_t size() const { return m_types.size(); }
+
+    // basic features
+    const glm::mat4 &get_base_transform() const                    { return m_base_transform; }
+    const glm::vec3 &get_local_end_effector_tip() const            { return m_local_end_effector_tip; }
+    void set_base_transform(glm::mat4 base_transform)              { m_base_transform = base_transform; }
+    void set_local_end_effector_tip(glm::vec3 local_end_effector_tip) { m_local_end_effector_tip = local_end_effector_tip; }
+    joint_type_t get_joint_type(int index) const                   { return m_types[index]; }
+    const glm::vec3 &get_offset(int index) const                   { return m_offsets[index]; }
+    const glm::vec3 &get_axis(int index) const                     { return m_axes[index]; }
+    const glm::quat &get_pre_orientation(int index) const          { return m_pre_orientations[index]; }
+    const glm::quat &get_post_orientation(int index) const         { return m_post_orientations[index]; }
+    bool has_limits(int index) const                               { return m_enable_limits[index]; }
+    float get_min_value(int index) const                           { return m_min_values[index]; }
+    float get_max_value(int index) const                           { return m_max_values[index]; }
+    float get_value(int index) const                               { return m_values[index]; }
+    const std::vector<float> &get_values() const                   { return m_values; }
+    void set_value(int index, float value);
+    void set_values(const std::vector<float> &values);
+
+    // forward kinematics
+    void update();
+    const glm::mat4 &get_world_transform(int index) const { return m_world_transforms[index]; }
+    const glm::vec3 &get_end_effector_tip() const         { return m_end_effector_tip; }
+
+    // solvers
+    bool solve_ccd(glm::vec3 target,
+                   int       iters,
+                   float     accept_end_effector_distance);
+    bool solve_jacobian(glm::vec3 target,
+                        int       iters,
+                        float     accept_end_effector_distance,
+                        float     damping = 0.1f);
+    int get_iters() const      { return m_iters; }
+    float get_residual() const { return m_residual; }
+
+    // binding
+    void bind(int index, TransformObject* node) { m_bindings[index] = node; }
+    TransformObject* get_binding(int index) const { return m_bindings[index]; }
+    void apply_bindings() const;
+
+private:
+    // joints
+    std::vector<joint_type_t>     m_types;
+    std::vector<glm::vec3>        m_offsets;
+    std::vector<glm::vec3>        m_axes;
+    std::vector<glm::quat>        m_pre_orientations;
+    std::vector<glm::quat>        m_post_orientations;
+    std::vector<char>             m_enable_limits;
+    std::vector<float>            m_min_values;
+    std::vector<float>            m_max_values;
+    std::vector<float>            m_values;
+    std::vector<TransformObject*> m_bindings;
+
+    // forward kinematics (valid after update)
+    std::vector<glm::mat4> m_world_transforms; // frame after joint i
+    std::vector<glm::vec3> m_abs_origins;      // joint i pivot
+    std::vector<glm::vec3> m_abs_axes;         // joint i axis
+    glm::mat4              m_base_transform;
+    glm::vec3              m_local_end_effector_tip;
+    glm::vec3              m_end_effector_tip;
+
+    // telemetry
+    int   m_iters;
+    float m_residual;
+
+    float clamp_value(int index, float value) const;
+};
+
+}
+
+#endif
@@ -102,6 +102,19 @@ public:
     Buffer* get_vbo_tex_coords();
     Buffer* get_ibo_tri_indices();
 
+    // instancing (see InstancedMesh)
+    virtual Buffer* get_vbo_instance_transforms()
+    {
+        return NULL;
+    }
+    virtual Buffer* get_vbo_instance_colors()
+    {
+        return NULL;
+    }
+    virtual void update_instance_buffers()
+    {
+    }
+
     void set_material(Material* material);
     Material* get_material() const
     {
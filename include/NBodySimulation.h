@@ -0,0 +1,114 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_NBODY_SIMULATION_H_
+#define VT_NBODY_SIMULATION_H_
+
+#include <Simulation.h>
+#include <BBoxObject.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vt {
+
+class Octree;
+
+enum gravity_model_t {
+    GRAVITY_MODEL_NEAREST_NEIGHBORS, // pull toward the centroid of the k nearest neighbors
+    GRAVITY_MODEL_BARNES_HUT,        // all bodies, far groups approximated by their octree node's center of mass
+    GRAVITY_MODEL_COUNT
+};
+
+// speeds are per tick (SIMULATION_TICK_DT) and scale with dt
+struct NBodyParams
+{
+    gravity_model_t m_gravity_model;
+    float           m_nearest_neighbor_radius;
+    int             m_nearest_neighbor_count;
+    float           m_forward_speed_max;
+    float           m_gravitational_constant;
+    float           m_theta;     // barnes-hut opening angle -- 0 is exact, larger is faster
+    float           m_softening; // keeps close encounters finite
+
+    NBodyParams();
+};
+
+class NBodySimulation : public Simulation
+{
+public:
+    NBodySimulation(glm::vec3          bounds_origin,
+                    glm::vec3          bounds_dim,
+                    const NBodyParams &params   = NBodyParams(),
+                    float              fixed_dt = SIMULATION_TICK_DT);
+    virtual ~NBodySimulation();
+
+    // agents
+    int add_agent(glm::vec3 origin, glm::vec3 velocity, float mass = 1);
+    void randomize_agents(glm::vec3 scatter_min, glm::vec3 scatter_max);
+    void clear_agents();
+    size_t get_agent_count() const                  { return m_origins.size(); }
+    glm::vec3 get_agent_origin(int index) const     { return m_origins[index]; }
+    glm::quat get_agent_orientation(int index) const;
+    glm::vec3 get_agent_velocity(int index) const   { return m_velocities[index]; }
+    float get_agent_mass(int index) const           { return m_masses[index]; }
+    int find_neighbors(int index, std::vector<long>* nearest_k_indices) const;
+
+    // statistics (from the last step)
+    float get_kinetic_energy() const { return m_kinetic_energy; }
+
+    // environment
+    const BBoxObject &get_bounds() const   { return m_bounds; }
+    Octree* get_octree() const             { return m_octree; }
+    const NBodyParams &get_params() const  { return m_params; }
+    void set_params(const NBodyParams &params) { m_params = params; }
+
+protected:
+    void update(float dt);
+    void run_pass(int pass, int chunk_index, size_t begin, size_t end, ScratchArena* scratch_arena);
+
+private:
+    enum pass_t {
+        PASS_INTEGRATE,
+        PASS_COUNT
+    };
+
+    NBodyParams            m_params;
+    BBoxObject             m_bounds;
+    Octree*                m_octree;
+    std::vector<glm::vec3> m_origins;
+    std::vector<glm::vec3> m_velocities;
+    std::vector<float>     m_masses;
+
+    // statistics
+    float m_kinetic_energy;
+
+    // per-step scratch
+    float                  m_tick_scale;
+    std::vector<glm::vec3> m_next_origins;
+    std::vector<glm::vec3> m_next_velocities;
+    std::vector<float>     m_chunk_kinetic_energies;
+
+    void update_octree();
+    glm::vec3 get_nearest_neighbors_acceleration(int index, long* nearest_k_ids, float* nearest_k_dists) const;
+    glm::vec3 get_barnes_hut_acceleration(int index) const;
+};
+
+}
+
+#endif
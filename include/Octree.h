@@ -20,21 +20,12 @@
 
 #include <glm/glm.hpp>
 #include <Util.h>
-#include <queue>
-#include <map>
+#include <vector>
 #include <set>
 
-namespace vt {
-
-typedef std::pair<long, float> id_dist_t;
+#define OCTREE_FIND_STACK_SIZE 64 // k up to this needs no heap scratch
 
-struct id_dist_less_than_t
-{
-    bool operator()(const id_dist_t& a, const id_dist_t& b) const
-    {
-        return a.second < b.second;
-    }
-};
+namespace vt {
 
 class Octree
 {
@@ -59,31 +50,54 @@ public:
     int       get_child_count() const       { return m_child_count; }
     bool      is_leaf() const               { return !m_child_count; }
     bool      is_root() const               { return !m_parent; }
-    size_t    get_leaf_object_count() const { return m_leaf_objects.size(); }
+    size_t    get_leaf_object_count() const { return m_leaf_ids.size(); }
 
+    // ids are unique per tree -- exists/move/remove go through the root's id index
+    // NOTE: ids are small non-negative indices -- the id index is a flat array sized by the largest id
     bool insert(long id, glm::vec3 pos);
     bool remove(long id);
     int find(glm::vec3          target,
              int                k,
              std::vector<long>* nearest_k_vec,
              float              radius = -1) const;
+    int find(glm::vec3 target,
+             int       k,
+             long*     nearest_k_ids,   // capacity k -- nearest first
+             float*    nearest_k_dists, // capacity k -- scratch
+             float     radius = -1) const;
     bool exists(long id);
     bool move(long id, glm::vec3 pos);
-    bool rebalance();
+    bool rebalance(); // keeps emptied octants for reuse -- call prune_empty_nodes to reclaim them
+
+    // mass aggregates (barnes-hut)
+    // insert/remove/move only mark the path to the root dirty -- refit recomputes just the dirty nodes
+    void set_mass(long id, float mass);
+    float get_mass(long id) const;
+    void refit();
+    float get_total_mass() const        { return m_mass; }
+    glm::vec3 get_mass_center() const   { return m_mass_center; }
+    glm::vec3 get_gravitational_field(glm::vec3 target,
+                                      float     theta,
+                                      float     softening  = 0,
+                                      long      exclude_id = -1) const; // valid after refit, excludes G
 
     std::string get_name() const;
     void dump() const;
 
 private:
-    void find_hier(glm::vec3                                                                    target,
-                   int                                                                          k,
-                   std::priority_queue<id_dist_t, std::vector<id_dist_t>, id_dist_less_than_t>* nearest_k_pq,
-                   bool                                                                         is_direct_lineage,
-                   float                                                                        radius) const;
+    void find_hier(glm::vec3 target,
+                   int       k,
+                   long*     nearest_k_ids,
+                   float*    nearest_k_dists,
+                   int*      nearest_k_count,
+                   bool      is_direct_lineage,
+                   float     radius) const;
     Octree* alloc_octant(glm::vec3 pos);
     Octree* first_including_parent_node(glm::vec3 pos);
     int get_octant_index(glm::vec3 pos) const;
     bool within_bbox(glm::vec3 pos) const;
+    void mark_dirty_mass();
+    void erase_leaf_slot(int slot);
 
     glm::vec3                 m_origin;
     glm::vec3                 m_dim;
@@ -94,7 +108,21 @@ private:
     Octree*                   m_parent;
     Octree*                   m_root;
     int                       m_child_count;
-    std::map<long, glm::vec3> m_leaf_objects;
+
+    // leaf contents -- parallel arrays, removal swaps in the last entry
+    std::vector<long>      m_leaf_ids;
+    std::vector<glm::vec3> m_leaf_positions;
+
+    // mass aggregates
+    float     m_mass;
+    glm::vec3 m_mass_center;
+    bool      m_is_dirty_mass;
+
+    // root only -- indexed by id, capacity kept across clear
+    std::vector<Octree*> m_object_nodes;  // id -> leaf (NULL if absent)
+    std::vector<int>     m_object_slots;  // id -> index into the leaf's arrays
+    std::vector<float>   m_object_masses; // id -> mass
+    bool                 m_has_masses;    // any non-unit mass
 };
 
 }
@@ -20,6 +20,9 @@
 
 #include <Octree.h>
 #include <Mesh.h>
+#include <vector>
+#include <map>
+#include <random>
 #include <tuple>
 #include <glm/glm.hpp>
 
@@ -47,24 +50,64 @@ public:
                    EXPORT_EDGE_P2,
                    EXPORT_EDGE_COST } export_edge_attr_t;
 
-    PRM(Octree* octree);
+    enum sample_type_t {
+        SAMPLE_TYPE_UNIFORM,
+        SAMPLE_TYPE_HALTON,
+        SAMPLE_TYPE_SOBOL,
+        SAMPLE_TYPE_GAUSSIAN,
+        SAMPLE_TYPE_BRIDGE,
+        SAMPLE_TYPE_COUNT
+    };
+
+    enum shortcut_type_t {
+        SHORTCUT_TYPE_GREEDY,
+        SHORTCUT_TYPE_RANDOM
+    };
+
+    PRM(Octree* octree, unsigned int seed = 0);
     ~PRM();
-    void randomize_waypoints(size_t n);
+    void set_seed(unsigned int seed)          { m_rng.seed(seed); }
+    float get_agent_radius() const            { return m_agent_radius; }
+    void set_agent_radius(float agent_radius) { m_agent_radius = agent_radius; }
+    void randomize_waypoints(size_t        n,
+                             sample_type_t sample_type  = SAMPLE_TYPE_UNIFORM,
+                             float         sample_sigma = 0);
     void connect_waypoints(int k, float radius);
     int find_nearest_waypoint(glm::vec3 pos) const;
     bool find_shortest_path(glm::vec3 start_pos, glm::vec3 finish_pos, std::vector<int>* path);
     void prune_edges();
     bool export_waypoints(std::vector<glm::vec3>* waypoint_values) const;
     bool export_edges(std::vector<std::tuple<int, int, float>>* edges) const;
+    bool export_path_values(const std::vector<int>& path, std::vector<glm::vec3>* path_values) const;
+
+    // path post-processing
+    bool shortcut_path(std::vector<glm::vec3>* path_values,
+                       shortcut_type_t         shortcut_type = SHORTCUT_TYPE_GREEDY,
+                       int                     iters         = 0);
+    bool smooth_path(const std::vector<glm::vec3>& path_values,
+                     int                           samples_per_segment,
+                     float                         control_point_scale,
+                     std::vector<glm::vec3>*       smooth_path_values) const;
+    bool is_point_collide(glm::vec3 pos) const;
+    bool is_segment_collide(glm::vec3 p1, glm::vec3 p2) const;
+    void find_segment_collisions(const std::vector<std::pair<glm::vec3, glm::vec3>>& segments,
+                                 std::vector<bool>*                                  is_collide_vec) const;
+
     void add_obstacle(Mesh* obstacle);
     PRM_Waypoint* at(int index) const;
     void clear();
 
 private:
+    glm::vec3 sample_uniform();
+    glm::vec3 sample_gaussian(glm::vec3 center, float sigma);
+    void add_waypoint(glm::vec3 origin);
+
     Octree*                                  m_octree;
     std::vector<PRM_Waypoint*>               m_waypoints;
     std::vector<std::tuple<int, int, float>> m_edges;
     std::vector<Mesh*>                       m_obstacles;
+    std::mt19937                             m_rng;
+    float                                    m_agent_radius;
 };
 
 }
@@ -0,0 +1,100 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VT_PARALLEL_MECHANISM_H_
+#define VT_PARALLEL_MECHANISM_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vt {
+
+// stewart-gough platform -- linear actuators between fixed base anchors and platform anchors
+// NOTE: base anchors are in base space, platform anchors are in platform space
+class StewartPlatform
+{
+public:
+    StewartPlatform();
+    virtual ~StewartPlatform();
+
+    // legs
+    int add_leg(glm::vec3 base_anchor,
+                glm::vec3 local_platform_anchor,
+                float     min_length,
+                float     max_length);
+    void clear();
+    size_t size() const { return m_base_anchors.size(); }
+    const glm::vec3 &get_base_anchor(int index) const           { return m_base_anchors[index]; }
+    const glm::vec3 &get_local_platform_anchor(int index) const { return m_local_platform_anchors[index]; }
+
+    // inverse kinematics -- closed form, false if any actuator is out of range
+    bool solve_ik(const glm::mat4 &platform_transform, float* lengths) const;
+    void solve_ik_batch(const glm::mat4* platform_transforms,
+                        size_t           count,
+                        float*           lengths,   // count * size()
+                        char*            is_valid) const;
+
+    // forward kinematics -- newton iterations from initial guess in platform_transform
+    bool solve_fk(const float* lengths,
+                  glm::mat4*   platform_transform,
+                  int          iters,
+                  float        accept_length_error) const;
+
+private:
+    std::vector<glm::vec3> m_base_anchors;
+    std::vector<glm::vec3> m_local_platform_anchors;
+    std::vector<float>     m_min_lengths;
+    std::vector<float>     m_max_lengths;
+};
+
+// rotary delta robot -- arms spaced evenly about the up axis, shoulder axes tangent to base circle
+// arm angle is 0 when upper arm is horizontal, positive downward (degrees)
+class DeltaRobot
+{
+public:
+    DeltaRobot(float base_radius,
+               float effector_radius,
+               float upper_arm_length,
+               float forearm_length,
+               int   arm_count = 3);
+    virtual ~DeltaRobot();
+
+    int get_arm_count() const { return m_arm_count; }
+    glm::vec3 get_arm_dir(int arm_index) const;
+    glm::vec3 get_elbow(int arm_index, float angle) const;
+
+    // inverse kinematics -- closed form per arm, false if effector origin is out of reach
+    bool solve_ik(glm::vec3 effector_origin, float* angles) const;
+    void solve_ik_batch(const glm::vec3* effector_origins,
+                        size_t           count,
+                        float*           angles,   // count * get_arm_count()
+                        char*            is_valid) const;
+
+    // forward kinematics -- intersection of forearm spheres from first three arms (lower solution)
+    bool solve_fk(const float* angles, glm::vec3* effector_origin) const;
+
+private:
+    float m_base_radius;
+    float m_effector_radius;
+    float m_upper_arm_length;
+    float m_forearm_length;
+    int   m_arm_count;
+};
+
+}
+
+#endif
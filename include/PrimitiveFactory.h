@@ -32,9 +32,6 @@ class MeshBase;
 class PrimitiveFactory
 {
 public:
-    static void get_box_corners(glm::vec3        (&points)[8],
-                                const glm::vec3* origin = NULL,
-                                const glm::vec3* dim    = NULL);
     static Mesh* create_grid(const std::string& name             = "",
                                    int          cols             = 1,
                                    int          rows             = 1,
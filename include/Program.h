@@ -39,6 +39,8 @@ public:
     };
 
     enum var_attribute_type_t {
+        var_attribute_type_instance_color,
+        var_attribute_type_instance_transform,
         var_attribute_type_texcoord,
         var_attribute_type_vertex_normal,
         var_attribute_type_vertex_position,
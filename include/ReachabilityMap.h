@@ -0,0 +1,71 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VT_REACHABILITY_MAP_H_
+#define VT_REACHABILITY_MAP_H_
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+namespace vt {
+
+class KinematicChain;
+
+// voxelized workspace of a chain -- one bit per voxel, set if the end effector tip can get there
+// NOTE: map lives in the chain's base space (space of the root's parent)
+class ReachabilityMap
+{
+public:
+    ReachabilityMap();
+    virtual ~ReachabilityMap();
+
+    // offline
+    bool build(const KinematicChain &chain,
+               float                voxel_size,
+               size_t               sample_count,
+               int                  thread_count = 0); // 0 -- one worker per hardware thread
+    void clear();
+
+    // runtime
+    bool is_reachable(glm::vec3 local_point) const;
+    bool is_reachable(const glm::mat4 &base_inverse_transform, glm::vec3 abs_point) const;
+    size_t get_reachable_count() const;
+    const glm::vec3 &get_min() const   { return m_min; }
+    const glm::ivec3 &get_dim() const  { return m_dim; }
+    float get_voxel_size() const       { return m_voxel_size; }
+    uint32_t get_signature() const     { return m_signature; }
+
+    // serialization
+    static uint32_t get_signature(const KinematicChain &chain, float voxel_size, size_t sample_count);
+    bool save(std::string filename) const;
+    bool load(std::string filename);
+
+private:
+    glm::vec3                  m_min;
+    glm::ivec3                 m_dim;
+    float                      m_voxel_size;
+    uint32_t                   m_signature; // identifies chain layout the map was built from
+    std::vector<unsigned char> m_bits;
+
+    int get_voxel_index(glm::vec3 local_point) const; // -1 if outside
+};
+
+}
+
+#endif
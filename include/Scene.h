@@ -18,6 +18,7 @@
 #ifndef VT_SCENE_H_
 #define VT_SCENE_H_
 
+#include <TransformStore.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <GL/glew.h>
 #include <vector>
@@ -141,6 +142,11 @@ public:
     void add_mesh(Mesh* mesh);
     void remove_mesh(Mesh* mesh);
 
+    TransformStore* get_transform_store()
+    {
+        return &m_transform_store;
+    }
+
     Material* find_material(std::string name);
     void add_material(Material* material);
     void remove_material(Material* material);
@@ -185,6 +191,15 @@ public:
         return m_wireframe_material;
     }
 
+    void set_wireframe_instanced_material(Material* material)
+    {
+        m_wireframe_instanced_material = material;
+    }
+    Material* get_wireframe_instanced_material() const
+    {
+        return m_wireframe_instanced_material;
+    }
+
     void set_ssao_material(Material* material)
     {
         m_ssao_material = material;
@@ -254,8 +269,11 @@ private:
     textures_t  m_textures;
     Material*   m_normal_material;
     Material*   m_wireframe_material;
+    Material*   m_wireframe_instanced_material;
     Material*   m_ssao_material;
 
+    TransformStore m_transform_store;
+
     GLfloat* m_bloom_kernel;
     GLfloat  m_glow_cutoff_threshold;
     GLfloat* m_light_pos;
@@ -0,0 +1,58 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_SCRATCH_ARENA_H_
+#define VT_SCRATCH_ARENA_H_
+
+#include <vector>
+#include <stddef.h>
+
+#define SCRATCH_ARENA_BLOCK_SIZE (64 * 1024)
+
+namespace vt {
+
+// bump allocator for short-lived query results -- reset() recycles everything at once
+// NOTE: blocks survive reset(), so once warmed up a steady workload never touches the heap
+//       only for types that need no constructor or destructor
+class ScratchArena
+{
+public:
+    ScratchArena(size_t block_size = SCRATCH_ARENA_BLOCK_SIZE);
+    virtual ~ScratchArena();
+
+    void* alloc(size_t size, size_t alignment);
+    template<class T>
+    T* alloc(size_t count) { return static_cast<T*>(alloc(count * sizeof(T), alignof(T))); }
+    void reset();
+
+    size_t get_capacity() const { return m_capacity; }
+    size_t get_used() const     { return m_used; }
+
+private:
+    std::vector<char*>  m_blocks;
+    std::vector<size_t> m_block_sizes;
+    size_t              m_block_size;
+    size_t              m_block_index;
+    size_t              m_offset;
+    size_t              m_capacity;
+    size_t              m_used;
+};
+
+}
+
+#endif
@@ -40,7 +40,9 @@ public:
                   Buffer*   vbo_vert_normal,
                   Buffer*   vbo_vert_tangent,
                   Buffer*   vbo_tex_coords,
-                  Buffer*   ibo_tri_indices);
+                  Buffer*   ibo_tri_indices,
+                  Buffer*   vbo_instance_transforms = NULL,  // one mat4 per instance -- draws instanced if program has instance_transform
+                  Buffer*   vbo_instance_colors     = NULL); // one vec3 per instance
     ~ShaderContext();
     Material* get_material() const
     {
@@ -116,6 +118,7 @@ public:
 private:
     Material *m_material;
     Buffer *m_vbo_vert_coords, *m_vbo_vert_normal, *m_vbo_vert_tangent, *m_vbo_tex_coords, *m_ibo_tri_indices;
+    Buffer *m_vbo_instance_transforms, *m_vbo_instance_colors;
     std::vector<VarAttribute*> m_var_attributes;
     std::vector<VarUniform*> m_var_uniforms;
     const textures_t &m_textures;
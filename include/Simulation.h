@@ -0,0 +1,100 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_SIMULATION_H_
+#define VT_SIMULATION_H_
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+#define SIMULATION_TICK_DT         (1.0f / 60) // per-tick parameters are tuned at this step size
+#define SIMULATION_MAX_STEP_BACKLOG 8
+#define SIMULATION_GRAIN_SIZE       256 // agents per parallel chunk -- fixed so reductions don't depend on thread count
+
+namespace vt {
+
+class Simulation;
+class ThreadPool;
+class ScratchArena;
+
+// notified after every step -- rendering is one such observer
+class SimulationObserver
+{
+public:
+    virtual ~SimulationObserver() {}
+    virtual void on_step(Simulation* simulation) = 0;
+};
+
+// fixed-timestep simulation core -- owns agent state, knows nothing about rendering
+class Simulation
+{
+public:
+    Simulation(float fixed_dt = SIMULATION_TICK_DT);
+    virtual ~Simulation();
+
+    // stepping
+    void step(float dt);
+    void step() { step(m_fixed_dt); }
+    int advance(float elapsed_time, int max_steps = SIMULATION_MAX_STEP_BACKLOG);
+
+    float get_fixed_dt() const              { return m_fixed_dt; }
+    void set_fixed_dt(float fixed_dt)       { m_fixed_dt = fixed_dt; }
+    double get_time() const                 { return m_time; }
+    unsigned long get_step_count() const    { return m_step_count; }
+
+    // threading (results are identical for any thread count)
+    int get_thread_count() const;
+    void set_thread_count(int thread_count); // 0 -- one thread per hardware thread
+
+    // observers
+    void add_observer(SimulationObserver* observer);
+    void remove_observer(SimulationObserver* observer);
+
+    // agent state
+    virtual size_t get_agent_count() const = 0;
+    virtual glm::vec3 get_agent_origin(int index) const = 0;
+    virtual glm::quat get_agent_orientation(int index) const = 0;
+
+protected:
+    virtual void update(float dt) = 0;
+
+    // data-parallel passes over agents -- each chunk reads previous state and writes only its own agents
+    // NOTE: scratch_arena belongs to the running thread and is reset before every chunk
+    void parallel_for(int pass, size_t count);
+    virtual void run_pass(int pass, int chunk_index, size_t begin, size_t end, ScratchArena* scratch_arena) {}
+    static int get_chunk_count(size_t count);
+
+private:
+    class PassTask;
+
+    float                            m_fixed_dt;
+    float                            m_time_accumulator;
+    double                           m_time;
+    unsigned long                    m_step_count;
+    std::vector<SimulationObserver*> m_observers;
+    ThreadPool*                      m_thread_pool;
+    std::vector<ScratchArena*>       m_scratch_arenas; // one per thread
+
+    void create_scratch_arenas();
+    void destroy_scratch_arenas();
+};
+
+}
+
+#endif
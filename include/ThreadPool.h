@@ -0,0 +1,72 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_THREAD_POOL_H_
+#define VT_THREAD_POOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace vt {
+
+// one parallel_for body -- called once per chunk [begin, end) of the index range
+// NOTE: thread_index is in [0, thread count) and never shared by two chunks running at once
+class ThreadPoolTask
+{
+public:
+    virtual ~ThreadPoolTask() {}
+    virtual void run(int thread_index, int chunk_index, size_t begin, size_t end) = 0;
+};
+
+// fixed set of worker threads for data-parallel loops
+// NOTE: chunk boundaries depend only on count and grain (never on thread count),
+//       so per-chunk partial results reduced in chunk order are identical for any thread count
+class ThreadPool
+{
+public:
+    ThreadPool(int thread_count = 0); // 0 -- one worker per hardware thread
+    virtual ~ThreadPool();
+
+    void parallel_for(size_t count, size_t grain, ThreadPoolTask* task);
+    int get_thread_count() const { return m_threads.size() + 1; }
+
+    static int get_chunk_count(size_t count, size_t grain) { return grain ? (count + grain - 1) / grain : 0; }
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex               m_mutex;
+    std::condition_variable  m_work_cond;
+    std::condition_variable  m_done_cond;
+    ThreadPoolTask*          m_task;
+    size_t                   m_count;
+    size_t                   m_grain;
+    int                      m_next_chunk;
+    int                      m_chunk_count;
+    int                      m_pending_chunks;
+    unsigned long            m_batch;
+    bool                     m_is_shutdown;
+
+    void run_chunks(int thread_index);
+    void worker(int thread_index);
+};
+
+}
+
+#endif
@@ -0,0 +1,153 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef VT_TRAJECTORY_H_
+#define VT_TRAJECTORY_H_
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdint.h>
+
+#define TRAJECTORY_CHUNK_FRAME_COUNT 64            // frames decoded at most per seek
+#define TRAJECTORY_QUANTUM           (1.0f / 4096) // origin/scale step in delta mode
+
+namespace vt {
+
+class TransformObject;
+class Simulation;
+
+enum trajectory_mode_t {
+    TRAJECTORY_MODE_FULL,  // raw floats -- lossless
+    TRAJECTORY_MODE_DELTA, // quantized, delta-coded against the previous frame within a chunk
+    TRAJECTORY_MODE_COUNT
+};
+
+// streams per-frame object transforms (origin, orientation, scale) to a chunked binary file
+// every chunk starts from a keyframe and an index of chunk offsets is written on close,
+// so readers can seek without touching earlier chunks
+// NOTE: native byte order
+class TrajectoryWriter
+{
+public:
+    TrajectoryWriter();
+    virtual ~TrajectoryWriter();
+
+    bool open(std::string       filename,
+              int               object_count,
+              trajectory_mode_t mode              = TRAJECTORY_MODE_DELTA,
+              float             frame_dt          = 0,
+              float             quantum           = TRAJECTORY_QUANTUM,
+              int               chunk_frame_count = TRAJECTORY_CHUNK_FRAME_COUNT);
+    bool close(); // writes the index -- a file without one can't be read
+    bool is_open() const { return m_file != NULL; }
+
+    // per-frame staging -- objects not set keep the previous frame's transform
+    void set_transform(int       index,
+                       glm::vec3 origin,
+                       glm::quat orientation,
+                       glm::vec3 scale = glm::vec3(1));
+    bool write_frame();
+    bool write_frame(const std::vector<TransformObject*> &objects); // local transforms
+    bool write_frame(const Simulation* simulation);                 // agent origins and orientations
+
+    size_t get_frame_count() const  { return m_frame_count; }
+    uint64_t get_byte_count() const { return m_byte_count; }
+
+private:
+    FILE*                      m_file;
+    trajectory_mode_t          m_mode;
+    int                        m_object_count;
+    int                        m_chunk_frame_count;
+    float                      m_quantum;
+    size_t                     m_frame_count;
+    int                        m_chunk_frame_index; // frames in the chunk being built
+    uint64_t                   m_byte_count;
+    bool                       m_is_ok; // sticky -- any failed write spoils the file
+
+    // staging
+    std::vector<glm::vec3>     m_origins;
+    std::vector<glm::quat>     m_orientations;
+    std::vector<glm::vec3>     m_scales;
+    std::vector<int32_t>       m_prev_quantized; // 10 per object -- origin xyz, orientation wxyz, scale xyz
+
+    // output
+    std::vector<unsigned char> m_chunk_bytes;
+    std::vector<uint64_t>      m_chunk_offsets;
+
+    void encode_frame();
+    bool flush_chunk();
+};
+
+// replays a trajectory file -- any frame is at most TRAJECTORY_CHUNK_FRAME_COUNT decodes away
+class TrajectoryReader
+{
+public:
+    TrajectoryReader();
+    virtual ~TrajectoryReader();
+
+    bool open(std::string filename);
+    void close();
+    bool is_open() const { return m_file != NULL; }
+
+    size_t get_frame_count() const     { return m_frame_count; }
+    int get_object_count() const       { return m_object_count; }
+    trajectory_mode_t get_mode() const { return m_mode; }
+    float get_frame_dt() const         { return m_frame_dt; }
+
+    // playback
+    bool seek(size_t frame_index);
+    size_t get_frame_index() const                    { return m_frame_index; }
+    const glm::vec3 &get_origin(int index) const      { return m_origins[index]; }
+    const glm::quat &get_orientation(int index) const { return m_orientations[index]; }
+    const glm::vec3 &get_scale(int index) const       { return m_scales[index]; }
+    void apply(const std::vector<TransformObject*> &objects) const; // drives objects with the current frame
+
+private:
+    FILE*                      m_file;
+    trajectory_mode_t          m_mode;
+    int                        m_object_count;
+    int                        m_chunk_frame_count;
+    float                      m_quantum;
+    float                      m_frame_dt;
+    size_t                     m_frame_count;
+    std::vector<uint64_t>      m_chunk_offsets;
+
+    // decoded state
+    size_t                     m_frame_index;
+    std::vector<glm::vec3>     m_origins;
+    std::vector<glm::quat>     m_orientations;
+    std::vector<glm::vec3>     m_scales;
+    std::vector<int32_t>       m_quantized;
+
+    // chunk cache -- sequential playback reads each chunk once
+    int                        m_chunk_index;
+    int                        m_chunk_frame_index; // last decoded frame within the chunk, -1 if none
+    uint32_t                   m_chunk_frames;
+    size_t                     m_read_pos;
+    std::vector<unsigned char> m_chunk_bytes;
+
+    bool load_chunk(int chunk_index);
+    bool decode_frame();
+};
+
+}
+
+#endif
@@ -20,12 +20,15 @@
 
 #include <NamedObject.h>
 #include <Util.h>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/glm.hpp>
 #include <set>
 #include <tuple>
 
 namespace vt {
 
+class TransformStore;
+
 class TransformObject : public NamedObject
 {
 public:
@@ -34,6 +37,21 @@ public:
         JOINT_TYPE_PRISMATIC
     };
 
+    enum ik_type_t {
+        IK_TYPE_CCD,
+        IK_TYPE_FABRIK,
+        IK_TYPE_JACOBIAN,
+        IK_TYPE_ANALYTIC, // falls back to ccd if chain has no closed-form solution
+        IK_TYPE_COUNT
+    };
+
+    // how the local transform is built -- lets TransformStore compose it without a virtual call
+    enum transform_kind_t {
+        TRANSFORM_KIND_TRS,       // translate * rotate * scale
+        TRANSFORM_KIND_TRANSLATE, // translate only
+        TRANSFORM_KIND_CUSTOM     // update_transform() override
+    };
+
     typedef enum { DEBUG_LINE_P1,
                    DEBUG_LINE_P2,
                    DEBUG_LINE_COLOR,
@@ -46,6 +64,10 @@ public:
     glm::vec3 m_debug_local_target;
     std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3, float>> m_debug_lines;
 
+    // ik telemetry (for debug)
+    int   m_debug_ik_iters;
+    float m_debug_ik_residual;
+
     TransformObject(const std::string& name,
                           glm::vec3    origin = glm::vec3(0),
                           glm::vec3    euler  = glm::vec3(0),
@@ -53,12 +75,14 @@ public:
     virtual ~TransformObject();
 
     // basic features
-    const glm::vec3 &get_origin() const { return m_origin; }
-    const glm::vec3 &get_euler() const  { return m_euler; }
-    const glm::vec3 &get_scale() const  { return m_scale; }
+    const glm::vec3 &get_origin() const { return *m_origin; }
+    const glm::vec3 &get_euler() const;
+    const glm::vec3 &get_scale() const  { return *m_scale; }
+    const glm::quat &get_orientation() const { return *m_orientation; }
     void set_origin(glm::vec3 origin);
     void set_euler(glm::vec3 euler);
     void set_scale(glm::vec3 scale);
+    void set_orientation(glm::quat orientation);
     void reset_transform();
 
     // coordinate system conversions
@@ -69,12 +93,15 @@ public:
     glm::vec3 get_abs_up_direction();
     glm::vec3 get_abs_heading();
     glm::vec3 get_abs_direction(euler_index_t euler_index);
+    glm::quat get_abs_orientation() const;
 
     // coordinate system operations
     void point_at_local(glm::vec3 local_target, glm::vec3* local_up_direction = NULL);
     void set_local_rotation_transform(glm::mat4 rotation_transform);
     void rotate(glm::mat4 rotation_transform);
+    void rotate(glm::quat abs_rotation);
     void rotate(float angle_delta, glm::vec3 pivot);
+    void rotate_local(glm::quat local_rotation);
 
     // hierarchy related
     void link_parent(TransformObject* new_parent, bool keep_transform = false);
@@ -111,6 +138,35 @@ public:
                       int              iters,
                       float            accept_end_effector_distance,
                       float            accept_avg_angle_distance);
+    bool solve_ik_fabrik(TransformObject* root,
+                         glm::vec3        local_end_effector_tip,
+                         glm::vec3        target,
+                         glm::vec3*       end_effector_dir,
+                         int              iters,
+                         float            accept_end_effector_distance);
+    bool solve_ik_jacobian(TransformObject* root,
+                           glm::vec3        local_end_effector_tip,
+                           glm::vec3        target,
+                           glm::vec3*       end_effector_dir,
+                           int              iters,
+                           float            accept_end_effector_distance,
+                           float            damping = 0.1f);
+    bool get_analytic_ik_chain(TransformObject*               root,
+                               TransformObject**              yaw_segment     = NULL,
+                               std::vector<TransformObject*>* planar_segments = NULL);
+    bool solve_ik_analytic(TransformObject* root,
+                           glm::vec3        local_end_effector_tip,
+                           glm::vec3        target,
+                           glm::vec3*       end_effector_dir,
+                           float            accept_end_effector_distance);
+    bool solve_ik(ik_type_t        ik_type,
+                  TransformObject* root,
+                  glm::vec3        local_end_effector_tip,
+                  glm::vec3        target,
+                  glm::vec3*       end_effector_dir,
+                  int              iters,
+                  float            accept_end_effector_distance,
+                  float            accept_avg_angle_distance);
     void update_boid(glm::vec3 target,
                      float     forward_speed,
                      float     angle_delta,
@@ -118,17 +174,33 @@ public:
     void update_boid(float forward_speed);
 
     // core functionality
-    const glm::mat4 &get_transform(bool trace_down = true);
+    const glm::mat4 &get_transform();
+    const glm::mat4 &get_inverse_transform();
     const glm::mat4 &get_normal_transform();
     glm::mat4 get_local_rotation_transform() const;
 
+    // caching
+    static void advance_frame_generation()             { s_frame_generation++; }
+    static unsigned long get_frame_generation()        { return s_frame_generation; }
+    unsigned long get_transform_generation() const     { return m_transform_generation; }
+    bool is_dirty_transform() const                    { return m_is_dirty_transform; }
+
+    // batched update
+    TransformStore* get_transform_store() const { return m_transform_store; }
+    int get_transform_store_index() const       { return m_transform_store_index; }
+    transform_kind_t get_transform_kind() const { return m_transform_kind; }
+
 protected:
     // basic features
-    glm::vec3 m_origin;
-    glm::vec3 m_euler;
-    glm::vec3 m_scale;
-    glm::mat4 m_transform;
-    glm::mat4 m_normal_transform;
+    // NOTE: views -- point at the object's own storage, or at its TransformStore slots while in a store
+    glm::vec3*        m_origin;
+    mutable glm::vec3 m_euler;       // derived from m_orientation on demand
+    glm::quat*        m_orientation; // unit quaternion -- authoritative local rotation
+    glm::vec3*        m_scale;
+    glm::mat4*        m_transform;   // world transform
+    glm::mat4         m_inverse_transform;
+    glm::mat4         m_normal_transform;
+    transform_kind_t  m_transform_kind;
 
     // hierarchy related
     TransformObject*           m_parent;
@@ -142,27 +214,55 @@ protected:
     euler_index_t m_hinge_type;
 
     // caching
-    void mark_dirty_transform() {
-        m_is_dirty_transform        = true;
-        m_is_dirty_normal_transform = true;
-    }
+    void mark_dirty_transform();
     virtual void update_transform();
 
 private:
+    // own storage -- backs the views while outside a store
+    glm::vec3 m_own_origin;
+    glm::quat m_own_orientation;
+    glm::vec3 m_own_scale;
+    glm::mat4 m_own_transform;
+
+    // joint constraints
+    bool m_is_recalibrating_heading;
+
+    // advanced features
+    bool solve_ik_analytic_chain(TransformObject*               yaw_segment,
+                                 std::vector<TransformObject*>& planar_segments,
+                                 glm::vec3                      local_end_effector_tip,
+                                 glm::vec3                      target,
+                                 glm::vec3*                     end_effector_dir,
+                                 float                          accept_end_effector_distance);
+
     // caching
-    bool m_is_dirty_transform;
-    bool m_is_dirty_normal_transform;
+    bool          m_is_dirty_transform;
+    bool          m_is_dirty_inverse_transform;
+    bool          m_is_dirty_normal_transform;
+    mutable bool  m_is_dirty_euler;
+    unsigned long m_transform_generation;
+
+    static unsigned long s_frame_generation;
+
+    // batched update
+    TransformStore* m_transform_store;
+    int             m_transform_store_index;
 
     // joint constraints
     void check_roll_hinge();
+    glm::quat constrain_local_orientation(glm::quat local_orientation) const;
 
     // optional advanced features
     virtual void flatten(glm::mat4* basis = NULL) {}
     virtual void set_axis(glm::vec3 axis) {}
 
     // caching
-    void update_transform_hier();
+    void update_inverse_transform();
     void update_normal_transform();
+    void update_euler() const;
+    void update_orientation();
+
+    friend class TransformStore;
 };
 
 }
@@ -0,0 +1,80 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef VT_TRANSFORM_STORE_H_
+#define VT_TRANSFORM_STORE_H_
+
+#include <TransformObject.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <set>
+
+namespace vt {
+
+// flat transform hierarchy -- parents always precede children
+// so all world transforms resolve in one linear pass
+// NOTE: owns the TRS and world transform of every object in it -- while in a store, a
+//       TransformObject's origin/orientation/scale/transform are views onto its slots here,
+//       so references from its getters only last until the store next rebuilds
+class TransformStore
+{
+public:
+    TransformStore();
+    virtual ~TransformStore();
+
+    // membership
+    void add(TransformObject* object);
+    void remove(TransformObject* object);
+    void clear();
+    size_t size();
+    void mark_dirty_topology() { m_is_dirty_topology = true; }
+    void mark_dirty(int index) { m_is_dirty_local[index] = true; }
+
+    // batched update
+    void update();
+
+    // flat access (valid after update)
+    TransformObject* get_object(int index) const                { return m_objects[index]; }
+    int get_parent_index(int index) const                        { return m_parent_indices[index]; }
+    const glm::vec3 &get_origin(int index) const                 { return m_origins[index]; }
+    const glm::quat &get_orientation(int index) const            { return m_orientations[index]; }
+    const glm::vec3 &get_scale(int index) const                  { return m_scales[index]; }
+    const glm::mat4 &get_world_transform(int index) const        { return m_world_transforms[index]; }
+    const std::vector<glm::mat4> &get_world_transforms() const   { return m_world_transforms; }
+
+private:
+    std::set<TransformObject*>                     m_members;
+    std::vector<TransformObject*>                  m_objects;
+    std::vector<int>                               m_parent_indices;
+    std::vector<TransformObject::transform_kind_t> m_transform_kinds;
+    std::vector<glm::vec3>                         m_origins;
+    std::vector<glm::quat>                         m_orientations;
+    std::vector<glm::vec3>                         m_scales;
+    std::vector<glm::mat4>                         m_world_transforms;
+    std::vector<char>                              m_is_dirty_local; // set through TransformObject::mark_dirty_transform
+    std::vector<char>                              m_is_dirty;       // world transform changed in this pass
+    bool                                           m_is_dirty_topology;
+
+    void rebuild();
+    void attach(TransformObject* object, int index);
+    void detach(TransformObject* object);
+};
+
+}
+
+#endif
@@ -21,6 +21,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/euler_angles.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/glm.hpp>
 #include <vector>
 #include <string>
@@ -57,10 +58,12 @@
     #define GLM_ROTATION_TRANSFORM(m, a, v)     glm::rotate((m), glm::radians(a), (v))
     #define GLM_EULER_TRANSFORM(y, p, r)        glm::eulerAngleYXZ(glm::radians(y), glm::radians(p), glm::radians(r))
     #define GLM_EULER_TRANSFORM_SANS_ROLL(y, p) glm::eulerAngleYX(glm::radians(y), glm::radians(p))
+    #define GLM_ANGLE_AXIS(a, v)                glm::angleAxis(glm::radians(a), (v))
 #else
     #define GLM_ROTATION_TRANSFORM(m, a, v)     glm::rotate((m), (a), (v))
     #define GLM_EULER_TRANSFORM(y, p, r)        glm::eulerAngleYXZ((y), (p), (r))
     #define GLM_EULER_TRANSFORM_SANS_ROLL(y, p) glm::eulerAngleYX((y), (p))
+    #define GLM_ANGLE_AXIS(a, v)                glm::angleAxis((a), (v))
 #endif
 
 #define EULER_ROLL(v)  v[vt::EULER_INDEX_ROLL]
@@ -94,16 +97,26 @@ T safe_normalize(T v)
 #endif
 }
 
-void print_bitmap_string(void* font, const char* s);
 glm::vec3 euler_to_offset(glm::vec3  euler,
                           glm::vec3* up_direction = NULL); // out
 glm::vec3 offset_to_euler(glm::vec3  offset,
                           glm::vec3* up_direction = NULL); // in
+glm::quat euler_to_quat(glm::vec3 euler);
+glm::vec3 quat_to_euler(glm::quat q);
 glm::vec3 as_offset_in_other_system(glm::vec3 euler, glm::mat4 transform, bool as_up_direction = false);
 glm::vec3 dir_from_point_as_offset_in_other_system(glm::vec3 euler, glm::mat4 transform, glm::vec3 point, bool as_up_direction = false);
 glm::vec3 euler_modulo(glm::vec3 euler);
 float angle_modulo(float angle);
 float angle_distance(float angle1, float angle2);
+float signed_angle(glm::vec3 a, glm::vec3 b, glm::vec3 axis);
+bool two_bone_ik(glm::vec3  base,
+                 glm::vec3  target,
+                 glm::vec3  plane_normal,
+                 float      length1,
+                 float      length2,
+                 int        bend_sign,
+                 glm::vec3* elbow,
+                 glm::vec3* end);
 glm::vec3 nearest_point_on_plane(glm::vec3 plane_origin, glm::vec3 plane_normal, glm::vec3 point);
 glm::vec3 projection_onto(glm::vec3 a, glm::vec3 b);
 glm::vec3 rejection_from(glm::vec3 a, glm::vec3 b);
@@ -118,6 +131,9 @@ float ray_plane_intersection(glm::vec3 plane_point,
                              glm::vec3 ray_origin,
                              glm::vec3 ray_dir);
 glm::vec3 get_absolute_direction(int euler_index);
+void get_box_corners(glm::vec3        (&points)[8],
+                     const glm::vec3* origin = NULL,
+                     const glm::vec3* dim    = NULL);
 bool is_within(glm::vec3 pos, glm::vec3 _min, glm::vec3 _max);
 float ray_box_intersect(glm::mat4  box_transform,
                         glm::mat4  box_inverse_transform,
@@ -127,6 +143,33 @@ float ray_box_intersect(glm::mat4  box_transform,
                         glm::vec3  ray_dir,
                         glm::vec3* surface_point,
                         glm::vec3* surface_normal);
+bool segment_box_intersect(glm::mat4 box_inverse_transform,
+                           glm::vec3 box_min,
+                           glm::vec3 box_max,
+                           glm::vec3 p1,
+                           glm::vec3 p2);
+bool ray_aabb_intersect(glm::vec3 box_min,
+                        glm::vec3 box_max,
+                        glm::vec3 ray_origin,
+                        glm::vec3 ray_dir,
+                        float     max_dist,
+                        float*    dist);
+float ray_box_distance(glm::mat4 box_inverse_transform,
+                       glm::vec3 box_min,
+                       glm::vec3 box_max,
+                       glm::vec3 ray_origin,
+                       glm::vec3 ray_dir);
+float point_box_distance(glm::mat4 box_transform,
+                         glm::vec3 box_min,
+                         glm::vec3 box_max,
+                         glm::vec3 point);
+bool capsule_box_intersect(glm::mat4 box_transform,
+                           glm::mat4 box_inverse_transform,
+                           glm::vec3 box_min,
+                           glm::vec3 box_max,
+                           glm::vec3 p1,
+                           glm::vec3 p2,
+                           float     radius);
 glm::vec3 get_random_offset();
 float ray_sphere_next_ray(glm::vec3  ray_origin,
                           glm::vec3  ray_dir,
@@ -145,6 +188,7 @@ float ray_plane_next_ray(glm::vec3  ray_origin,
                          float      plane_diffuse_fuzz,
                          glm::vec3* next_ray);
 glm::vec3 bezier_interpolate(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3 p4, float alpha);
+bool solve_linear_system(float* a, float* b, int n);
 bool read_file(std::string filename, std::string &s);
 bool regexp(const std::string &s, const std::string& pattern, std::vector<std::string*> &cap_groups, size_t* start_pos);
 bool regexp(const std::string &s, const std::string& pattern, std::vector<std::string*> &cap_groups);
@@ -41,6 +41,13 @@ public:
                                GLsizei       stride,
                                const GLvoid* pointer) const;
 
+    // per-instance attributes advance once per instance instead of once per vertex
+    // NOTE: a matrix attribute spans one slot per column (e.g. 4 slots of 4 floats for a mat4)
+    void instanced_vertex_attrib_pointer(Buffer* buffer,
+                                         GLint   size,
+                                         int     slot_count = 1) const;
+    void disable_instanced_vertex_attrib_array(int slot_count = 1) const;
+
 private:
     bool m_is_enabled;
 };
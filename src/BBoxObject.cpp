@@ -16,7 +16,6 @@
 // along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <BBoxObject.h>
-#include <PrimitiveFactory.h>
 #include <TransformObject.h>
 #include <glm/glm.hpp>
 
@@ -180,7 +179,7 @@ bool BBoxObject::is_bbox_collide(TransformObject* self_transform_object,
         //  1-------2
         // z
 
-        vt::PrimitiveFactory::get_box_corners(points);
+        vt::get_box_corners(points);
 
         for(int i = 0; i < 8; i++) {
             glm::ivec3 bbox_extents_indices(static_cast<int>(points[i].x),
@@ -307,7 +306,7 @@ bool BBoxObject::is_sphere_collide(TransformObject* self_transform_object,
         //  1-------2
         // z
 
-        vt::PrimitiveFactory::get_box_corners(points);
+        vt::get_box_corners(points);
 
         for(int i = 0; i < 8; i++) {
             glm::ivec3 bbox_extents_indices(static_cast<int>(points[i].x),
@@ -359,6 +358,32 @@ bool BBoxObject::is_sphere_collide(TransformObject* self_transform_object,
     return true;
 }
 
+bool BBoxObject::is_segment_intersect(TransformObject* self_transform_object,
+                                      glm::vec3        p1,
+                                      glm::vec3        p2)
+{
+    return segment_box_intersect(self_transform_object->get_inverse_transform(),
+                                 m_min,
+                                 m_max,
+                                 p1,
+                                 p2);
+}
+
+bool BBoxObject::is_capsule_collide(TransformObject* self_transform_object,
+                                    glm::vec3        p1,
+                                    glm::vec3        p2,
+                                    float            radius)
+{
+    glm::mat4 self_transform = self_transform_object->get_transform();
+    return capsule_box_intersect(self_transform,
+                                 self_transform_object->get_inverse_transform(),
+                                 m_min,
+                                 m_max,
+                                 p1,
+                                 p2,
+                                 radius);
+}
+
 // http://www.opengl-tutorial.org/miscellaneous/clicking-on-objects/picking-with-custom-ray-obb-function/
 bool BBoxObject::is_ray_intersect(TransformObject* self_transform_object,
                                   glm::vec3        ray_origin,
@@ -371,7 +396,7 @@ bool BBoxObject::is_ray_intersect(TransformObject* self_transform_object,
     glm::vec3 _surface_point  = glm::vec3(0);
     glm::vec3 _surface_normal = glm::vec3(0);
     float _dist = ray_box_intersect(self_transform,
-                                    glm::inverse(self_transform),
+                                    self_transform_object->get_inverse_transform(),
                                     m_min,
                                     m_max,
                                     ray_origin,
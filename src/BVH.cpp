@@ -0,0 +1,328 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <BVH.h>
+#include <Util.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+namespace vt {
+
+// orders box indices along one world axis by box center
+struct box_center_less_than_t
+{
+    const std::vector<glm::vec3>* m_centers;
+    int                           m_axis;
+
+    bool operator()(int a, int b) const
+    {
+        return (*m_centers)[a][m_axis] < (*m_centers)[b][m_axis];
+    }
+};
+
+BVH::BVH()
+{
+}
+
+BVH::~BVH()
+{
+}
+
+void BVH::clear()
+{
+    m_boxes.clear();
+    m_box_centers.clear();
+    m_box_indices.clear();
+    m_nodes.clear();
+}
+
+int BVH::add(const glm::mat4 &transform,
+             const glm::mat4 &inverse_transform,
+             glm::vec3        min,
+             glm::vec3        max)
+{
+    box_t box;
+    box.m_inverse_transform = inverse_transform;
+    box.m_min               = min;
+    box.m_max               = max;
+    for(int i = 0; i < 3; i++) {
+        float axis_scale = glm::length(glm::vec3(transform[i]));
+        box.m_inv_scale[i] = (axis_scale > EPSILON) ? 1.0f / axis_scale : 0;
+    }
+
+    // world-space aabb of the 8 transformed corners
+    box.m_world_min = glm::vec3( FLT_MAX);
+    box.m_world_max = glm::vec3(-FLT_MAX);
+    for(int i = 0; i < 8; i++) {
+        glm::vec3 local_corner((i & 1) ? max.x : min.x,
+                               (i & 2) ? max.y : min.y,
+                               (i & 4) ? max.z : min.z);
+        glm::vec3 corner = glm::vec3(transform * glm::vec4(local_corner, 1));
+        box.m_world_min  = glm::min(box.m_world_min, corner);
+        box.m_world_max  = glm::max(box.m_world_max, corner);
+    }
+    m_boxes.push_back(box);
+    m_box_centers.push_back((box.m_world_min + box.m_world_max) * 0.5f);
+    return m_boxes.size() - 1;
+}
+
+void BVH::build()
+{
+    int n = m_boxes.size();
+    m_box_indices.resize(n);
+    for(int i = 0; i < n; i++) {
+        m_box_indices[i] = i;
+    }
+    m_nodes.clear();
+    if(!n) {
+        return;
+    }
+    m_nodes.push_back(node_t());
+    build_hier(0, 0, n);
+}
+
+// "slab method" entry only -- misses when the segment starts inside or enters past max_t
+static bool segment_slab_enter(glm::vec3  local_p1,
+                               glm::vec3  local_dir,
+                               glm::vec3  box_min,
+                               glm::vec3  box_max,
+                               float      max_t,
+                               float*     t,
+                               glm::vec3* local_normal)
+{
+    float t_enter    = -BIG_NUMBER;
+    float t_exit     =  BIG_NUMBER;
+    int   enter_axis = -1;
+    for(int i = 0; i < 3; i++) {
+        if(fabs(local_dir[i]) < EPSILON) { // segment parallel to slab
+            if(local_p1[i] < box_min[i] || local_p1[i] > box_max[i]) {
+                return false;
+            }
+            continue;
+        }
+        float inv_dir = 1.0f / local_dir[i];
+        float t1      = (box_min[i] - local_p1[i]) * inv_dir;
+        float t2      = (box_max[i] - local_p1[i]) * inv_dir;
+        if(t1 > t2) {
+            std::swap(t1, t2);
+        }
+        if(t1 > t_enter) {
+            t_enter    = t1;
+            enter_axis = i;
+        }
+        t_exit = std::min(t_exit, t2);
+        if(t_enter > t_exit) {
+            return false; // all it takes is one gap
+        }
+    }
+    if(enter_axis == -1 || t_enter < 0 || t_enter > max_t) {
+        return false;
+    }
+    *t = t_enter;
+    *local_normal = glm::vec3(0);
+    (*local_normal)[enter_axis] = (local_dir[enter_axis] > 0) ? -1 : 1;
+    return true;
+}
+
+// median split along the longest axis of the box centers
+void BVH::build_hier(int node_index, int first, int count)
+{
+    glm::vec3 node_min(   FLT_MAX);
+    glm::vec3 node_max(  -FLT_MAX);
+    glm::vec3 center_min( FLT_MAX);
+    glm::vec3 center_max(-FLT_MAX);
+    for(int i = first; i < first + count; i++) {
+        int box_index = m_box_indices[i];
+        node_min   = glm::min(node_min,   m_boxes[box_index].m_world_min);
+        node_max   = glm::max(node_max,   m_boxes[box_index].m_world_max);
+        center_min = glm::min(center_min, m_box_centers[box_index]);
+        center_max = glm::max(center_max, m_box_centers[box_index]);
+    }
+    m_nodes[node_index].m_min = node_min;
+    m_nodes[node_index].m_max = node_max;
+    if(count <= BVH_LEAF_SIZE) {
+        m_nodes[node_index].m_first       = first;
+        m_nodes[node_index].m_count       = count;
+        m_nodes[node_index].m_child_index = -1;
+        return;
+    }
+
+    glm::vec3 center_dim = center_max - center_min;
+    int axis = 0;
+    if(center_dim.y > center_dim[axis]) {
+        axis = 1;
+    }
+    if(center_dim.z > center_dim[axis]) {
+        axis = 2;
+    }
+    box_center_less_than_t less_than;
+    less_than.m_centers = &m_box_centers;
+    less_than.m_axis    = axis;
+    int half_count = count / 2;
+    std::nth_element(m_box_indices.begin() + first,
+                     m_box_indices.begin() + first + half_count,
+                     m_box_indices.begin() + first + count,
+                     less_than);
+
+    int child_index = m_nodes.size();
+    m_nodes.push_back(node_t());
+    m_nodes.push_back(node_t());
+    m_nodes[node_index].m_first       = first;
+    m_nodes[node_index].m_count       = 0;
+    m_nodes[node_index].m_child_index = child_index;
+    build_hier(child_index,     first,              half_count);
+    build_hier(child_index + 1, first + half_count, count - half_count);
+}
+
+void BVH::cast_ray_bundle(glm::vec3        ray_origin,
+                          const glm::vec3* ray_dirs,
+                          int              bundle_size,
+                          float*           nearest_distances) const
+{
+    if(m_nodes.empty()) {
+        return;
+    }
+    int stack[BVH_STACK_SIZE];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while(stack_size) {
+        const node_t &node = m_nodes[stack[--stack_size]];
+
+        // any ray that can still improve its reading keeps the node alive
+        bool is_hit = false;
+        for(int k = 0; k < bundle_size; k++) {
+            if(ray_aabb_intersect(node.m_min, node.m_max, ray_origin, ray_dirs[k], nearest_distances[k], NULL)) {
+                is_hit = true;
+                break;
+            }
+        }
+        if(!is_hit) {
+            continue;
+        }
+
+        if(!node.m_count) {
+            stack[stack_size++] = node.m_child_index;
+            stack[stack_size++] = node.m_child_index + 1;
+            continue;
+        }
+        for(int i = node.m_first; i < node.m_first + node.m_count; i++) {
+            const box_t &box = m_boxes[m_box_indices[i]];
+            glm::vec3 local_ray_origin = glm::vec3(box.m_inverse_transform * glm::vec4(ray_origin, 1));
+            glm::mat3 local_rotation   = glm::mat3(box.m_inverse_transform);
+            for(int k = 0; k < bundle_size; k++) {
+                float dist = BIG_NUMBER;
+                if(ray_aabb_intersect(box.m_min,
+                                      box.m_max,
+                                      local_ray_origin,
+                                      local_rotation * ray_dirs[k],
+                                      nearest_distances[k],
+                                      &dist) && dist < nearest_distances[k]) // exit of a box around the origin may lie past the reading
+                {
+                    nearest_distances[k] = dist;
+                }
+            }
+        }
+    }
+}
+
+void BVH::cast_ray_bundles(const glm::vec3* ray_origins,
+                           const glm::vec3* ray_dirs,
+                           int              bundle_size,
+                           float*           nearest_distances,
+                           size_t           bundle_count) const
+{
+    for(size_t i = 0; i < bundle_count; i++) {
+        cast_ray_bundle(ray_origins[i],
+                        &ray_dirs[i * bundle_size],
+                        bundle_size,
+                        &nearest_distances[i * bundle_size]);
+    }
+}
+
+bool BVH::sweep_sphere(glm::vec3  p1,
+                       glm::vec3  p2,
+                       float      radius,
+                       float*     hit_t,
+                       glm::vec3* hit_normal) const
+{
+    *hit_t      = 1;
+    *hit_normal = glm::vec3(0);
+    glm::vec3 dir = p2 - p1;
+    if(m_nodes.empty() || glm::length(dir) < EPSILON) {
+        return false;
+    }
+    glm::vec3 inflate(radius);
+    int stack[BVH_STACK_SIZE];
+    int stack_size = 0;
+    stack[stack_size++] = 0;
+    while(stack_size) {
+        const node_t &node = m_nodes[stack[--stack_size]];
+
+        // only nodes the sweep reaches before the current first contact
+        if(!ray_aabb_intersect(node.m_min - inflate, node.m_max + inflate, p1, dir, *hit_t, NULL)) {
+            continue;
+        }
+
+        if(!node.m_count) {
+            stack[stack_size++] = node.m_child_index;
+            stack[stack_size++] = node.m_child_index + 1;
+            continue;
+        }
+        for(int i = node.m_first; i < node.m_first + node.m_count; i++) {
+            const box_t &box = m_boxes[m_box_indices[i]];
+            glm::mat3 local_rotation = glm::mat3(box.m_inverse_transform);
+            glm::vec3 local_inflate  = box.m_inv_scale * radius;
+            glm::vec3 local_normal;
+            float     t = 1;
+            if(segment_slab_enter(glm::vec3(box.m_inverse_transform * glm::vec4(p1, 1)),
+                                  local_rotation * dir,
+                                  box.m_min - local_inflate,
+                                  box.m_max + local_inflate,
+                                  *hit_t,
+                                  &t,
+                                  &local_normal))
+            {
+                *hit_t      = t;
+                *hit_normal = safe_normalize(glm::transpose(local_rotation) * local_normal); // normal transform
+            }
+        }
+    }
+    return *hit_t < 1;
+}
+
+// one sweep per agent -- returns how many hit something
+int BVH::sweep_spheres(const glm::vec3* p1s,
+                       const glm::vec3* p2s,
+                       float            radius,
+                       float*           hit_ts,
+                       glm::vec3*       hit_normals,
+                       size_t           count) const
+{
+    int hit_count = 0;
+    for(size_t i = 0; i < count; i++) {
+        if(sweep_sphere(p1s[i], p2s[i], radius, &hit_ts[i], &hit_normals[i])) {
+            hit_count++;
+        }
+    }
+    return hit_count;
+}
+
+}
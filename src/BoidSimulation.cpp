@@ -0,0 +1,419 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <BoidSimulation.h>
+#include <BoidStore.h>
+#include <Simulation.h>
+#include <TransformObject.h>
+#include <BBoxObject.h>
+#include <Octree.h>
+#include <BVH.h>
+#include <ScratchArena.h>
+#include <Util.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <tuple>
+#include <sstream>
+#include <algorithm>
+#include <stdlib.h>
+#include <math.h>
+
+namespace vt {
+
+BoidSimulation::BoidSimulation(glm::vec3         bounds_origin,
+                               glm::vec3         bounds_dim,
+                               const BoidParams &params,
+                               float             fixed_dt)
+    : Simulation(fixed_dt),
+      m_params(params),
+      m_bounds(bounds_origin, bounds_origin + bounds_dim),
+      m_bounds_object(new TransformObject("bounds")),
+      m_octree(new Octree(bounds_origin, bounds_dim)),
+      m_target(0),
+      m_obstacle_bvh(new BVH()),
+      m_bounds_inverse_transform(1),
+      m_polarization(0),
+      m_collision_count(0),
+      m_tick_scale(1)
+{
+    for(int k = 0; k < BoidStore::BOID_BEHAVIOR_COUNT; k++) {
+        m_behavior_counts[k] = 0;
+    }
+}
+
+BoidSimulation::~BoidSimulation()
+{
+    clear_obstacles();
+    delete m_bounds_object;
+    delete m_octree;
+    delete m_obstacle_bvh;
+}
+
+//=======
+// agents
+//=======
+
+int BoidSimulation::add_agent(glm::vec3 origin, glm::vec3 euler, float speed)
+{
+    return m_store.add(origin, euler_to_quat(euler), speed);
+}
+
+void BoidSimulation::randomize_agents(glm::vec3 scatter_min, glm::vec3 scatter_max)
+{
+    int n = m_store.size();
+    for(int i = 0; i < n; i++) {
+        glm::vec3 rand_vec(static_cast<float>(rand()) / RAND_MAX,
+                           static_cast<float>(rand()) / RAND_MAX,
+                           static_cast<float>(rand()) / RAND_MAX);
+        m_store.set_origin(i, MIX(scatter_min, scatter_max, rand_vec));
+        m_store.set_orientation(i, euler_to_quat(glm::vec3(-180 + static_cast<float>(rand()) / RAND_MAX * 360,
+                                                           -90  + static_cast<float>(rand()) / RAND_MAX * 90,
+                                                           -180 + static_cast<float>(rand()) / RAND_MAX * 360)));
+    }
+    for(int i = 0; i < n; i++) {
+        m_store.set_speed(i, m_params.m_forward_speed_min + (m_params.m_forward_speed_max - m_params.m_forward_speed_min) * static_cast<float>(rand()) / RAND_MAX);
+    }
+    m_octree->clear();
+}
+
+void BoidSimulation::clear_agents()
+{
+    m_store.clear();
+    m_octree->clear();
+}
+
+//==========
+// obstacles
+//==========
+
+int BoidSimulation::add_obstacle(glm::vec3 origin, glm::vec3 euler, glm::vec3 min, glm::vec3 max)
+{
+    std::stringstream ss;
+    ss << "obstacle_" << m_obstacles.size();
+    m_obstacles.push_back(new TransformObject(ss.str(), origin, euler));
+    m_obstacle_bboxes.push_back(BBoxObject(min, max));
+    return m_obstacles.size() - 1;
+}
+
+void BoidSimulation::clear_obstacles()
+{
+    for(std::vector<TransformObject*>::iterator p = m_obstacles.begin(); p != m_obstacles.end(); ++p) {
+        delete *p;
+    }
+    m_obstacles.clear();
+    m_obstacle_bboxes.clear();
+}
+
+//=======
+// update
+//=======
+
+// obstacles claim agents first, the flocking kernel takes the rest, then everyone steers and advances
+// NOTE: every pass reads state as of the start of the pass and writes only its own agents --
+//       steering targets are the write buffer for the read-only sensing passes, so results don't
+//       depend on agent order or thread count
+void BoidSimulation::update(float dt)
+{
+    m_tick_scale = dt / SIMULATION_TICK_DT;
+    size_t n     = m_store.size();
+
+    // keep boids in octree
+    parallel_for(PASS_WRAP, n);
+    update_octree();
+    m_neighbors.resize(n * m_params.m_nearest_neighbor_count);
+    m_neighbor_counts.resize(n);
+    parallel_for(PASS_FIND_NEIGHBORS, n);
+
+    // sense
+    snapshot_obstacles();
+    for(int k = 0; k < LIDAR_INDEX_COUNT; k++) {
+        m_local_lidar_dirs[k] = safe_normalize(get_local_lidar_dir(static_cast<lidar_index_t>(k)));
+    }
+    m_lidar_origins.resize(n);
+    m_lidar_dirs.resize(n * LIDAR_INDEX_COUNT);
+    m_lidar_distances.resize(n * LIDAR_INDEX_COUNT);
+    parallel_for(PASS_AVOID_OBSTACLES, n);
+    parallel_for(PASS_FLOCK, n);
+
+    // act
+    int chunk_count = get_chunk_count(n);
+    m_chunk_behavior_counts.resize(chunk_count * BoidStore::BOID_BEHAVIOR_COUNT);
+    m_chunk_heading_sums.resize(chunk_count);
+    m_chunk_collision_counts.resize(chunk_count);
+    parallel_for(PASS_STEER, n);
+    reduce_statistics();
+}
+
+void BoidSimulation::run_pass(int pass, int chunk_index, size_t begin, size_t end, ScratchArena* scratch_arena)
+{
+    switch(pass) {
+        case PASS_WRAP:
+            {
+                glm::vec3 bounds_min, bounds_max;
+                m_bounds.get_min_max(&bounds_min, &bounds_max);
+                m_store.wrap(bounds_min, bounds_max, begin, end);
+            }
+            break;
+        case PASS_FIND_NEIGHBORS:
+            find_neighbors(begin, end, scratch_arena);
+            break;
+        case PASS_AVOID_OBSTACLES:
+            m_store.clear_steering(begin, end);
+            cast_lidar(begin, end);
+            avoid_obstacles(begin, end);
+            break;
+        case PASS_FLOCK:
+            m_store.flock(&m_neighbors[0],
+                          &m_neighbor_counts[0],
+                          m_params.m_nearest_neighbor_count,
+                          m_params,
+                          m_target,
+                          m_tick_scale,
+                          begin,
+                          end);
+            break;
+        case PASS_STEER:
+            m_store.count_behaviors(&m_chunk_behavior_counts[chunk_index * BoidStore::BOID_BEHAVIOR_COUNT], begin, end);
+            m_store.steer(begin, end);
+            m_store.advance(m_tick_scale, begin, end);
+            m_chunk_collision_counts[chunk_index] = collide_obstacles(begin, end, scratch_arena);
+            m_chunk_heading_sums[chunk_index]     = m_store.sum_headings(begin, end);
+            break;
+    }
+}
+
+// chunk order is fixed by agent count alone
+void BoidSimulation::reduce_statistics()
+{
+    for(int k = 0; k < BoidStore::BOID_BEHAVIOR_COUNT; k++) {
+        m_behavior_counts[k] = 0;
+    }
+    glm::vec3 heading_sum(0);
+    m_collision_count = 0;
+    int chunk_count = m_chunk_heading_sums.size();
+    for(int i = 0; i < chunk_count; i++) {
+        for(int k = 0; k < BoidStore::BOID_BEHAVIOR_COUNT; k++) {
+            m_behavior_counts[k] += m_chunk_behavior_counts[i * BoidStore::BOID_BEHAVIOR_COUNT + k];
+        }
+        heading_sum       += m_chunk_heading_sums[i];
+        m_collision_count += m_chunk_collision_counts[i];
+    }
+    int n = m_store.size();
+    m_polarization = n ? glm::length(heading_sum) / n : 0;
+}
+
+void BoidSimulation::update_octree()
+{
+    long n = m_store.size();
+    for(long index = 0; index < n; index++) {
+        glm::vec3 agent_pos = m_store.get_origin(index);
+
+        // add/update
+        if(m_octree->exists(index)) {
+            m_octree->move(index, agent_pos);
+        } else {
+            m_octree->insert(index, agent_pos);
+        }
+    }
+
+    // rebalance
+    m_octree->rebalance();
+}
+
+// resolve obstacle transforms and inverses once per step so lidar passes only ever read them
+// NOTE: bounds stay out of the bvh -- every agent is inside them, so every ray visits them anyway
+void BoidSimulation::snapshot_obstacles()
+{
+    m_obstacle_bvh->clear();
+    int obstacle_count = m_obstacles.size();
+    for(int i = 0; i < obstacle_count; i++) {
+        glm::vec3 obstacle_min, obstacle_max;
+        m_obstacle_bboxes[i].get_min_max(&obstacle_min, &obstacle_max);
+        m_obstacle_bvh->add(m_obstacles[i]->get_transform(),
+                            m_obstacles[i]->get_inverse_transform(),
+                            obstacle_min,
+                            obstacle_max);
+    }
+    m_obstacle_bvh->build();
+    m_bounds_inverse_transform = m_bounds_object->get_inverse_transform();
+}
+
+// fixed-stride neighbor table for the flocking kernel -- queries write straight into it
+void BoidSimulation::find_neighbors(size_t begin, size_t end, ScratchArena* scratch_arena)
+{
+    int    stride          = m_params.m_nearest_neighbor_count;
+    float* nearest_k_dists = scratch_arena->alloc<float>(stride);
+    for(size_t i = begin; i < end; i++) {
+        m_neighbor_counts[i] = m_octree->find(m_store.get_origin(i),
+                                              stride,
+                                              &m_neighbors[i * stride],
+                                              nearest_k_dists,
+                                              m_params.m_nearest_neighbor_radius);
+    }
+}
+
+// unnormalized -- scaling by a lidar reading lands on the reading's debug line endpoint
+glm::vec3 BoidSimulation::get_local_lidar_dir(lidar_index_t lidar_index) const
+{
+    float lateral_offset = tan(glm::radians(m_params.m_lidar_fov));
+    switch(lidar_index) {
+        case LIDAR_INDEX_UP:    return glm::vec3(0, lateral_offset, 1);
+        case LIDAR_INDEX_LEFT:  return glm::vec3(lateral_offset * cos(glm::radians(210.0f)), lateral_offset * sin(glm::radians(210.0f)), 1);
+        case LIDAR_INDEX_RIGHT: return glm::vec3(lateral_offset * cos(glm::radians(330.0f)), lateral_offset * sin(glm::radians(330.0f)), 1);
+        default:
+            break;
+    }
+    return VEC_FORWARD;
+}
+
+// all of a chunk's ray bundles go through the bvh in one batch
+void BoidSimulation::cast_lidar(size_t begin, size_t end)
+{
+    glm::vec3 bounds_min, bounds_max;
+    m_bounds.get_min_max(&bounds_min, &bounds_max);
+    for(size_t i = begin; i < end; i++) {
+        glm::vec3 agent_pos = m_store.get_origin(i);
+        glm::mat3 basis(m_store.get_left_direction(i),
+                        m_store.get_up_direction(i),
+                        m_store.get_heading(i));
+        m_lidar_origins[i] = agent_pos;
+        for(int k = 0; k < LIDAR_INDEX_COUNT; k++) {
+            glm::vec3 ray_dir = basis * m_local_lidar_dirs[k];
+            m_lidar_dirs[i * LIDAR_INDEX_COUNT + k]      = ray_dir;
+            m_lidar_distances[i * LIDAR_INDEX_COUNT + k] = ray_box_distance(m_bounds_inverse_transform,
+                                                                            bounds_min,
+                                                                            bounds_max,
+                                                                            agent_pos,
+                                                                            ray_dir); // tightest seed
+        }
+    }
+    m_obstacle_bvh->cast_ray_bundles(&m_lidar_origins[begin],
+                                     &m_lidar_dirs[begin * LIDAR_INDEX_COUNT],
+                                     LIDAR_INDEX_COUNT,
+                                     &m_lidar_distances[begin * LIDAR_INDEX_COUNT],
+                                     end - begin);
+}
+
+void BoidSimulation::avoid_obstacles(size_t begin, size_t end)
+{
+    float seek_cos = cos(glm::radians(m_params.m_angle_delta * m_tick_scale));
+    float seek_sin = sin(glm::radians(m_params.m_angle_delta * m_tick_scale));
+
+    for(size_t i = begin; i < end; i++) {
+        glm::vec3 agent_pos = m_lidar_origins[i];
+
+        glm::vec3 nearest_obstacles[LIDAR_INDEX_COUNT];
+        for(int k = 0; k < LIDAR_INDEX_COUNT; k++) {
+            nearest_obstacles[k] = agent_pos + m_lidar_dirs[i * LIDAR_INDEX_COUNT + k] * m_lidar_distances[i * LIDAR_INDEX_COUNT + k];
+        }
+
+        // obstacle normal
+        glm::vec3 nearest_obstacle_ahead  = nearest_obstacles[LIDAR_INDEX_FORWARD];
+        glm::vec3 nearest_obstacle_up     = nearest_obstacles[LIDAR_INDEX_UP];
+        glm::vec3 nearest_obstacle_left   = nearest_obstacles[LIDAR_INDEX_LEFT];
+        glm::vec3 nearest_obstacle_right  = nearest_obstacles[LIDAR_INDEX_RIGHT];
+        glm::vec3 nearest_obstacle_normal = safe_normalize(glm::cross(nearest_obstacle_right - nearest_obstacle_up, nearest_obstacle_left - nearest_obstacle_up));
+
+        if(glm::distance(agent_pos, nearest_obstacle_ahead) < m_params.m_obstacle_reverse_radius) {
+            // avoid head-on collision with obstacle
+            m_store.reverse(i);
+        } else if(glm::distance(agent_pos, nearest_obstacle_up)    < m_params.m_obstacle_avoid_radius ||
+                  glm::distance(agent_pos, nearest_obstacle_left)  < m_params.m_obstacle_avoid_radius ||
+                  glm::distance(agent_pos, nearest_obstacle_right) < m_params.m_obstacle_avoid_radius)
+        {
+            // avoid glancing collision with obstacle
+            // explore deepest LIDAR reading direction
+            glm::vec3 target = nearest_obstacle_ahead + nearest_obstacle_normal;
+            bool      avoid  = glm::distance(target, agent_pos) < m_params.m_avoid_radius;
+            m_store.set_steering(i,
+                                 BoidStore::BOID_BEHAVIOR_AVOID_OBSTACLE,
+                                 target,
+                                 seek_cos,
+                                 avoid ? -seek_sin : seek_sin); // target homing
+        }
+    }
+}
+
+// continuous collision -- each move is swept against the obstacle snapshot and cut short at first contact,
+// so thin obstacles can't be tunneled through however large the step
+// NOTE: lidar origins are where agents stood before advancing (steering never moves an agent)
+int BoidSimulation::collide_obstacles(size_t begin, size_t end, ScratchArena* scratch_arena)
+{
+    if(!m_obstacle_bvh->size()) {
+        return 0;
+    }
+    size_t     count        = end - begin;
+    glm::vec3* next_origins = scratch_arena->alloc<glm::vec3>(count);
+    float*     hit_ts       = scratch_arena->alloc<float>(count);
+    glm::vec3* hit_normals  = scratch_arena->alloc<glm::vec3>(count);
+    for(size_t j = 0; j < count; j++) {
+        next_origins[j] = m_store.get_origin(begin + j);
+    }
+    int hit_count = m_obstacle_bvh->sweep_spheres(&m_lidar_origins[begin],
+                                                  next_origins,
+                                                  m_params.m_collision_radius,
+                                                  hit_ts,
+                                                  hit_normals,
+                                                  count);
+    if(!hit_count) {
+        return 0;
+    }
+    for(size_t j = 0; j < count; j++) {
+        if(hit_ts[j] >= 1) {
+            continue;
+        }
+        glm::vec3 prev_origin = m_lidar_origins[begin + j];
+        glm::vec3 contact     = prev_origin + (next_origins[j] - prev_origin) * hit_ts[j];
+        m_store.set_origin(begin + j, contact + hit_normals[j] * BOID_COLLISION_SKIN); // stay clear of the face for the next sweep
+    }
+    return hit_count;
+}
+
+//====================
+// guide wires (debug)
+//====================
+
+void BoidSimulation::get_agent_debug_lines(int                                                              index,
+                                           std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3, float>>* debug_lines) const
+{
+    debug_lines->clear();
+    glm::vec3 agent_pos = m_store.get_origin(index);
+    if(index * LIDAR_INDEX_COUNT < static_cast<int>(m_lidar_distances.size())) {
+        glm::mat3 basis(m_store.get_left_direction(index),
+                        m_store.get_up_direction(index),
+                        m_store.get_heading(index));
+        for(int k = LIDAR_INDEX_UP; k < LIDAR_INDEX_COUNT; k++) {
+            glm::vec3 local_lidar_dir = get_local_lidar_dir(static_cast<lidar_index_t>(k));
+            debug_lines->push_back(std::make_tuple(agent_pos,
+                                                   agent_pos + basis * (local_lidar_dir * m_lidar_distances[index * LIDAR_INDEX_COUNT + k]),
+                                                   glm::vec3(0, 1, 1),
+                                                   1));
+        }
+    }
+    if(index < static_cast<int>(m_neighbor_counts.size())) {
+        int stride = m_params.m_nearest_neighbor_count;
+        for(int j = 0; j < m_neighbor_counts[index]; j++) {
+            int other_index = m_neighbors[index * stride + j];
+            if(m_store.is_flocking_neighbor(index, other_index, m_params)) {
+                debug_lines->push_back(std::make_tuple(agent_pos, m_store.get_origin(other_index), glm::vec3(1, 1, 0), 1));
+            }
+        }
+    }
+}
+
+}
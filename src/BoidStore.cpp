@@ -0,0 +1,478 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <BoidStore.h>
+#include <Util.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <math.h>
+
+namespace vt {
+
+BoidParams::BoidParams()
+    : m_avoid_radius(0.25f),
+      m_flocking_radius(4),
+      m_nearest_neighbor_radius(2),
+      m_nearest_neighbor_count(5),
+      m_obstacle_avoid_radius(2),
+      m_obstacle_reverse_radius(1),
+      m_angle_delta(2.5f),
+      m_avoid_angle_delta(5.0f),
+      m_cohesion_to_alignment_ratio(0.25f),
+      m_max_heading_deviation(90),
+      m_max_fov_deviation(180),
+      m_forward_speed_min(0.025f),
+      m_forward_speed_max(0.05f),
+      m_lidar_fov(15.0f),
+      m_collision_radius(0.03125f)
+{
+}
+
+BoidStore::BoidStore()
+{
+}
+
+BoidStore::~BoidStore()
+{
+}
+
+//=======
+// agents
+//=======
+
+int BoidStore::add(glm::vec3 origin, glm::quat orientation, float speed)
+{
+    glm::vec3 heading      = orientation * VEC_FORWARD;
+    glm::vec3 up_direction = orientation * VEC_UP;
+    m_origin_x.push_back(origin.x);
+    m_origin_y.push_back(origin.y);
+    m_origin_z.push_back(origin.z);
+    m_heading_x.push_back(heading.x);
+    m_heading_y.push_back(heading.y);
+    m_heading_z.push_back(heading.z);
+    m_up_x.push_back(up_direction.x);
+    m_up_y.push_back(up_direction.y);
+    m_up_z.push_back(up_direction.z);
+    m_speeds.push_back(speed);
+    m_target_x.push_back(origin.x);
+    m_target_y.push_back(origin.y);
+    m_target_z.push_back(origin.z);
+    m_turn_cos.push_back(1);
+    m_turn_sin.push_back(0);
+    m_behaviors.push_back(BOID_BEHAVIOR_NONE);
+    return m_origin_x.size() - 1;
+}
+
+void BoidStore::clear()
+{
+    m_origin_x.clear();
+    m_origin_y.clear();
+    m_origin_z.clear();
+    m_heading_x.clear();
+    m_heading_y.clear();
+    m_heading_z.clear();
+    m_up_x.clear();
+    m_up_y.clear();
+    m_up_z.clear();
+    m_speeds.clear();
+    m_target_x.clear();
+    m_target_y.clear();
+    m_target_z.clear();
+    m_turn_cos.clear();
+    m_turn_sin.clear();
+    m_behaviors.clear();
+}
+
+glm::vec3 BoidStore::get_origin(int index) const
+{
+    return glm::vec3(m_origin_x[index], m_origin_y[index], m_origin_z[index]);
+}
+
+void BoidStore::set_origin(int index, glm::vec3 origin)
+{
+    m_origin_x[index] = origin.x;
+    m_origin_y[index] = origin.y;
+    m_origin_z[index] = origin.z;
+}
+
+glm::vec3 BoidStore::get_heading(int index) const
+{
+    return glm::vec3(m_heading_x[index], m_heading_y[index], m_heading_z[index]);
+}
+
+glm::vec3 BoidStore::get_up_direction(int index) const
+{
+    return glm::vec3(m_up_x[index], m_up_y[index], m_up_z[index]);
+}
+
+glm::vec3 BoidStore::get_left_direction(int index) const
+{
+    return glm::cross(get_up_direction(index), get_heading(index));
+}
+
+// columns are the local left/up/forward axes in world space
+glm::quat BoidStore::get_orientation(int index) const
+{
+    return glm::quat_cast(glm::mat3(get_left_direction(index),
+                                    get_up_direction(index),
+                                    get_heading(index)));
+}
+
+void BoidStore::set_orientation(int index, glm::quat orientation)
+{
+    glm::vec3 heading      = orientation * VEC_FORWARD;
+    glm::vec3 up_direction = orientation * VEC_UP;
+    m_heading_x[index] = heading.x;
+    m_heading_y[index] = heading.y;
+    m_heading_z[index] = heading.z;
+    m_up_x[index]      = up_direction.x;
+    m_up_y[index]      = up_direction.y;
+    m_up_z[index]      = up_direction.z;
+}
+
+//=========
+// steering
+//=========
+
+void BoidStore::set_steering(int             index,
+                             boid_behavior_t behavior,
+                             glm::vec3       target,
+                             float           turn_cos,
+                             float           turn_sin)
+{
+    m_behaviors[index] = behavior;
+    m_target_x[index]  = target.x;
+    m_target_y[index]  = target.y;
+    m_target_z[index]  = target.z;
+    m_turn_cos[index]  = turn_cos;
+    m_turn_sin[index]  = turn_sin;
+}
+
+// deferred to steer so neighbors still see this step's heading
+void BoidStore::reverse(int index)
+{
+    set_steering(index, BOID_BEHAVIOR_REVERSE, get_origin(index) - get_heading(index), -1, 0);
+}
+
+//========
+// kernels
+//========
+
+// same rule as BBoxObject::wrap
+void BoidStore::wrap(glm::vec3 min, glm::vec3 max, size_t begin, size_t end)
+{
+    float* origin_x = &m_origin_x[0];
+    float* origin_y = &m_origin_y[0];
+    float* origin_z = &m_origin_z[0];
+    for(size_t i = begin; i < end; i++) {
+        float x = origin_x[i];
+        float y = origin_y[i];
+        float z = origin_z[i];
+        x = (x < min.x) ? max.x : ((x > max.x) ? min.x : x);
+        y = (y < min.y) ? max.y : ((y > max.y) ? min.y : y);
+        z = (z < min.z) ? max.z : ((z > max.z) ? min.z : z);
+        origin_x[i] = x;
+        origin_y[i] = y;
+        origin_z[i] = z;
+    }
+}
+
+void BoidStore::clear_steering(size_t begin, size_t end)
+{
+    float* turn_cos  = &m_turn_cos[0];
+    float* turn_sin  = &m_turn_sin[0];
+    int*   behaviors = &m_behaviors[0];
+    for(size_t i = begin; i < end; i++) {
+        turn_cos[i]  = 1;
+        turn_sin[i]  = 0;
+        behaviors[i] = BOID_BEHAVIOR_NONE;
+    }
+}
+
+// separation, then cohesion & alignment, then target homing, then wander
+// only agents not already claimed this step (BOID_BEHAVIOR_NONE) are considered
+void BoidStore::flock(const long*       neighbors,
+                      const int*        neighbor_counts,
+                      int               neighbor_stride,
+                      const BoidParams &params,
+                      glm::vec3         target,
+                      float             tick_scale,
+                      size_t            begin,
+                      size_t            end)
+{
+    const float* origin_x  = &m_origin_x[0];
+    const float* origin_y  = &m_origin_y[0];
+    const float* origin_z  = &m_origin_z[0];
+    const float* heading_x = &m_heading_x[0];
+    const float* heading_y = &m_heading_y[0];
+    const float* heading_z = &m_heading_z[0];
+    float*       target_x  = &m_target_x[0];
+    float*       target_y  = &m_target_y[0];
+    float*       target_z  = &m_target_z[0];
+    float*       turn_cos  = &m_turn_cos[0];
+    float*       turn_sin  = &m_turn_sin[0];
+    int*         behaviors = &m_behaviors[0];
+
+    // angle tests become dot product tests
+    float min_heading_dot = cos(glm::radians(params.m_max_heading_deviation));
+    float min_fov_dot     = cos(glm::radians(params.m_max_fov_deviation));
+    float seek_cos        = cos(glm::radians(params.m_angle_delta       * tick_scale));
+    float seek_sin        = sin(glm::radians(params.m_angle_delta       * tick_scale));
+    float avoid_cos       = cos(glm::radians(params.m_avoid_angle_delta * tick_scale));
+    float avoid_sin       = sin(glm::radians(params.m_avoid_angle_delta * tick_scale));
+    float avoid_radius_sq    = params.m_avoid_radius    * params.m_avoid_radius;
+    float flocking_radius_sq = params.m_flocking_radius * params.m_flocking_radius;
+    float ratio              = params.m_cohesion_to_alignment_ratio;
+
+    for(size_t i = begin; i < end; i++) {
+        if(behaviors[i] != BOID_BEHAVIOR_NONE) {
+            continue;
+        }
+        float px = origin_x[i];
+        float py = origin_y[i];
+        float pz = origin_z[i];
+        float hx = heading_x[i];
+        float hy = heading_y[i];
+        float hz = heading_z[i];
+
+        // collect stats
+        const long* nearest_k = &neighbors[i * neighbor_stride];
+        int         count     = neighbor_counts[i];
+        float cx = 0, cy = 0, cz = 0;
+        float ax = 0, ay = 0, az = 0;
+        float valid_neighbor_count = 0;
+        for(int j = 0; j < count; j++) {
+            long q = nearest_k[j];
+            float dx = origin_x[q] - px;
+            float dy = origin_y[q] - py;
+            float dz = origin_z[q] - pz;
+            float dist        = sqrt(dx * dx + dy * dy + dz * dz);
+            float heading_dot = hx * heading_x[q] + hy * heading_y[q] + hz * heading_z[q];
+            float fov_dot     = (dist > EPSILON) ? (hx * dx + hy * dy + hz * dz) / dist : 0;
+            float valid       = (q != static_cast<long>(i) && heading_dot > min_heading_dot && fov_dot > min_fov_dot) ? 1 : 0;
+            cx += origin_x[q]  * valid;
+            cy += origin_y[q]  * valid;
+            cz += origin_z[q]  * valid;
+            ax += heading_x[q] * valid;
+            ay += heading_y[q] * valid;
+            az += heading_z[q] * valid;
+            valid_neighbor_count += valid;
+        }
+
+        if(count >= 2) {
+            long  q  = nearest_k[1];
+            float dx = origin_x[q] - px;
+            float dy = origin_y[q] - py;
+            float dz = origin_z[q] - pz;
+            if(dx * dx + dy * dy + dz * dz < avoid_radius_sq) {
+                target_x[i]  = origin_x[q];
+                target_y[i]  = origin_y[q];
+                target_z[i]  = origin_z[q];
+                turn_cos[i]  = avoid_cos;
+                turn_sin[i]  = -avoid_sin; // separation
+                behaviors[i] = BOID_BEHAVIOR_SEPARATION;
+                continue;
+            }
+            if(valid_neighbor_count) {
+                float contrib_factor = 1.0f / valid_neighbor_count;
+                float centroid_x = cx * contrib_factor;
+                float centroid_y = cy * contrib_factor;
+                float centroid_z = cz * contrib_factor;
+                float average_heading_x = px + ax * contrib_factor;
+                float average_heading_y = py + ay * contrib_factor;
+                float average_heading_z = pz + az * contrib_factor;
+                target_x[i]  = MIX(centroid_x, average_heading_x, ratio);
+                target_y[i]  = MIX(centroid_y, average_heading_y, ratio);
+                target_z[i]  = MIX(centroid_z, average_heading_z, ratio);
+                turn_cos[i]  = seek_cos;
+                turn_sin[i]  = seek_sin; // cohesion & alignment
+                behaviors[i] = BOID_BEHAVIOR_FLOCKING;
+                continue;
+            }
+        }
+
+        float dx = target.x - px;
+        float dy = target.y - py;
+        float dz = target.z - pz;
+        float dist_sq = dx * dx + dy * dy + dz * dz;
+        if(dist_sq < flocking_radius_sq) {
+            target_x[i]  = target.x;
+            target_y[i]  = target.y;
+            target_z[i]  = target.z;
+            turn_cos[i]  = seek_cos;
+            turn_sin[i]  = (dist_sq < avoid_radius_sq) ? -seek_sin : seek_sin; // target homing
+            behaviors[i] = BOID_BEHAVIOR_HOMING;
+            continue;
+        }
+        behaviors[i] = BOID_BEHAVIOR_WANDER;
+    }
+}
+
+// turn-rate-limited steering -- rotate heading (and up direction with it) toward the target
+// by at most the turn angle, snapping onto the target direction if it is closer than that
+void BoidStore::steer(size_t begin, size_t end)
+{
+    const float* origin_x  = &m_origin_x[0];
+    const float* origin_y  = &m_origin_y[0];
+    const float* origin_z  = &m_origin_z[0];
+    const float* target_x  = &m_target_x[0];
+    const float* target_y  = &m_target_y[0];
+    const float* target_z  = &m_target_z[0];
+    const float* turn_cos  = &m_turn_cos[0];
+    const float* turn_sin  = &m_turn_sin[0];
+    float*       heading_x = &m_heading_x[0];
+    float*       heading_y = &m_heading_y[0];
+    float*       heading_z = &m_heading_z[0];
+    float*       up_x      = &m_up_x[0];
+    float*       up_y      = &m_up_y[0];
+    float*       up_z      = &m_up_z[0];
+    for(size_t i = begin; i < end; i++) {
+        float hx = heading_x[i];
+        float hy = heading_y[i];
+        float hz = heading_z[i];
+        float ux = up_x[i];
+        float uy = up_y[i];
+        float uz = up_z[i];
+
+        // direction to target
+        float dx  = target_x[i] - origin_x[i];
+        float dy  = target_y[i] - origin_y[i];
+        float dz  = target_z[i] - origin_z[i];
+        float len = sqrt(dx * dx + dy * dy + dz * dz);
+        float inv_len = (len > EPSILON) ? 1 / len : 0;
+        dx = (len > EPSILON) ? dx * inv_len : hx;
+        dy = (len > EPSILON) ? dy * inv_len : hy;
+        dz = (len > EPSILON) ? dz * inv_len : hz;
+
+        // unit direction perpendicular to heading, toward target (left direction if target is dead ahead/behind)
+        // NOTE: turning about the up direction keeps it fixed -- a reversal is a 180 degree turn with c/s of -1/0
+        float cos_to = hx * dx + hy * dy + hz * dz;
+        float rx     = dx - hx * cos_to;
+        float ry     = dy - hy * cos_to;
+        float rz     = dz - hz * cos_to;
+        float sin_to = sqrt(rx * rx + ry * ry + rz * rz);
+        float inv_sin_to = (sin_to > EPSILON) ? 1 / sin_to : 0;
+        rx = (sin_to > EPSILON) ? rx * inv_sin_to : uy * hz - uz * hy;
+        ry = (sin_to > EPSILON) ? ry * inv_sin_to : uz * hx - ux * hz;
+        rz = (sin_to > EPSILON) ? rz * inv_sin_to : ux * hy - uy * hx;
+
+        // turn angle
+        float c    = turn_cos[i];
+        float s    = turn_sin[i];
+        bool  snap = (s > 0) && (cos_to >= c);
+        c = snap ? cos_to : c;
+        s = snap ? sin_to : s;
+
+        // rotate about axis = heading x perpendicular
+        float axis_x = hy * rz - hz * ry;
+        float axis_y = hz * rx - hx * rz;
+        float axis_z = hx * ry - hy * rx;
+        float new_hx = hx * c + rx * s;
+        float new_hy = hy * c + ry * s;
+        float new_hz = hz * c + rz * s;
+        float axis_dot_up = axis_x * ux + axis_y * uy + axis_z * uz;
+        float axis_cross_up_x = axis_y * uz - axis_z * uy;
+        float axis_cross_up_y = axis_z * ux - axis_x * uz;
+        float axis_cross_up_z = axis_x * uy - axis_y * ux;
+        float new_ux = ux * c + axis_cross_up_x * s + axis_x * axis_dot_up * (1 - c);
+        float new_uy = uy * c + axis_cross_up_y * s + axis_y * axis_dot_up * (1 - c);
+        float new_uz = uz * c + axis_cross_up_z * s + axis_z * axis_dot_up * (1 - c);
+
+        // re-orthonormalize against drift
+        float inv_h = 1 / sqrt(new_hx * new_hx + new_hy * new_hy + new_hz * new_hz);
+        new_hx *= inv_h;
+        new_hy *= inv_h;
+        new_hz *= inv_h;
+        float up_dot_h = new_ux * new_hx + new_uy * new_hy + new_uz * new_hz;
+        new_ux -= new_hx * up_dot_h;
+        new_uy -= new_hy * up_dot_h;
+        new_uz -= new_hz * up_dot_h;
+        float inv_u = 1 / sqrt(new_ux * new_ux + new_uy * new_uy + new_uz * new_uz);
+
+        heading_x[i] = new_hx;
+        heading_y[i] = new_hy;
+        heading_z[i] = new_hz;
+        up_x[i]      = new_ux * inv_u;
+        up_y[i]      = new_uy * inv_u;
+        up_z[i]      = new_uz * inv_u;
+    }
+}
+
+void BoidStore::advance(float tick_scale, size_t begin, size_t end)
+{
+    const float* heading_x = &m_heading_x[0];
+    const float* heading_y = &m_heading_y[0];
+    const float* heading_z = &m_heading_z[0];
+    const float* speeds    = &m_speeds[0];
+    const int*   behaviors = &m_behaviors[0];
+    float*       origin_x  = &m_origin_x[0];
+    float*       origin_y  = &m_origin_y[0];
+    float*       origin_z  = &m_origin_z[0];
+    for(size_t i = begin; i < end; i++) {
+        float distance = (behaviors[i] == BOID_BEHAVIOR_REVERSE) ? 0 : speeds[i] * tick_scale;
+        origin_x[i] += heading_x[i] * distance;
+        origin_y[i] += heading_y[i] * distance;
+        origin_z[i] += heading_z[i] * distance;
+    }
+}
+
+//===========
+// statistics
+//===========
+
+// partial sums over [begin, end) -- callers reduce chunks in a fixed order
+glm::vec3 BoidStore::sum_headings(size_t begin, size_t end) const
+{
+    float sum_x = 0, sum_y = 0, sum_z = 0;
+    for(size_t i = begin; i < end; i++) {
+        sum_x += m_heading_x[i];
+        sum_y += m_heading_y[i];
+        sum_z += m_heading_z[i];
+    }
+    return glm::vec3(sum_x, sum_y, sum_z);
+}
+
+void BoidStore::count_behaviors(int* behavior_counts, size_t begin, size_t end) const
+{
+    for(int k = 0; k < BOID_BEHAVIOR_COUNT; k++) {
+        behavior_counts[k] = 0;
+    }
+    for(size_t i = begin; i < end; i++) {
+        behavior_counts[m_behaviors[i]]++;
+    }
+}
+
+//====================
+// guide wires (debug)
+//====================
+
+bool BoidStore::is_flocking_neighbor(int index, int other_index, const BoidParams &params) const
+{
+    if(index == other_index) {
+        return false;
+    }
+    glm::vec3 heading   = get_heading(index);
+    glm::vec3 other_dir = get_origin(other_index) - get_origin(index);
+    float     dist      = glm::length(other_dir);
+    float     fov_dot   = (dist > EPSILON) ? glm::dot(heading, other_dir) / dist : 0;
+    return glm::dot(heading, get_heading(other_index)) > cos(glm::radians(params.m_max_heading_deviation)) &&
+           fov_dot                                     > cos(glm::radians(params.m_max_fov_deviation));
+}
+
+}
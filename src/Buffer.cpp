@@ -41,6 +41,16 @@ void Buffer::update()
     glBufferData(m_target, m_size, m_data, GL_DYNAMIC_DRAW);
 }
 
+// orphan the old storage so the driver needn't wait on draws still reading it
+void Buffer::update(size_t size, void* data)
+{
+    m_size = size;
+    m_data = data;
+    bind();
+    glBufferData(m_target, m_size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(m_target, 0, m_size, m_data);
+}
+
 void Buffer::bind()
 {
     glBindBuffer(m_target, m_id);
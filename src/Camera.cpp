@@ -55,6 +55,7 @@ Camera::Camera(const std::string&      name,
       m_projection_mode(projection_mode),
       m_frame_buffer(NULL)
 {
+    m_transform_kind = TRANSFORM_KIND_CUSTOM; // lookAt view
     mark_dirty_transform();
 }
 
@@ -64,35 +65,35 @@ Camera::~Camera()
 
 void Camera::set_origin(glm::vec3 origin)
 {
-    m_origin = origin;
-    m_euler  = offset_to_euler(m_target - m_origin);
+    *m_origin = origin;
+    m_euler   = offset_to_euler(m_target - *m_origin);
     mark_dirty_transform();
 }
 
 void Camera::set_euler(glm::vec3 euler)
 {
     m_euler  = euler;
-    m_target = m_origin + euler_to_offset(euler);
+    m_target = *m_origin + euler_to_offset(euler);
     mark_dirty_transform();
 }
 
 void Camera::set_target(glm::vec3 target)
 {
     m_target = target;
-    m_euler  = offset_to_euler(m_target - m_origin);
+    m_euler  = offset_to_euler(m_target - *m_origin);
     mark_dirty_transform();
 }
 
 const glm::vec3 Camera::get_dir() const
 {
-    return safe_normalize(m_target - m_origin);
+    return safe_normalize(m_target - *m_origin);
 }
 
 void Camera::move(glm::vec3 origin, glm::vec3 target)
 {
-    m_origin = origin;
-    m_target = target;
-    m_euler  = offset_to_euler(m_target - m_origin);
+    *m_origin = origin;
+    m_target  = target;
+    m_euler   = offset_to_euler(m_target - *m_origin);
     mark_dirty_transform();
 }
 
@@ -113,8 +114,8 @@ void Camera::orbit(glm::vec3 &euler, float &radius)
     if(radius < 0) {
         radius = 0;
     }
-    m_euler  = euler;
-    m_origin = m_target + euler_to_offset(euler) * radius;
+    m_euler   = euler;
+    *m_origin = m_target + euler_to_offset(euler) * radius;
     mark_dirty_transform();
 }
 
@@ -219,10 +220,10 @@ void Camera::update_transform()
 {
     glm::vec3 up_direction;
     euler_to_offset(m_euler, &up_direction);
-    if(glm::distance(m_origin, m_target) < EPSILON) {
+    if(glm::distance(*m_origin, m_target) < EPSILON) {
         return;
     }
-    m_transform = glm::lookAt(m_origin, m_target, up_direction);
+    *m_transform = glm::lookAt(*m_origin, m_target, up_direction);
 }
 
 }
@@ -0,0 +1,430 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <IKBatch.h>
+#include <KinematicChain.h>
+#include <Util.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+
+// every kernel below is a fixed-trip-count loop over lanes with no cross-lane dependencies,
+// so the compiler maps each one onto SSE (4-wide) or AVX (8-wide) registers
+#define LANES IK_BATCH_LANES
+
+namespace vt {
+
+typedef float lanes_t[LANES];
+
+// polynomial sine/cosine -- unlike sinf/cosf these stay inside the vectorized loop
+static inline float sin_poly(float x)
+{
+    const float two_pi = 6.28318531f;
+    const float pi     = 3.14159265f;
+    const float half   = 1.57079633f;
+    x = x - two_pi * floorf(x * (1 / two_pi) + 0.5f); // [-pi, pi]
+    x = (x >  half) ? ( pi - x) : x;                   // [-pi/2, pi/2]
+    x = (x < -half) ? (-pi - x) : x;
+    float x2 = x * x;
+    return x * (1 + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880 + x2 * (-1.0f / 39916800))))));
+}
+
+static inline void sincos_lanes(const float* x, float* s, float* c)
+{
+    for(int l = 0; l < LANES; l++) {
+        s[l] = sin_poly(x[l]);
+        c[l] = sin_poly(x[l] + 1.57079633f);
+    }
+}
+
+// r = r * m -- r is a per-lane 3x3 (row-major), m is shared by all lanes
+static inline void mul_shared(lanes_t* r, const glm::mat3 &m)
+{
+    lanes_t out[9];
+    for(int i = 0; i < 3; i++) {
+        for(int k = 0; k < 3; k++) {
+            float m0 = m[k][0];
+            float m1 = m[k][1];
+            float m2 = m[k][2];
+            for(int l = 0; l < LANES; l++) {
+                out[i * 3 + k][l] = r[i * 3][l] * m0 + r[i * 3 + 1][l] * m1 + r[i * 3 + 2][l] * m2;
+            }
+        }
+    }
+    memcpy(r, out, sizeof(out));
+}
+
+// r = r * m -- both per-lane 3x3 (row-major)
+static inline void mul_lanes(lanes_t* r, const lanes_t* m)
+{
+    lanes_t out[9];
+    for(int i = 0; i < 3; i++) {
+        for(int k = 0; k < 3; k++) {
+            for(int l = 0; l < LANES; l++) {
+                out[i * 3 + k][l] = r[i * 3][l] * m[k][l] + r[i * 3 + 1][l] * m[3 + k][l] + r[i * 3 + 2][l] * m[6 + k][l];
+            }
+        }
+    }
+    memcpy(r, out, sizeof(out));
+}
+
+// out = r * v -- v is shared by all lanes
+static inline void transform_shared(const lanes_t* r, glm::vec3 v, float* x, float* y, float* z)
+{
+    for(int l = 0; l < LANES; l++) {
+        x[l] = r[0][l] * v.x + r[1][l] * v.y + r[2][l] * v.z;
+        y[l] = r[3][l] * v.x + r[4][l] * v.y + r[5][l] * v.z;
+        z[l] = r[6][l] * v.x + r[7][l] * v.y + r[8][l] * v.z;
+    }
+}
+
+IKBatch::IKBatch(const KinematicChain &layout)
+    : m_joint_count(layout.size()),
+      m_base_rotation(glm::mat3(layout.get_base_transform())),
+      m_base_origin(glm::vec3(layout.get_base_transform()[3])),
+      m_local_end_effector_tip(layout.get_local_end_effector_tip()),
+      m_count(0),
+      m_stride(0)
+{
+    for(int j = 0; j < m_joint_count; j++) {
+        bool  is_revolute = (layout.get_joint_type(j) == KinematicChain::JOINT_TYPE_REVOLUTE);
+        float unit_scale  = is_revolute ? glm::radians(1.0f) : 1;
+        m_types.push_back(layout.get_joint_type(j));
+        m_offsets.push_back(layout.get_offset(j));
+        m_axes.push_back(layout.get_axis(j));
+        m_pre_rotations.push_back(glm::mat3_cast(layout.get_pre_orientation(j)));
+        m_post_rotations.push_back(glm::mat3_cast(layout.get_post_orientation(j)));
+        m_enable_limits.push_back(layout.has_limits(j));
+        m_min_values.push_back(layout.get_min_value(j) * unit_scale);
+        m_max_values.push_back(layout.get_max_value(j) * unit_scale);
+        m_rest_values.push_back(layout.get_value(j) * unit_scale);
+    }
+}
+
+IKBatch::~IKBatch()
+{
+}
+
+//==========
+// instances
+//==========
+
+void IKBatch::resize(size_t count)
+{
+    size_t stride = ((count + LANES - 1) / LANES) * LANES;
+    std::vector<float> values(m_joint_count * stride);
+    for(int j = 0; j < m_joint_count; j++) {
+        for(size_t i = 0; i < stride; i++) {
+            values[j * stride + i] = (i < m_count) ? m_values[j * m_stride + i] : m_rest_values[j];
+        }
+    }
+    m_values.swap(values);
+    m_target_x.resize(stride, 0);
+    m_target_y.resize(stride, 0);
+    m_target_z.resize(stride, 0);
+    m_residuals.resize(stride, 0);
+    m_is_converged.resize(stride, false);
+    m_count  = count;
+    m_stride = stride;
+}
+
+void IKBatch::reset_values()
+{
+    for(int j = 0; j < m_joint_count; j++) {
+        std::fill(m_values.begin() + j * m_stride, m_values.begin() + (j + 1) * m_stride, m_rest_values[j]);
+    }
+}
+
+// lets one batch follow a chain whose parent moves between solves
+void IKBatch::set_base_transform(glm::mat4 base_transform)
+{
+    m_base_rotation = glm::mat3(base_transform);
+    m_base_origin   = glm::vec3(base_transform[3]);
+}
+
+void IKBatch::set_target(int index, glm::vec3 target)
+{
+    m_target_x[index] = target.x;
+    m_target_y[index] = target.y;
+    m_target_z[index] = target.z;
+}
+
+glm::vec3 IKBatch::get_target(int index) const
+{
+    return glm::vec3(m_target_x[index], m_target_y[index], m_target_z[index]);
+}
+
+float IKBatch::get_value(int index, int joint_index) const
+{
+    float value = m_values[joint_index * m_stride + index];
+    return (m_types[joint_index] == KinematicChain::JOINT_TYPE_REVOLUTE) ? glm::degrees(value) : value;
+}
+
+void IKBatch::set_value(int index, int joint_index, float value)
+{
+    if(m_types[joint_index] == KinematicChain::JOINT_TYPE_REVOLUTE) {
+        value = glm::radians(value);
+    }
+    m_values[joint_index * m_stride + index] = value;
+}
+
+//==============
+// batched solve
+//==============
+
+void IKBatch::solve(int iters, float accept_end_effector_distance, float damping)
+{
+    solve_range(0, m_count, iters, accept_end_effector_distance, damping);
+}
+
+void IKBatch::solve_range(size_t begin,
+                          size_t end,
+                          int    iters,
+                          float  accept_end_effector_distance,
+                          float  damping)
+{
+    end = std::min(end, m_count);
+    if(begin >= end) {
+        return;
+    }
+    std::vector<float> scratch(10 * m_joint_count * LANES + 1); // values, pivots, axes, jacobian
+    for(size_t first = (begin / LANES) * LANES; first < end; first += LANES) {
+        solve_block(first, iters, accept_end_effector_distance, damping, &scratch[0]);
+    }
+}
+
+// abs_origins/abs_axes are joint-major xyz planes -- [(joint_index * 3 + component) * LANES + lane]
+void IKBatch::forward_block(const float* values,
+                            float*       abs_origins,
+                            float*       abs_axes,
+                            float*       end_effector_tip) const
+{
+    lanes_t r[9];
+    lanes_t t[3];
+    for(int i = 0; i < 3; i++) {
+        for(int k = 0; k < 3; k++) {
+            float base = m_base_rotation[k][i];
+            for(int l = 0; l < LANES; l++) {
+                r[i * 3 + k][l] = base;
+            }
+        }
+        float base = m_base_origin[i];
+        for(int l = 0; l < LANES; l++) {
+            t[i][l] = base;
+        }
+    }
+    for(int j = 0; j < m_joint_count; j++) {
+        const float* q = &values[j * LANES];
+        lanes_t dx, dy, dz;
+        transform_shared(r, m_offsets[j], dx, dy, dz);
+        for(int l = 0; l < LANES; l++) {
+            t[0][l] += dx[l];
+            t[1][l] += dy[l];
+            t[2][l] += dz[l];
+        }
+        mul_shared(r, m_pre_rotations[j]);
+        float* origin_x = &abs_origins[(j * 3 + 0) * LANES];
+        float* origin_y = &abs_origins[(j * 3 + 1) * LANES];
+        float* origin_z = &abs_origins[(j * 3 + 2) * LANES];
+        float* axis_x   = &abs_axes[(j * 3 + 0) * LANES];
+        float* axis_y   = &abs_axes[(j * 3 + 1) * LANES];
+        float* axis_z   = &abs_axes[(j * 3 + 2) * LANES];
+        memcpy(origin_x, t[0], sizeof(lanes_t));
+        memcpy(origin_y, t[1], sizeof(lanes_t));
+        memcpy(origin_z, t[2], sizeof(lanes_t));
+        transform_shared(r, m_axes[j], axis_x, axis_y, axis_z);
+        switch(m_types[j]) {
+            case KinematicChain::JOINT_TYPE_REVOLUTE:
+                {
+                    // rodrigues -- axis is shared, angle is per lane
+                    glm::vec3 a = m_axes[j];
+                    lanes_t s, c;
+                    lanes_t m[9];
+                    sincos_lanes(q, s, c);
+                    for(int l = 0; l < LANES; l++) {
+                        float C = 1 - c[l];
+                        m[0][l] = c[l] + a.x * a.x * C;
+                        m[1][l] = a.x * a.y * C - a.z * s[l];
+                        m[2][l] = a.x * a.z * C + a.y * s[l];
+                        m[3][l] = a.y * a.x * C + a.z * s[l];
+                        m[4][l] = c[l] + a.y * a.y * C;
+                        m[5][l] = a.y * a.z * C - a.x * s[l];
+                        m[6][l] = a.z * a.x * C - a.y * s[l];
+                        m[7][l] = a.z * a.y * C + a.x * s[l];
+                        m[8][l] = c[l] + a.z * a.z * C;
+                    }
+                    mul_lanes(r, m);
+                }
+                break;
+            case KinematicChain::JOINT_TYPE_PRISMATIC:
+                for(int l = 0; l < LANES; l++) {
+                    t[0][l] += axis_x[l] * q[l];
+                    t[1][l] += axis_y[l] * q[l];
+                    t[2][l] += axis_z[l] * q[l];
+                }
+                break;
+        }
+        mul_shared(r, m_post_rotations[j]);
+    }
+    lanes_t dx, dy, dz;
+    transform_shared(r, m_local_end_effector_tip, dx, dy, dz);
+    for(int l = 0; l < LANES; l++) {
+        end_effector_tip[0 * LANES + l] = t[0][l] + dx[l];
+        end_effector_tip[1 * LANES + l] = t[1][l] + dy[l];
+        end_effector_tip[2 * LANES + l] = t[2][l] + dz[l];
+    }
+}
+
+void IKBatch::solve_block(size_t first,
+                          int    iters,
+                          float  accept_end_effector_distance,
+                          float  damping,
+                          float* scratch)
+{
+    int n = m_joint_count;
+    float* values      = scratch;
+    float* abs_origins = values      + n * LANES;
+    float* abs_axes    = abs_origins + 3 * n * LANES;
+    float* jacobian    = abs_axes    + 3 * n * LANES;
+    lanes_t tip[3];
+    lanes_t residual;
+    lanes_t is_active; // 1 while lane still needs work, 0 once converged (or padding)
+
+    // gather
+    for(int j = 0; j < n; j++) {
+        memcpy(&values[j * LANES], &m_values[j * m_stride + first], sizeof(lanes_t));
+    }
+    const float* target_x = &m_target_x[first];
+    const float* target_y = &m_target_y[first];
+    const float* target_z = &m_target_z[first];
+
+    float damping_squared = damping * damping;
+    for(int i = 0;; i++) {
+        forward_block(values, abs_origins, abs_axes, &tip[0][0]);
+
+        // residual
+        lanes_t error_x, error_y, error_z;
+        int active_count = 0;
+        for(int l = 0; l < LANES; l++) {
+            error_x[l]   = target_x[l] - tip[0][l];
+            error_y[l]   = target_y[l] - tip[1][l];
+            error_z[l]   = target_z[l] - tip[2][l];
+            residual[l]  = sqrtf(error_x[l] * error_x[l] + error_y[l] * error_y[l] + error_z[l] * error_z[l]);
+            is_active[l] = (residual[l] >= accept_end_effector_distance && first + l < m_count) ? 1 : 0;
+            active_count += static_cast<int>(is_active[l]);
+        }
+        if(!active_count || i == iters) {
+            break;
+        }
+
+        // jacobian columns and (J * J^T + damping^2 * I) -- symmetric, so six unique entries
+        lanes_t a00, a01, a02, a11, a12, a22;
+        for(int l = 0; l < LANES; l++) {
+            a00[l] = a11[l] = a22[l] = damping_squared;
+            a01[l] = a02[l] = a12[l] = 0;
+        }
+        for(int j = 0; j < n; j++) {
+            float* jx = &jacobian[(j * 3 + 0) * LANES];
+            float* jy = &jacobian[(j * 3 + 1) * LANES];
+            float* jz = &jacobian[(j * 3 + 2) * LANES];
+            const float* ax = &abs_axes[(j * 3 + 0) * LANES];
+            const float* ay = &abs_axes[(j * 3 + 1) * LANES];
+            const float* az = &abs_axes[(j * 3 + 2) * LANES];
+            const float* ox = &abs_origins[(j * 3 + 0) * LANES];
+            const float* oy = &abs_origins[(j * 3 + 1) * LANES];
+            const float* oz = &abs_origins[(j * 3 + 2) * LANES];
+            switch(m_types[j]) {
+                case KinematicChain::JOINT_TYPE_REVOLUTE:
+                    for(int l = 0; l < LANES; l++) {
+                        float dx = tip[0][l] - ox[l];
+                        float dy = tip[1][l] - oy[l];
+                        float dz = tip[2][l] - oz[l];
+                        jx[l] = ay[l] * dz - az[l] * dy;
+                        jy[l] = az[l] * dx - ax[l] * dz;
+                        jz[l] = ax[l] * dy - ay[l] * dx;
+                    }
+                    break;
+                case KinematicChain::JOINT_TYPE_PRISMATIC:
+                    memcpy(jx, ax, sizeof(lanes_t));
+                    memcpy(jy, ay, sizeof(lanes_t));
+                    memcpy(jz, az, sizeof(lanes_t));
+                    break;
+                default:
+                    memset(jx, 0, sizeof(lanes_t));
+                    memset(jy, 0, sizeof(lanes_t));
+                    memset(jz, 0, sizeof(lanes_t));
+                    break;
+            }
+            for(int l = 0; l < LANES; l++) {
+                a00[l] += jx[l] * jx[l];
+                a01[l] += jx[l] * jy[l];
+                a02[l] += jx[l] * jz[l];
+                a11[l] += jy[l] * jy[l];
+                a12[l] += jy[l] * jz[l];
+                a22[l] += jz[l] * jz[l];
+            }
+        }
+
+        // y = A^-1 * e -- adjugate over determinant (A is positive definite when damping > 0)
+        lanes_t y_x, y_y, y_z;
+        for(int l = 0; l < LANES; l++) {
+            float c00 = a11[l] * a22[l] - a12[l] * a12[l];
+            float c01 = a02[l] * a12[l] - a01[l] * a22[l];
+            float c02 = a01[l] * a12[l] - a02[l] * a11[l];
+            float c11 = a00[l] * a22[l] - a02[l] * a02[l];
+            float c12 = a01[l] * a02[l] - a00[l] * a12[l];
+            float c22 = a00[l] * a11[l] - a01[l] * a01[l];
+            float det = a00[l] * c00 + a01[l] * c01 + a02[l] * c02;
+            float inv_det = (det > EPSILON * EPSILON) ? (is_active[l] / det) : 0; // frozen lanes get zero step
+            y_x[l] = (c00 * error_x[l] + c01 * error_y[l] + c02 * error_z[l]) * inv_det;
+            y_y[l] = (c01 * error_x[l] + c11 * error_y[l] + c12 * error_z[l]) * inv_det;
+            y_z[l] = (c02 * error_x[l] + c12 * error_y[l] + c22 * error_z[l]) * inv_det;
+        }
+
+        // dq = J^T * y
+        for(int j = 0; j < n; j++) {
+            const float* jx = &jacobian[(j * 3 + 0) * LANES];
+            const float* jy = &jacobian[(j * 3 + 1) * LANES];
+            const float* jz = &jacobian[(j * 3 + 2) * LANES];
+            float* q = &values[j * LANES];
+            for(int l = 0; l < LANES; l++) {
+                q[l] += jx[l] * y_x[l] + jy[l] * y_y[l] + jz[l] * y_z[l];
+            }
+            if(m_enable_limits[j]) {
+                float min_value = m_min_values[j];
+                float max_value = m_max_values[j];
+                for(int l = 0; l < LANES; l++) {
+                    q[l] = std::min(std::max(q[l], min_value), max_value);
+                }
+            }
+        }
+    }
+
+    // scatter
+    for(int j = 0; j < n; j++) {
+        memcpy(&m_values[j * m_stride + first], &values[j * LANES], sizeof(lanes_t));
+    }
+    for(int l = 0; l < LANES; l++) {
+        m_residuals[first + l]    = residual[l];
+        m_is_converged[first + l] = (residual[l] < accept_end_effector_distance);
+    }
+}
+
+}
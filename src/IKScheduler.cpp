@@ -0,0 +1,213 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <IKScheduler.h>
+#include <TransformObject.h>
+#include <ThreadPool.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+namespace vt {
+
+// forwards pool chunks to the scheduler's groups
+class IKScheduler::GroupTask : public ThreadPoolTask
+{
+public:
+    GroupTask(IKScheduler* scheduler)
+        : m_scheduler(scheduler)
+    {
+    }
+    void run(int thread_index, int chunk_index, size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; i++) {
+            m_scheduler->solve_group(i);
+        }
+    }
+
+private:
+    IKScheduler* m_scheduler;
+};
+
+IKChain::IKChain()
+    : m_end_effector(NULL),
+      m_root(NULL),
+      m_ik_type(TransformObject::IK_TYPE_CCD),
+      m_local_end_effector_tip(0),
+      m_target(0),
+      m_end_effector_dir(0),
+      m_use_end_effector_dir(false),
+      m_iters(0),
+      m_accept_end_effector_distance(0),
+      m_accept_avg_angle_distance(0),
+      m_result(false)
+{
+}
+
+IKScheduler::IKScheduler(int thread_count)
+    : m_thread_pool(new ThreadPool(thread_count))
+{
+}
+
+IKScheduler::~IKScheduler()
+{
+    delete m_thread_pool;
+}
+
+//=======
+// chains
+//=======
+
+int IKScheduler::add_chain(TransformObject*           end_effector,
+                           TransformObject::ik_type_t ik_type,
+                           TransformObject*           root,
+                           glm::vec3                  local_end_effector_tip,
+                           glm::vec3                  target,
+                           glm::vec3*                 end_effector_dir,
+                           int                        iters,
+                           float                      accept_end_effector_distance,
+                           float                      accept_avg_angle_distance)
+{
+    if(!end_effector || !root) {
+        return -1;
+    }
+    IKChain chain;
+    chain.m_end_effector                 = end_effector;
+    chain.m_root                         = root;
+    chain.m_ik_type                      = ik_type;
+    chain.m_local_end_effector_tip       = local_end_effector_tip;
+    chain.m_target                       = target;
+    chain.m_use_end_effector_dir         = (end_effector_dir != NULL);
+    chain.m_end_effector_dir             = end_effector_dir ? *end_effector_dir : glm::vec3(0);
+    chain.m_iters                        = iters;
+    chain.m_accept_end_effector_distance = accept_end_effector_distance;
+    chain.m_accept_avg_angle_distance    = accept_avg_angle_distance;
+    m_chains.push_back(chain);
+    return m_chains.size() - 1;
+}
+
+void IKScheduler::clear()
+{
+    m_chains.clear();
+    m_groups.clear();
+}
+
+//=============
+// batched solve
+//=============
+
+void IKScheduler::solve()
+{
+    if(m_chains.empty()) {
+        return;
+    }
+    snapshot();
+    build_groups();
+    GroupTask task(this);
+    m_thread_pool->parallel_for(m_groups.size(), 1, &task);
+}
+
+int IKScheduler::get_thread_count() const
+{
+    return m_thread_pool->get_thread_count();
+}
+
+// resolve every lazily cached transform above each chain before any worker starts
+// so shared parents (e.g. a robot body) are only ever read during the solve
+void IKScheduler::snapshot()
+{
+    for(std::vector<IKChain>::iterator p = m_chains.begin(); p != m_chains.end(); ++p) {
+        for(TransformObject* q = (*p).m_root->get_parent(); q; q = q->get_parent()) {
+            q->get_transform();
+            q->get_inverse_transform();
+            q->get_normal_transform();
+            q->get_euler();
+        }
+    }
+}
+
+// union chains that touch the same segments -- each group owns a disjoint set of writable nodes
+void IKScheduler::build_groups()
+{
+    int n = m_chains.size();
+    std::vector<int> group_ids(n);
+    for(int i = 0; i < n; i++) {
+        group_ids[i] = i;
+    }
+    std::map<TransformObject*, int> owners;
+    for(int i = 0; i < n; i++) {
+        for(TransformObject* q = m_chains[i].m_end_effector; q; q = q->get_parent()) {
+            owners.insert(std::make_pair(q, i));
+            if(q == m_chains[i].m_root) {
+                break;
+            }
+        }
+    }
+    for(int i = 0; i < n; i++) {
+        for(TransformObject* q = m_chains[i].m_end_effector; q; q = q->get_parent()) {
+            std::map<TransformObject*, int>::iterator r = owners.find(q);
+            if(r == owners.end()) {
+                continue;
+            }
+            int a = i;
+            int b = (*r).second;
+            while(group_ids[a] != a) {
+                a = group_ids[a];
+            }
+            while(group_ids[b] != b) {
+                b = group_ids[b];
+            }
+            if(a != b) {
+                group_ids[std::max(a, b)] = std::min(a, b); // lowest chain index names the group
+            }
+        }
+    }
+    m_groups.clear();
+    std::map<int, int> group_lookup;
+    for(int i = 0; i < n; i++) {
+        int a = i;
+        while(group_ids[a] != a) {
+            a = group_ids[a];
+        }
+        std::map<int, int>::iterator r = group_lookup.find(a);
+        if(r == group_lookup.end()) {
+            group_lookup.insert(std::make_pair(a, m_groups.size()));
+            m_groups.push_back(std::vector<int>(1, i));
+        } else {
+            m_groups[(*r).second].push_back(i); // preserves order of addition
+        }
+    }
+}
+
+void IKScheduler::solve_group(int group_index)
+{
+    std::vector<int> &group = m_groups[group_index];
+    for(std::vector<int>::iterator p = group.begin(); p != group.end(); ++p) {
+        IKChain &chain = m_chains[*p];
+        chain.m_result = chain.m_end_effector->solve_ik(chain.m_ik_type,
+                                                        chain.m_root,
+                                                        chain.m_local_end_effector_tip,
+                                                        chain.m_target,
+                                                        chain.m_use_end_effector_dir ? &chain.m_end_effector_dir : NULL,
+                                                        chain.m_iters,
+                                                        chain.m_accept_end_effector_distance,
+                                                        chain.m_accept_avg_angle_distance);
+    }
+}
+
+}
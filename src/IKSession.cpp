@@ -0,0 +1,206 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <IKSession.h>
+#include <TransformObject.h>
+#include <Util.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <math.h>
+
+namespace vt {
+
+IKSessionState::IKSessionState()
+    : m_target(0),
+      m_end_effector_tip(0),
+      m_end_effector_dir(0),
+      m_use_end_effector_dir(false),
+      m_has_prev_pose(false),
+      m_iters(0),
+      m_residual(0),
+      m_is_solved(false)
+{
+}
+
+static void get_segments(TransformObject* end_effector, TransformObject* root, std::vector<TransformObject*>* segments)
+{
+    segments->clear();
+    for(TransformObject* p = end_effector; p; p = p->get_parent()) {
+        segments->push_back(p);
+        if(p == root) {
+            break;
+        }
+    }
+}
+
+static void capture_pose(std::vector<TransformObject*> &segments,
+                         std::vector<glm::vec3>*        origins,
+                         std::vector<glm::quat>*        orientations)
+{
+    origins->clear();
+    orientations->clear();
+    for(std::vector<TransformObject*>::iterator p = segments.begin(); p != segments.end(); ++p) {
+        origins->push_back((*p)->get_origin());
+        orientations->push_back((*p)->get_orientation());
+    }
+}
+
+// false if something other than this session moved the chain since it was last solved
+static bool is_same_pose(std::vector<TransformObject*> &segments,
+                         std::vector<glm::vec3>        &origins,
+                         std::vector<glm::quat>        &orientations)
+{
+    if(segments.size() != origins.size()) {
+        return false;
+    }
+    for(int i = 0; i < static_cast<int>(segments.size()); i++) {
+        if(glm::distance(segments[i]->get_origin(), origins[i]) > EPSILON ||
+           fabs(glm::dot(segments[i]->get_orientation(), orientations[i])) < 1 - EPSILON)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+IKSession::IKSession(int   min_iters,
+                     int   max_iters,
+                     float skip_distance,
+                     float extrapolation)
+    : m_min_iters(std::max(min_iters, 1)),
+      m_max_iters(std::max(max_iters, min_iters)),
+      m_skip_distance(skip_distance),
+      m_extrapolation(extrapolation),
+      m_solve_count(0),
+      m_skip_count(0)
+{
+}
+
+IKSession::~IKSession()
+{
+}
+
+bool IKSession::solve(TransformObject*           end_effector,
+                      TransformObject::ik_type_t ik_type,
+                      TransformObject*           root,
+                      glm::vec3                  local_end_effector_tip,
+                      glm::vec3                  target,
+                      glm::vec3*                 end_effector_dir,
+                      float                      accept_end_effector_distance,
+                      float                      accept_avg_angle_distance)
+{
+    if(!end_effector || !root) {
+        return false;
+    }
+    std::vector<TransformObject*> segments;
+    get_segments(end_effector, root, &segments);
+    glm::vec3 end_effector_tip = end_effector->in_abs_system(local_end_effector_tip);
+
+    std::map<TransformObject*, IKSessionState>::iterator p = m_states.find(end_effector);
+    bool is_new = (p == m_states.end());
+    if(is_new) {
+        p = m_states.insert(std::make_pair(end_effector, IKSessionState())).first;
+        (*p).second.m_iters = m_min_iters;
+    }
+    IKSessionState &state = (*p).second;
+    bool is_same_chain_pose = !is_new && is_same_pose(segments, state.m_origins, state.m_orientations);
+
+    // nothing moved and the last solve got there -- last answer still holds
+    // NOTE: unsolved chains keep solving with their grown budget, or they'd stay stuck while the target is still
+    if(is_same_chain_pose &&
+       state.m_is_solved &&
+       glm::distance(target, state.m_target) < m_skip_distance &&
+       glm::distance(end_effector_tip, state.m_end_effector_tip) < m_skip_distance &&
+       state.m_use_end_effector_dir == (end_effector_dir != NULL) &&
+       (!end_effector_dir || glm::distance(*end_effector_dir, state.m_end_effector_dir) < m_skip_distance))
+    {
+        end_effector->m_debug_ik_iters    = 0;
+        end_effector->m_debug_ik_residual = state.m_residual;
+        m_skip_count++;
+        return state.m_is_solved;
+    }
+
+    // warm start -- continue each joint along its last frame's motion, keep it only if it helps
+    if(is_same_chain_pose && state.m_has_prev_pose && m_extrapolation > 0) {
+        int n = segments.size();
+        float prev_residual = glm::distance(end_effector_tip, target);
+        for(int i = n - 1; i >= 0; i--) { // root first, so constraints see final parent frames
+            glm::quat delta = glm::inverse(state.m_prev_orientations[i]) * state.m_orientations[i];
+            if(segments[i]->get_joint_type() == TransformObject::JOINT_TYPE_PRISMATIC) {
+                segments[i]->set_origin(state.m_origins[i] + (state.m_origins[i] - state.m_prev_origins[i]) * m_extrapolation);
+            }
+            segments[i]->set_orientation(state.m_orientations[i] * glm::slerp(glm::quat(1, 0, 0, 0), delta, m_extrapolation));
+        }
+        if(glm::distance(end_effector->in_abs_system(local_end_effector_tip), target) > prev_residual) {
+            for(int i = n - 1; i >= 0; i--) {
+                segments[i]->set_origin(state.m_origins[i]);
+                segments[i]->set_orientation(state.m_orientations[i]);
+            }
+        }
+    }
+
+    bool is_solved = end_effector->solve_ik(ik_type,
+                                            root,
+                                            local_end_effector_tip,
+                                            target,
+                                            end_effector_dir,
+                                            state.m_iters,
+                                            accept_end_effector_distance,
+                                            accept_avg_angle_distance);
+    m_solve_count++;
+    end_effector_tip = end_effector->in_abs_system(local_end_effector_tip);
+    float residual = glm::distance(end_effector_tip, target);
+
+    // adapt iteration budget to how hard this chain has been to solve
+    if(residual < accept_end_effector_distance) {
+        state.m_iters = std::max(state.m_iters - 1, m_min_iters);
+    } else {
+        state.m_iters = std::min(state.m_iters * 2, m_max_iters);
+    }
+
+    // remember
+    if(is_same_chain_pose) {
+        state.m_prev_origins.swap(state.m_origins);
+        state.m_prev_orientations.swap(state.m_orientations);
+        state.m_has_prev_pose = true;
+    } else {
+        state.m_has_prev_pose = false; // moved externally -- velocities are meaningless
+    }
+    capture_pose(segments, &state.m_origins, &state.m_orientations);
+    state.m_target               = target;
+    state.m_end_effector_tip     = end_effector_tip;
+    state.m_use_end_effector_dir = (end_effector_dir != NULL);
+    state.m_end_effector_dir     = end_effector_dir ? *end_effector_dir : glm::vec3(0);
+    state.m_residual             = residual;
+    state.m_is_solved            = is_solved;
+    return is_solved;
+}
+
+void IKSession::forget(TransformObject* end_effector)
+{
+    m_states.erase(end_effector);
+}
+
+void IKSession::clear()
+{
+    m_states.clear();
+}
+
+}
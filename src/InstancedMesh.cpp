@@ -0,0 +1,119 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <InstancedMesh.h>
+#include <Mesh.h>
+#include <MeshBase.h>
+#include <Buffer.h>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <string>
+#include <vector>
+
+namespace vt {
+
+InstancedMesh::InstancedMesh(const std::string& name,
+                             const MeshBase*    geometry,
+                             size_t             instance_count)
+    : Mesh(name, 0, 0),
+      m_vbo_instance_transforms(NULL),
+      m_vbo_instance_colors(NULL),
+      m_is_dirty_instances(true)
+{
+    if(geometry) {
+        merge(geometry, true);
+    }
+    resize_instances(instance_count);
+}
+
+InstancedMesh::~InstancedMesh()
+{
+    if(m_vbo_instance_transforms) { delete m_vbo_instance_transforms; }
+    if(m_vbo_instance_colors)     { delete m_vbo_instance_colors; }
+}
+
+//==========
+// instances
+//==========
+
+void InstancedMesh::resize_instances(size_t instance_count)
+{
+    m_instance_transforms.resize(instance_count, glm::mat4(1));
+    m_instance_colors.resize(instance_count, glm::vec3(1));
+    m_is_dirty_instances = true;
+}
+
+void InstancedMesh::set_instance_transform(int index, glm::mat4 transform)
+{
+    m_instance_transforms[index] = transform;
+    m_is_dirty_instances = true;
+}
+
+void InstancedMesh::set_instance_transform(int index, glm::vec3 origin, glm::quat orientation)
+{
+    m_instance_transforms[index] = glm::translate(glm::mat4(1), origin) * glm::mat4_cast(orientation);
+    m_is_dirty_instances = true;
+}
+
+void InstancedMesh::set_instance_color(int index, glm::vec3 color)
+{
+    m_instance_colors[index] = color;
+    m_is_dirty_instances = true;
+}
+
+//===========
+// instancing
+//===========
+
+Buffer* InstancedMesh::get_vbo_instance_transforms()
+{
+    if(!m_vbo_instance_transforms) {
+        m_vbo_instance_transforms = new Buffer(GL_ARRAY_BUFFER, 0, NULL);
+        m_is_dirty_instances = true;
+    }
+    return m_vbo_instance_transforms;
+}
+
+Buffer* InstancedMesh::get_vbo_instance_colors()
+{
+    if(!m_vbo_instance_colors) {
+        m_vbo_instance_colors = new Buffer(GL_ARRAY_BUFFER, 0, NULL);
+        m_is_dirty_instances = true;
+    }
+    return m_vbo_instance_colors;
+}
+
+// one upload per frame no matter how many passes draw the mesh
+void InstancedMesh::update_instance_buffers()
+{
+    if(!m_is_dirty_instances) {
+        return;
+    }
+    size_t instance_count = m_instance_transforms.size();
+    if(m_vbo_instance_transforms) {
+        m_vbo_instance_transforms->update(sizeof(glm::mat4) * instance_count, instance_count ? &m_instance_transforms[0] : NULL);
+    }
+    if(m_vbo_instance_colors) {
+        m_vbo_instance_colors->update(sizeof(glm::vec3) * instance_count, instance_count ? &m_instance_colors[0] : NULL);
+    }
+    m_is_dirty_instances = false;
+}
+
+}
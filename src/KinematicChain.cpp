@@ -0,0 +1,391 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <KinematicChain.h>
+#include <TransformObject.h>
+#include <Util.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+namespace vt {
+
+// keep unlimited angles continuous around a reference (i.e. 350 becomes -10 near 0)
+static float wrap_angle_near(float angle, float reference)
+{
+    return reference + angle_modulo(angle - reference + 180) - 180;
+}
+
+KinematicChain::KinematicChain()
+    : m_base_transform(glm::mat4(1)),
+      m_local_end_effector_tip(0),
+      m_end_effector_tip(0),
+      m_iters(0),
+      m_residual(0)
+{
+}
+
+KinematicChain::~KinematicChain()
+{
+}
+
+//=============
+// construction
+//=============
+
+int KinematicChain::add_joint(joint_type_t type,
+                              glm::vec3    offset,
+                              glm::vec3    axis,
+                              float        value,
+                              glm::quat    pre_orientation,
+                              glm::quat    post_orientation)
+{
+    m_types.push_back(type);
+    m_offsets.push_back(offset);
+    m_axes.push_back(safe_normalize(axis));
+    m_pre_orientations.push_back(pre_orientation);
+    m_post_orientations.push_back(post_orientation);
+    m_enable_limits.push_back(false);
+    m_min_values.push_back(0);
+    m_max_values.push_back(0);
+    m_values.push_back(value);
+    m_bindings.push_back(NULL);
+    m_world_transforms.push_back(glm::mat4(1));
+    m_abs_origins.push_back(glm::vec3(0));
+    m_abs_axes.push_back(glm::vec3(0));
+    return m_types.size() - 1;
+}
+
+void KinematicChain::set_limits(int index, float min_value, float max_value)
+{
+    m_enable_limits[index] = true;
+    m_min_values[index]    = min_value;
+    m_max_values[index]    = max_value;
+    m_values[index]        = clamp_value(index, m_values[index]);
+}
+
+// mirror the node hierarchy between root and end effector (inclusive) and bind each joint to its node
+// hinges become one revolute joint, ball joints become yaw/pitch/roll revolute joints (same order as euler_to_quat),
+// prismatic joints become one slider per unlocked parent axis
+bool KinematicChain::build_from(TransformObject* root,
+                                TransformObject* end_effector,
+                                glm::vec3        local_end_effector_tip)
+{
+    std::vector<TransformObject*> nodes;
+    for(TransformObject* p = end_effector; p; p = p->get_parent()) {
+        nodes.insert(nodes.begin(), p);
+        if(p == root) {
+            break;
+        }
+    }
+    if(nodes.empty() || nodes.front() != root) {
+        return false; // root is not an ancestor of end effector
+    }
+    clear();
+    m_base_transform         = root->get_parent() ? root->get_parent()->get_transform() : glm::mat4(1);
+    m_local_end_effector_tip = local_end_effector_tip;
+    static const int euler_order[] = {EULER_INDEX_YAW, EULER_INDEX_PITCH, EULER_INDEX_ROLL};
+    for(std::vector<TransformObject*>::iterator p = nodes.begin(); p != nodes.end(); ++p) {
+        TransformObject* node                      = *p;
+        const glm::vec3  &origin                   = node->get_origin();
+        const glm::vec3  &euler                    = node->get_euler();
+        const glm::ivec3 &enable_joint_constraints = node->get_enable_joint_constraints();
+        const glm::vec3  &center                   = node->get_joint_constraints_center();
+        const glm::vec3  &max_deviation            = node->get_joint_constraints_max_deviation();
+        int first_index = size();
+        if(node->get_joint_type() == TransformObject::JOINT_TYPE_PRISMATIC) {
+            glm::vec3 fixed_offset = origin;
+            std::vector<int> free_axes;
+            for(int k = 0; k < 3; k++) {
+                if(enable_joint_constraints[k] && max_deviation[k] < EPSILON) {
+                    continue; // locked axis
+                }
+                free_axes.push_back(k);
+                fixed_offset[k] = 0;
+            }
+            if(free_axes.empty()) {
+                add_joint(JOINT_TYPE_FIXED, origin, glm::vec3(0), 0, glm::quat(1, 0, 0, 0), node->get_orientation());
+            }
+            for(int i = 0; i < static_cast<int>(free_axes.size()); i++) {
+                int k = free_axes[i];
+                glm::vec3 axis(0);
+                axis[k] = 1;
+                int index = add_joint(JOINT_TYPE_PRISMATIC,
+                                      i ? glm::vec3(0) : fixed_offset,
+                                      axis,
+                                      origin[k],
+                                      glm::quat(1, 0, 0, 0),
+                                      (i == static_cast<int>(free_axes.size()) - 1) ? node->get_orientation() : glm::quat(1, 0, 0, 0));
+                if(enable_joint_constraints[k]) {
+                    set_limits(index, center[k] - max_deviation[k], center[k] + max_deviation[k]);
+                }
+            }
+        } else if(node->is_hinge()) {
+            int k = node->get_hinge_type();
+            glm::quat pre_orientation(1, 0, 0, 0);
+            glm::quat post_orientation(1, 0, 0, 0);
+            bool is_after_hinge = false;
+            for(int i = 0; i < 3; i++) {
+                int j = euler_order[i];
+                if(j == k) {
+                    is_after_hinge = true;
+                    continue;
+                }
+                glm::quat component = GLM_ANGLE_AXIS(euler[j], get_absolute_direction(j));
+                if(is_after_hinge) {
+                    post_orientation = post_orientation * component;
+                } else {
+                    pre_orientation = pre_orientation * component;
+                }
+            }
+            int index = add_joint(JOINT_TYPE_REVOLUTE,
+                                  origin,
+                                  get_absolute_direction(k),
+                                  wrap_angle_near(euler[k], center[k]),
+                                  pre_orientation,
+                                  post_orientation);
+            if(enable_joint_constraints[k]) {
+                set_limits(index, center[k] - max_deviation[k], center[k] + max_deviation[k]);
+            }
+        } else {
+            for(int i = 0; i < 3; i++) {
+                int j = euler_order[i];
+                int index = add_joint(JOINT_TYPE_REVOLUTE,
+                                      i ? glm::vec3(0) : origin,
+                                      get_absolute_direction(j),
+                                      wrap_angle_near(euler[j], center[j]));
+                if(enable_joint_constraints[j]) {
+                    set_limits(index, center[j] - max_deviation[j], center[j] + max_deviation[j]);
+                }
+            }
+        }
+        for(int i = first_index; i < static_cast<int>(size()); i++) {
+            bind(i, node);
+        }
+    }
+    update();
+    return true;
+}
+
+void KinematicChain::clear()
+{
+    m_types.clear();
+    m_offsets.clear();
+    m_axes.clear();
+    m_pre_orientations.clear();
+    m_post_orientations.clear();
+    m_enable_limits.clear();
+    m_min_values.clear();
+    m_max_values.clear();
+    m_values.clear();
+    m_bindings.clear();
+    m_world_transforms.clear();
+    m_abs_origins.clear();
+    m_abs_axes.clear();
+    m_iters    = 0;
+    m_residual = 0;
+}
+
+//===============
+// basic features
+//===============
+
+void KinematicChain::set_value(int index, float value)
+{
+    m_values[index] = clamp_value(index, value);
+}
+
+void KinematicChain::set_values(const std::vector<float> &values)
+{
+    int n = std::min(values.size(), m_values.size());
+    for(int i = 0; i < n; i++) {
+        m_values[i] = clamp_value(i, values[i]);
+    }
+}
+
+float KinematicChain::clamp_value(int index, float value) const
+{
+    if(!m_enable_limits[index]) {
+        return value;
+    }
+    return CLAMP(value, m_min_values[index], m_max_values[index]);
+}
+
+//===================
+// forward kinematics
+//===================
+
+void KinematicChain::update()
+{
+    glm::mat4 transform = m_base_transform;
+    int n = size();
+    for(int i = 0; i < n; i++) {
+        transform = transform * glm::translate(glm::mat4(1), m_offsets[i]) * glm::mat4_cast(m_pre_orientations[i]);
+        m_abs_origins[i] = glm::vec3(transform[3]);
+        m_abs_axes[i]    = safe_normalize(glm::mat3(transform) * m_axes[i]);
+        switch(m_types[i]) {
+            case JOINT_TYPE_REVOLUTE:
+                transform = transform * glm::mat4_cast(GLM_ANGLE_AXIS(m_values[i], m_axes[i]));
+                break;
+            case JOINT_TYPE_PRISMATIC:
+                transform = transform * glm::translate(glm::mat4(1), m_axes[i] * m_values[i]);
+                break;
+            case JOINT_TYPE_FIXED:
+                break;
+        }
+        transform = transform * glm::mat4_cast(m_post_orientations[i]);
+        m_world_transforms[i] = transform;
+    }
+    m_end_effector_tip = glm::vec3(transform * glm::vec4(m_local_end_effector_tip, 1));
+}
+
+//========
+// solvers
+//========
+
+// same sweep order as TransformObject::solve_ik_ccd, but with one scalar per joint and no guide wires
+bool KinematicChain::solve_ccd(glm::vec3 target,
+                               int       iters,
+                               float     accept_end_effector_distance)
+{
+    int n = size();
+    update();
+    m_residual = glm::distance(m_end_effector_tip, target);
+    int i = 0;
+    for(; i < iters && m_residual >= accept_end_effector_distance; i++) {
+        for(int j = n - 1; j >= 0; j--) {
+            glm::vec3 axis = m_abs_axes[j];
+            switch(m_types[j]) {
+                case JOINT_TYPE_REVOLUTE:
+                    {
+                        glm::vec3 end_effector_tip_dir = rejection_from(m_end_effector_tip - m_abs_origins[j], axis);
+                        glm::vec3 target_dir           = rejection_from(target - m_abs_origins[j], axis);
+                        if(glm::length(end_effector_tip_dir) < EPSILON || glm::length(target_dir) < EPSILON) {
+                            continue; // target on axis
+                        }
+                        m_values[j] = clamp_value(j, m_values[j] + signed_angle(end_effector_tip_dir, target_dir, axis));
+                    }
+                    break;
+                case JOINT_TYPE_PRISMATIC:
+                    m_values[j] = clamp_value(j, m_values[j] + glm::dot(target - m_end_effector_tip, axis));
+                    break;
+                case JOINT_TYPE_FIXED:
+                    continue;
+            }
+            update();
+        }
+        m_residual = glm::distance(m_end_effector_tip, target);
+    }
+    m_iters = i;
+    return m_residual < accept_end_effector_distance;
+}
+
+// damped least squares -- position only
+bool KinematicChain::solve_jacobian(glm::vec3 target,
+                                    int       iters,
+                                    float     accept_end_effector_distance,
+                                    float     damping)
+{
+    int n = size();
+    std::vector<glm::vec3> jacobian(n);
+    update();
+    m_residual = glm::distance(m_end_effector_tip, target);
+    int i = 0;
+    for(; i < iters && m_residual >= accept_end_effector_distance; i++) {
+        for(int j = 0; j < n; j++) {
+            switch(m_types[j]) {
+                case JOINT_TYPE_REVOLUTE:  jacobian[j] = glm::cross(m_abs_axes[j], m_end_effector_tip - m_abs_origins[j]); break;
+                case JOINT_TYPE_PRISMATIC: jacobian[j] = m_abs_axes[j]; break;
+                case JOINT_TYPE_FIXED:     jacobian[j] = glm::vec3(0); break;
+            }
+        }
+
+        // solve (J * J^T + damping^2 * I) * y = e
+        float jjt[9];
+        float error[3];
+        glm::vec3 position_error = target - m_end_effector_tip;
+        for(int r1 = 0; r1 < 3; r1++) {
+            for(int r2 = 0; r2 < 3; r2++) {
+                float sum = (r1 == r2) ? damping * damping : 0;
+                for(int j = 0; j < n; j++) {
+                    sum += jacobian[j][r1] * jacobian[j][r2];
+                }
+                jjt[r1 * 3 + r2] = sum;
+            }
+            error[r1] = position_error[r1];
+        }
+        if(!solve_linear_system(jjt, error, 3)) {
+            break;
+        }
+
+        // dq = J^T * y
+        glm::vec3 y(error[0], error[1], error[2]);
+        for(int j = 0; j < n; j++) {
+            float dq = glm::dot(jacobian[j], y);
+            if(m_types[j] == JOINT_TYPE_REVOLUTE) {
+                dq = glm::degrees(dq);
+            }
+            m_values[j] = clamp_value(j, m_values[j] + dq);
+        }
+        update();
+        m_residual = glm::distance(m_end_effector_tip, target);
+    }
+    m_iters = i;
+    return m_residual < accept_end_effector_distance;
+}
+
+//========
+// binding
+//========
+
+// compose consecutive joints bound to the same node into one local origin/orientation
+void KinematicChain::apply_bindings() const
+{
+    int n = size();
+    glm::vec3 origin(0);
+    glm::quat orientation(1, 0, 0, 0);
+    for(int i = 0; i < n; i++) {
+        TransformObject* node = m_bindings[i];
+        if(!i || node != m_bindings[i - 1]) {
+            origin      = glm::vec3(0);
+            orientation = glm::quat(1, 0, 0, 0);
+        }
+        origin      += orientation * m_offsets[i];
+        orientation  = orientation * m_pre_orientations[i];
+        switch(m_types[i]) {
+            case JOINT_TYPE_REVOLUTE:
+                orientation = orientation * GLM_ANGLE_AXIS(m_values[i], m_axes[i]);
+                break;
+            case JOINT_TYPE_PRISMATIC:
+                origin += orientation * (m_axes[i] * m_values[i]);
+                break;
+            case JOINT_TYPE_FIXED:
+                break;
+        }
+        orientation = orientation * m_post_orientations[i];
+        if(!node || (i + 1 < n && m_bindings[i + 1] == node)) {
+            continue;
+        }
+        node->set_origin(origin);
+        node->set_orientation(orientation);
+    }
+}
+
+}
@@ -29,11 +29,12 @@ Light::Light(const std::string& name,
       m_color(color),
       m_enabled(true)
 {
+    m_transform_kind = TRANSFORM_KIND_TRANSLATE;
 }
 
 void Light::update_transform()
 {
-    m_transform = glm::translate(glm::mat4(1), m_origin);
+    *m_transform = glm::translate(glm::mat4(1), *m_origin);
 }
 
 }
@@ -454,7 +454,9 @@ ShaderContext* Mesh::get_shader_context()
                                          get_vbo_vert_normal(),
                                          get_vbo_vert_tangent(),
                                          get_vbo_tex_coords(),
-                                         get_ibo_tri_indices());
+                                         get_ibo_tri_indices(),
+                                         get_vbo_instance_transforms(),
+                                         get_vbo_instance_colors());
     return m_shader_context;
 }
 
@@ -468,7 +470,9 @@ ShaderContext* Mesh::get_normal_shader_context(Material* normal_material)
                                                 get_vbo_vert_normal(),
                                                 get_vbo_vert_tangent(),
                                                 get_vbo_tex_coords(),
-                                                get_ibo_tri_indices());
+                                                get_ibo_tri_indices(),
+                                                get_vbo_instance_transforms(),
+                                                get_vbo_instance_colors());
     return m_normal_shader_context;
 }
 
@@ -482,7 +486,9 @@ ShaderContext* Mesh::get_wireframe_shader_context(Material* wireframe_material)
                                                    get_vbo_vert_normal(),
                                                    get_vbo_vert_tangent(),
                                                    get_vbo_tex_coords(),
-                                                   get_ibo_tri_indices());
+                                                   get_ibo_tri_indices(),
+                                                   get_vbo_instance_transforms(),
+                                                   get_vbo_instance_colors());
     return m_wireframe_shader_context;
 }
 
@@ -496,7 +502,9 @@ ShaderContext* Mesh::get_ssao_shader_context(Material* ssao_material)
                                               get_vbo_vert_normal(),
                                               get_vbo_vert_tangent(),
                                               get_vbo_tex_coords(),
-                                              get_ibo_tri_indices());
+                                              get_ibo_tri_indices(),
+                                              get_vbo_instance_transforms(),
+                                              get_vbo_instance_colors());
     return m_ssao_shader_context;
 }
 
@@ -537,9 +545,9 @@ void Mesh::flatten(glm::mat4* basis)
 
 void Mesh::set_axis(glm::vec3 axis)
 {
-    glm::vec3 local_axis = glm::vec3(glm::inverse(get_transform()) * glm::vec4(axis, 1));
+    glm::vec3 local_axis = glm::vec3(get_inverse_transform() * glm::vec4(axis, 1));
     transform_vertices(glm::translate(glm::mat4(1), -local_axis));
-    m_origin = in_parent_system(axis);
+    *m_origin = in_parent_system(axis);
     mark_dirty_transform();
 }
 
@@ -551,7 +559,7 @@ void Mesh::center_axis(BBoxObject::align_t align)
 
 void Mesh::update_transform()
 {
-    m_transform = glm::translate(glm::mat4(1), m_origin) * get_local_rotation_transform() * glm::scale(glm::mat4(1), m_scale);
+    *m_transform = glm::translate(glm::mat4(1), *m_origin) * get_local_rotation_transform() * glm::scale(glm::mat4(1), *m_scale);
 }
 
 MeshBase* alloc_mesh_base(const std::string& name, size_t num_vertex, size_t num_tri)
@@ -0,0 +1,226 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <NBodySimulation.h>
+#include <Simulation.h>
+#include <BBoxObject.h>
+#include <Octree.h>
+#include <ScratchArena.h>
+#include <Util.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <math.h>
+
+namespace vt {
+
+NBodyParams::NBodyParams()
+    : m_gravity_model(GRAVITY_MODEL_BARNES_HUT),
+      m_nearest_neighbor_radius(10),
+      m_nearest_neighbor_count(20),
+      m_forward_speed_max(0.025f),
+      m_gravitational_constant(0.00001f),
+      m_theta(0.5f),
+      m_softening(0.05f)
+{
+}
+
+NBodySimulation::NBodySimulation(glm::vec3          bounds_origin,
+                                 glm::vec3          bounds_dim,
+                                 const NBodyParams &params,
+                                 float              fixed_dt)
+    : Simulation(fixed_dt),
+      m_params(params),
+      m_bounds(bounds_origin, bounds_origin + bounds_dim),
+      m_octree(new Octree(bounds_origin, bounds_dim)),
+      m_kinetic_energy(0),
+      m_tick_scale(1)
+{
+}
+
+NBodySimulation::~NBodySimulation()
+{
+    delete m_octree;
+}
+
+//=======
+// agents
+//=======
+
+int NBodySimulation::add_agent(glm::vec3 origin, glm::vec3 velocity, float mass)
+{
+    m_origins.push_back(origin);
+    m_velocities.push_back(velocity);
+    m_masses.push_back(mass);
+    return m_origins.size() - 1;
+}
+
+void NBodySimulation::randomize_agents(glm::vec3 scatter_min, glm::vec3 scatter_max)
+{
+    int n = m_origins.size();
+    for(int i = 0; i < n; i++) {
+        glm::vec3 rand_vec(static_cast<float>(rand()) / RAND_MAX,
+                           static_cast<float>(rand()) / RAND_MAX,
+                           static_cast<float>(rand()) / RAND_MAX);
+        m_origins[i] = MIX(scatter_min, scatter_max, rand_vec);
+        glm::vec3 rand_vec2(static_cast<float>(rand()) / RAND_MAX,
+                            static_cast<float>(rand()) / RAND_MAX,
+                            static_cast<float>(rand()) / RAND_MAX);
+        m_velocities[i] = MIX(glm::vec3(-m_params.m_forward_speed_max), glm::vec3(m_params.m_forward_speed_max), rand_vec2);
+    }
+    m_octree->clear();
+}
+
+void NBodySimulation::clear_agents()
+{
+    m_origins.clear();
+    m_velocities.clear();
+    m_masses.clear();
+    m_octree->clear();
+}
+
+// bodies are points -- no orientation to speak of
+glm::quat NBodySimulation::get_agent_orientation(int index) const
+{
+    return glm::quat(1, 0, 0, 0);
+}
+
+int NBodySimulation::find_neighbors(int index, std::vector<long>* nearest_k_indices) const
+{
+    return m_octree->find(m_origins[index],
+                          m_params.m_nearest_neighbor_count,
+                          nearest_k_indices,
+                          m_params.m_nearest_neighbor_radius);
+}
+
+//=======
+// update
+//=======
+
+// double-buffered -- every body reads the current buffers and writes only its own slot in the next ones,
+// so results don't depend on body order or thread count
+void NBodySimulation::update(float dt)
+{
+    m_tick_scale = dt / SIMULATION_TICK_DT;
+    update_octree();
+    int n = m_origins.size();
+    m_next_origins.resize(n);
+    m_next_velocities.resize(n);
+    m_chunk_kinetic_energies.resize(get_chunk_count(n));
+    parallel_for(PASS_INTEGRATE, n);
+    m_origins.swap(m_next_origins);
+    m_velocities.swap(m_next_velocities);
+
+    // chunk order is fixed by body count alone
+    m_kinetic_energy = 0;
+    for(std::vector<float>::iterator p = m_chunk_kinetic_energies.begin(); p != m_chunk_kinetic_energies.end(); ++p) {
+        m_kinetic_energy += *p;
+    }
+}
+
+void NBodySimulation::run_pass(int pass, int chunk_index, size_t begin, size_t end, ScratchArena* scratch_arena)
+{
+    if(pass != PASS_INTEGRATE) {
+        return;
+    }
+    long*  nearest_k_ids   = NULL;
+    float* nearest_k_dists = NULL;
+    if(m_params.m_gravity_model == GRAVITY_MODEL_NEAREST_NEIGHBORS) {
+        nearest_k_ids   = scratch_arena->alloc<long>(m_params.m_nearest_neighbor_count);
+        nearest_k_dists = scratch_arena->alloc<float>(m_params.m_nearest_neighbor_count);
+    }
+    float kinetic_energy = 0;
+    for(size_t i = begin; i < end; i++) {
+        glm::vec3 acceleration = (m_params.m_gravity_model == GRAVITY_MODEL_BARNES_HUT) ? get_barnes_hut_acceleration(i)
+                                                                                         : get_nearest_neighbors_acceleration(i, nearest_k_ids, nearest_k_dists);
+        glm::vec3 velocity = m_velocities[i] + acceleration * m_tick_scale;
+
+        // apply speed limit
+        velocity = safe_normalize(velocity) * std::min(glm::length(velocity), m_params.m_forward_speed_max);
+        m_next_velocities[i] = velocity;
+        m_next_origins[i]    = m_origins[i] + velocity * m_tick_scale;
+        kinetic_energy += 0.5f * m_masses[i] * glm::dot(velocity, velocity);
+    }
+    m_chunk_kinetic_energies[chunk_index] = kinetic_energy;
+}
+
+// nearest_k_ids/nearest_k_dists are caller scratch of m_nearest_neighbor_count each
+glm::vec3 NBodySimulation::get_nearest_neighbors_acceleration(int index, long* nearest_k_ids, float* nearest_k_dists) const
+{
+    glm::vec3 self_pos = m_origins[index];
+    int count = m_octree->find(self_pos,
+                               m_params.m_nearest_neighbor_count,
+                               nearest_k_ids,
+                               nearest_k_dists,
+                               m_params.m_nearest_neighbor_radius);
+    if(!count) {
+        return glm::vec3(0);
+    }
+    glm::vec3 group_centroid(0);
+    for(int j = 0; j < count; j++) {
+        if(nearest_k_ids[j] == index) { // ignore self
+            continue;
+        }
+        group_centroid += m_origins[nearest_k_ids[j]];
+    }
+    group_centroid *= (1.0f / count);
+    float mass = count;
+    float dist = glm::distance(group_centroid, self_pos);
+    if(dist < EPSILON) {
+        return glm::vec3(0);
+    }
+    float force = m_params.m_gravitational_constant * mass / pow(dist, 2);
+    return safe_normalize(group_centroid - self_pos) * force;
+}
+
+// octree aggregates are refit once per step in update_octree
+glm::vec3 NBodySimulation::get_barnes_hut_acceleration(int index) const
+{
+    return m_octree->get_gravitational_field(m_origins[index],
+                                             m_params.m_theta,
+                                             m_params.m_softening,
+                                             index) * m_params.m_gravitational_constant;
+}
+
+void NBodySimulation::update_octree()
+{
+    int n = m_origins.size();
+    for(int i = 0; i < n; i++) {
+        // keep bodies in octree
+        m_origins[i] = m_bounds.wrap(m_origins[i]);
+
+        // add/update
+        if(m_octree->exists(i)) {
+            m_octree->move(i, m_origins[i]);
+        } else {
+            m_octree->insert(i, m_origins[i]);
+            m_octree->set_mass(i, m_masses[i]);
+        }
+    }
+
+    // rebalance
+    m_octree->rebalance();
+
+    // mass aggregates -- only nodes touched since the last step are recomputed
+    if(m_params.m_gravity_model == GRAVITY_MODEL_BARNES_HUT) {
+        m_octree->refit();
+    }
+}
+
+}
@@ -16,14 +16,12 @@
 // along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Octree.h>
-#include <TransformObject.h>
-#include <BBoxObject.h>
-#include <PrimitiveFactory.h>
-#include <queue>
-#include <map>
+#include <vector>
 #include <set>
 #include <sstream>
+#include <algorithm>
 #include <memory.h>
+#include <math.h>
 
 #define NODE_CAPACITY      5
 #define DEPTH_LIMIT        4
@@ -44,7 +42,11 @@ Octree::Octree(glm::vec3 origin,
       m_depth(depth),
       m_parent(parent),
       m_root(parent ? root : this),
-      m_child_count(0)
+      m_child_count(0),
+      m_mass(0),
+      m_mass_center(origin + dim * 0.5f),
+      m_is_dirty_mass(false),
+      m_has_masses(false)
 {
     memset(m_nodes, 0, sizeof(Octree*) * 8);
 }
@@ -56,7 +58,17 @@ Octree::~Octree()
 
 void Octree::clear()
 {
-    m_leaf_objects.clear(); // purge leaf contents
+    if(is_root()) {
+        m_object_nodes.clear();
+        m_object_slots.clear();
+        m_object_masses.clear();
+        m_has_masses = false;
+    }
+    m_leaf_ids.clear(); // purge leaf contents
+    m_leaf_positions.clear();
+    m_mass          = 0;
+    m_mass_center   = m_center;
+    m_is_dirty_mass = false;
     for(int i = 0; i < 8; i++) {
         if(!m_nodes[i]) {
             continue;
@@ -85,25 +97,42 @@ void Octree::prune_empty_nodes()
 
 bool Octree::insert(long id, glm::vec3 pos)
 {
+    if(id < 0) {
+        return false;
+    }
     if(is_leaf()) { // if leaf
-        if((m_leaf_objects.size() < NODE_CAPACITY || m_depth > DEPTH_LIMIT)) { // if leaf and there's still room or we've reached depth limit
-            if(m_leaf_objects.find(id) != m_leaf_objects.end()) { // object already added?
+        if((m_leaf_ids.size() < NODE_CAPACITY || m_depth > DEPTH_LIMIT)) { // if leaf and there's still room or we've reached depth limit
+            if(m_root->exists(id)) { // object already added?
                 return false;
             }
-            m_leaf_objects.insert(std::pair<long, glm::vec3>(id, pos)); // add object to leaf
+            if(static_cast<size_t>(id) >= m_root->m_object_nodes.size()) { // grows only when a new largest id arrives
+                m_root->m_object_nodes.resize(id + 1, NULL);
+                m_root->m_object_slots.resize(id + 1, -1);
+            }
+            if(m_leaf_ids.capacity() < NODE_CAPACITY) {
+                m_leaf_ids.reserve(NODE_CAPACITY);
+                m_leaf_positions.reserve(NODE_CAPACITY);
+            }
+            m_root->m_object_nodes[id] = this;
+            m_root->m_object_slots[id] = m_leaf_ids.size();
+            m_leaf_ids.push_back(id); // add object to leaf
+            m_leaf_positions.push_back(pos);
+            mark_dirty_mass();
             return true;
         }
         // create sub-nodes and copy leaf contents to sub-nodes
-        for(std::map<long, glm::vec3>::iterator p = m_leaf_objects.begin(); p != m_leaf_objects.end(); ++p) {
-            long      _id  = (*p).first;
-            glm::vec3 _pos = (*p).second;
+        for(int i = 0; i < static_cast<int>(m_leaf_ids.size()); i++) {
+            long      _id  = m_leaf_ids[i];
+            glm::vec3 _pos = m_leaf_positions[i];
+            m_root->m_object_nodes[_id] = NULL; // re-homed below
             Octree* node = alloc_octant(_pos);
             if(!node) {
                 continue;
             }
             node->insert(_id, _pos);
         }
-        m_leaf_objects.clear(); // purge leaf contents
+        m_leaf_ids.clear(); // purge leaf contents
+        m_leaf_positions.clear();
     }
     Octree* node = alloc_octant(pos);
     if(!node || !node->insert(id, pos)) { // add object to including node
@@ -114,61 +143,110 @@ bool Octree::insert(long id, glm::vec3 pos)
 
 bool Octree::remove(long id)
 {
-    if(is_leaf()) {
-        std::map<long, glm::vec3>::iterator p = m_leaf_objects.find(id);
-        if(p == m_leaf_objects.end()) {
-            return false;
-        }
-        m_leaf_objects.erase(p); // remove core action
-        return true;
+    if(!exists(id)) {
+        return false;
     }
-    for(int i = 0; i < 8; i++) {
-        if(!m_nodes[i]) {
-            continue;
-        }
-        if(m_nodes[i]->remove(id)) {
-            return true;
-        }
+    m_root->m_object_nodes[id]->erase_leaf_slot(m_root->m_object_slots[id]); // remove core action
+    if(static_cast<size_t>(id) < m_root->m_object_masses.size()) { // removed for good -- forget its mass
+        m_root->m_object_masses[id] = 1;
     }
-    return false;
+    return true;
 }
 
+// swap-remove -- the last entry moves into the freed slot, nothing else shifts
+void Octree::erase_leaf_slot(int slot)
+{
+    long id   = m_leaf_ids[slot];
+    int  last = m_leaf_ids.size() - 1;
+    if(slot != last) {
+        m_leaf_ids[slot]       = m_leaf_ids[last];
+        m_leaf_positions[slot] = m_leaf_positions[last];
+        m_root->m_object_slots[m_leaf_ids[slot]] = slot;
+    }
+    m_leaf_ids.pop_back();
+    m_leaf_positions.pop_back();
+    m_root->m_object_nodes[id] = NULL;
+    m_root->m_object_slots[id] = -1;
+    mark_dirty_mass();
+}
+
+// appends up to k nearest ids, nearest first
+// NOTE: no allocation beyond growing nearest_k_vec -- reuse it across calls
 int Octree::find(glm::vec3          target,
                  int                k,
                  std::vector<long>* nearest_k_vec,
                  float              radius) const
 {
-    std::priority_queue<id_dist_t, std::vector<id_dist_t>, id_dist_less_than_t> nearest_k_pq;
-    find_hier(target, k, &nearest_k_pq, true, radius);
-
-    // reverse order and copy k elements into more friendly container
-    int i = nearest_k_pq.size() - 1;
-    while(nearest_k_pq.size()) {
-        if(i < k) {
-            nearest_k_vec->insert(nearest_k_vec->begin(), nearest_k_pq.top().first);
-        }
-        nearest_k_pq.pop();
-        i--;
+    if(k <= 0) {
+        return nearest_k_vec->size();
+    }
+    float              stack_dists[OCTREE_FIND_STACK_SIZE];
+    std::vector<float> heap_dists;
+    float*             nearest_k_dists = stack_dists;
+    if(k > OCTREE_FIND_STACK_SIZE) {
+        heap_dists.resize(k);
+        nearest_k_dists = &heap_dists[0];
     }
+    size_t offset = nearest_k_vec->size();
+    nearest_k_vec->resize(offset + k);
+    int count = find(target, k, &(*nearest_k_vec)[offset], nearest_k_dists, radius);
+    nearest_k_vec->resize(offset + count);
 
     // return actual result size
     return nearest_k_vec->size();
 }
 
-void Octree::find_hier(glm::vec3                                                                    target,
-                       int                                                                          k,
-                       std::priority_queue<id_dist_t, std::vector<id_dist_t>, id_dist_less_than_t>* nearest_k_pq,
-                       bool                                                                         is_direct_lineage,
-                       float                                                                        radius) const
+// fixed-capacity variant -- results land directly in caller storage, never allocates
+int Octree::find(glm::vec3 target,
+                 int       k,
+                 long*     nearest_k_ids,
+                 float*    nearest_k_dists,
+                 float     radius) const
+{
+    if(k <= 0) {
+        return 0;
+    }
+    int nearest_k_count = 0;
+    find_hier(target, k, nearest_k_ids, nearest_k_dists, &nearest_k_count, true, radius);
+    return nearest_k_count;
+}
+
+// insertion into a sorted list of at most k -- k is small, so this beats a heap
+static void insert_nearest_k(long   id,
+                             float  dist,
+                             int    k,
+                             long*  nearest_k_ids,
+                             float* nearest_k_dists,
+                             int*   nearest_k_count)
 {
-    // apply early prune near root; theoretically efficient, in practice very expensive
-    if(m_depth <= EARLY_PRUNE_LEVELS) {
-        TransformObject transform_object("", m_origin);
-        if(!BBoxObject(glm::vec3(0), m_dim).is_sphere_collide(&transform_object,
-                                                              target,
-                                                              radius))
-        {
-            return;
+    if(*nearest_k_count == k && dist >= nearest_k_dists[k - 1]) {
+        return;
+    }
+    int i = (*nearest_k_count < k) ? (*nearest_k_count)++ : k - 1;
+    while(i > 0 && nearest_k_dists[i - 1] > dist) {
+        nearest_k_ids[i]   = nearest_k_ids[i - 1];
+        nearest_k_dists[i] = nearest_k_dists[i - 1];
+        i--;
+    }
+    nearest_k_ids[i]   = id;
+    nearest_k_dists[i] = dist;
+}
+
+void Octree::find_hier(glm::vec3 target,
+                       int       k,
+                       long*     nearest_k_ids,
+                       float*    nearest_k_dists,
+                       int*      nearest_k_count,
+                       bool      is_direct_lineage,
+                       float     radius) const
+{
+    // apply early prune near root -- sphere bbox against node bbox
+    if(radius > 0 && m_depth <= EARLY_PRUNE_LEVELS) {
+        glm::vec3 opposite = m_origin + m_dim;
+        for(int i = 0; i < 3; i++) {
+            if(target[i] + radius < m_origin[i] || target[i] - radius > opposite[i]) {
+                return; // all it takes is one gap
+            }
         }
     }
 
@@ -177,13 +255,13 @@ void Octree::find_hier(glm::vec3
     //==========
 
     if(is_leaf()) {
-        for(std::map<long, glm::vec3>::const_iterator p = m_leaf_objects.begin(); p != m_leaf_objects.end(); ++p) {
-            long      id  = (*p).first;
-            glm::vec3 pos = (*p).second;
+        for(int i = 0; i < static_cast<int>(m_leaf_ids.size()); i++) {
+            long      id  = m_leaf_ids[i];
+            glm::vec3 pos = m_leaf_positions[i];
             if(radius > 0 && glm::distance(pos, target) > radius) { // apply radius filter
                 continue;
             }
-            nearest_k_pq->push(id_dist_t(id, glm::distance(pos, target))); // record ALL visited objects (filtered)
+            insert_nearest_k(id, glm::distance(pos, target), k, nearest_k_ids, nearest_k_dists, nearest_k_count); // keep k nearest visited (filtered)
         }
         return;
     }
@@ -199,7 +277,7 @@ void Octree::find_hier(glm::vec3
 
     // search best-candidate octant
     if(m_nodes[octant_index]) {
-        m_nodes[octant_index]->find_hier(target, k, nearest_k_pq, is_direct_lineage, radius);
+        m_nodes[octant_index]->find_hier(target, k, nearest_k_ids, nearest_k_dists, nearest_k_count, is_direct_lineage, radius);
     }
 
     // stop here if best-candidate octant results sufficient
@@ -246,9 +324,9 @@ void Octree::find_hier(glm::vec3
     nearest_wall_distance = std::min(nearest_wall_distance, static_cast<float>(fabs(target.y - opposite.y)));
     nearest_wall_distance = std::min(nearest_wall_distance, static_cast<float>(fabs(target.z - opposite.z)));
 
-    float farthest_object_distance = nearest_k_pq->size() ? nearest_k_pq->top().second : 0;
+    float farthest_object_distance = *nearest_k_count ? nearest_k_dists[*nearest_k_count - 1] : 0;
     bool should_search_siblings = !is_direct_lineage || (farthest_object_distance > nearest_wall_distance);
-    if(static_cast<int>(nearest_k_pq->size()) >= k && !should_search_siblings) {
+    if(*nearest_k_count >= k && !should_search_siblings) {
         return;
     }
 
@@ -258,99 +336,165 @@ void Octree::find_hier(glm::vec3
             continue;
         }
         if(m_nodes[i]) {
-            m_nodes[i]->find_hier(target, k, nearest_k_pq, false, radius);
+            m_nodes[i]->find_hier(target, k, nearest_k_ids, nearest_k_dists, nearest_k_count, false, radius);
         }
     }
 }
 
 bool Octree::exists(long id)
 {
-    if(is_leaf()) {
-        std::map<long, glm::vec3>::iterator p = m_leaf_objects.find(id);
-        if(p != m_leaf_objects.end()) {
-            return true; // find core action
-        }
+    return id >= 0 && static_cast<size_t>(id) < m_root->m_object_nodes.size() && m_root->m_object_nodes[id];
+}
+
+// leaves the object in its current leaf -- rebalance re-homes it if it left the leaf's bbox
+bool Octree::move(long id, glm::vec3 pos)
+{
+    if(!exists(id)) {
         return false;
     }
-    for(int i = 0; i < 8; i++) {
-        if(!m_nodes[i]) {
-            continue;
-        }
-        if(m_nodes[i]->exists(id)) {
-            return true;
-        }
-    }
-    return false;
+    Octree* node = m_root->m_object_nodes[id];
+    node->m_leaf_positions[m_root->m_object_slots[id]] = pos; // move core action
+    node->mark_dirty_mass();
+    return true;
 }
 
-bool Octree::move(long id, glm::vec3 pos)
+bool Octree::rebalance()
 {
+    bool changed = false;
     if(is_leaf()) {
-        std::map<long, glm::vec3>::iterator p = m_leaf_objects.find(id);
-        if(p != m_leaf_objects.end()) {
-            (*p).second = pos; // move core action
-            return true;
+        // swap-remove pulls the last entry into slot i, so only advance when the slot stays put
+        int i = 0;
+        while(i < static_cast<int>(m_leaf_ids.size())) {
+            if(within_bbox(m_leaf_positions[i])) {
+                i++;
+                continue;
+            }
+            long      id  = m_leaf_ids[i];
+            glm::vec3 pos = m_leaf_positions[i];
+
+            // remove from subtree
+            erase_leaf_slot(i);
+
+            // add back to first including parent node -- never this leaf, pos is outside it
+            Octree* node = first_including_parent_node(pos);
+            if(node) {
+                node->insert(id, pos);
+            }
+            changed = true;
         }
-        return false;
+        return changed;
     }
     for(int i = 0; i < 8; i++) {
         if(!m_nodes[i]) {
             continue;
         }
-        if(m_nodes[i]->move(id, pos)) {
-            return true;
+        changed |= m_nodes[i]->rebalance();
+    }
+    return changed;
+}
+
+//================
+// mass aggregates
+//================
+
+void Octree::set_mass(long id, float mass)
+{
+    if(id < 0) {
+        return;
+    }
+    std::vector<float> &object_masses = m_root->m_object_masses;
+    if(static_cast<size_t>(id) >= object_masses.size()) {
+        if(mass == 1) {
+            return; // unit mass is the default
         }
+        object_masses.resize(id + 1, 1);
+    }
+    object_masses[id] = mass;
+    if(mass != 1) {
+        m_root->m_has_masses = true;
+    }
+    if(exists(id)) {
+        m_root->m_object_nodes[id]->mark_dirty_mass();
     }
-    return false;
 }
 
-bool Octree::rebalance()
+float Octree::get_mass(long id) const
 {
-    bool changed = false;
+    const std::vector<float> &object_masses = m_root->m_object_masses;
+    return (id >= 0 && static_cast<size_t>(id) < object_masses.size()) ? object_masses[id] : 1;
+}
+
+void Octree::refit()
+{
+    if(!m_is_dirty_mass) {
+        return;
+    }
+    float     mass = 0;
+    glm::vec3 mass_moment(0);
     if(is_leaf()) {
-        std::vector<long> remove_vec;
-        for(std::map<long, glm::vec3>::iterator p = m_leaf_objects.begin(); p != m_leaf_objects.end(); ++p) {
-            long      id  = (*p).first;
-            glm::vec3 pos = (*p).second;
-            if(!within_bbox(pos)) {
-                remove_vec.push_back(id);
-            }
+        bool has_masses = m_root->m_has_masses;
+        for(int i = 0; i < static_cast<int>(m_leaf_ids.size()); i++) {
+            float object_mass = has_masses ? get_mass(m_leaf_ids[i]) : 1;
+            mass        += object_mass;
+            mass_moment += m_leaf_positions[i] * object_mass;
         }
-        for(std::vector<long>::iterator q = remove_vec.begin(); q != remove_vec.end(); ++q) {
-            long id = *q;
-            std::map<long, glm::vec3>::iterator r = m_leaf_objects.find(id);
-            if(r == m_leaf_objects.end()) {
+    } else {
+        for(int i = 0; i < 8; i++) {
+            if(!m_nodes[i]) {
                 continue;
             }
+            m_nodes[i]->refit();
+            mass        += m_nodes[i]->m_mass;
+            mass_moment += m_nodes[i]->m_mass_center * m_nodes[i]->m_mass;
+        }
+    }
+    m_mass          = mass;
+    m_mass_center   = (mass > 0) ? mass_moment / mass : m_center;
+    m_is_dirty_mass = false;
+}
 
-            // remove from subtree
-            if(!remove(id)) {
+// barnes-hut -- a node far enough away (size / distance < theta) acts as one body at its center of mass
+glm::vec3 Octree::get_gravitational_field(glm::vec3 target,
+                                          float     theta,
+                                          float     softening,
+                                          long      exclude_id) const
+{
+    glm::vec3 field(0);
+    if(m_mass <= 0) {
+        return field;
+    }
+    float softening_sq = softening * softening;
+    if(is_leaf()) {
+        bool has_masses = m_root->m_has_masses;
+        for(int i = 0; i < static_cast<int>(m_leaf_ids.size()); i++) {
+            if(m_leaf_ids[i] == exclude_id) {
                 continue;
             }
-
-            // add back to first including parent node
-            glm::vec3 pos = (*r).second;
-            Octree* node = first_including_parent_node(pos);
-            if(node) {
-                if(!node->insert(id, pos)) {
-                    continue;
-                }
+            glm::vec3 offset  = m_leaf_positions[i] - target;
+            float     dist_sq = glm::dot(offset, offset) + softening_sq;
+            if(dist_sq < EPSILON) {
+                continue;
             }
-
-            changed = true;
+            float object_mass = has_masses ? get_mass(m_leaf_ids[i]) : 1;
+            float dist        = sqrt(dist_sq);
+            field += offset * (object_mass / (dist_sq * dist));
         }
-        return changed;
+        return field;
+    }
+    glm::vec3 offset  = m_mass_center - target;
+    float     dist_sq = glm::dot(offset, offset) + softening_sq;
+    float     size    = std::max(m_dim.x, std::max(m_dim.y, m_dim.z));
+    if(!within_bbox(target) && size * size < theta * theta * dist_sq) {
+        float dist = sqrt(dist_sq);
+        return offset * (m_mass / (dist_sq * dist));
     }
     for(int i = 0; i < 8; i++) {
         if(!m_nodes[i]) {
             continue;
         }
-        changed |= m_nodes[i]->rebalance();
+        field += m_nodes[i]->get_gravitational_field(target, theta, softening, exclude_id);
     }
-    if(is_root()) {
-        prune_empty_nodes();
-    }
-    return changed;
+    return field;
 }
 
 std::string Octree::get_name() const
@@ -396,7 +540,7 @@ Octree* Octree::alloc_octant(glm::vec3 pos)
     if(!m_nodes[octant_index]) {
         glm::vec3 points[8];
         glm::vec3 half_dim = m_dim * 0.5f;
-        vt::PrimitiveFactory::get_box_corners(points, &m_origin, &half_dim);
+        vt::get_box_corners(points, &m_origin, &half_dim);
         m_nodes[octant_index] = new Octree(points[octant_index], half_dim, octant_index, m_depth + 1, this, m_root);
         m_child_count++;
     }
@@ -464,6 +608,14 @@ int Octree::get_octant_index(glm::vec3 pos) const
     return -1;
 }
 
+// the invariant is that every ancestor of a dirty node is dirty too
+void Octree::mark_dirty_mass()
+{
+    for(Octree* node = this; node && !node->m_is_dirty_mass; node = node->m_parent) {
+        node->m_is_dirty_mass = true;
+    }
+}
+
 bool Octree::within_bbox(glm::vec3 pos) const
 {
     glm::vec3 min = m_origin;
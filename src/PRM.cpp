@@ -18,8 +18,11 @@
 #include <PRM.h>
 #include <Util.h>
 #include <vector>
+#include <map>
 #include <set>
 #include <tuple>
+#include <utility>
+#include <stdlib.h>
 #include <glm/glm.hpp>
 #include <math.h>
 
@@ -40,8 +43,10 @@ void PRM_Waypoint::disconnect(int neighbor_index)
     m_neighbor_indices.erase(neighbor_index);
 }
 
-PRM::PRM(Octree* octree)
-    : m_octree(octree)
+PRM::PRM(Octree* octree, unsigned int seed)
+    : m_octree(octree),
+      m_rng(seed),
+      m_agent_radius(0)
 {
 }
 
@@ -49,20 +54,127 @@ PRM::~PRM()
 {
 }
 
-void PRM::randomize_waypoints(size_t n)
+// https://en.wikipedia.org/wiki/Halton_sequence
+static float radical_inverse(unsigned int index, unsigned int base)
+{
+    float result = 0;
+    float digit_weight = 1.0f / base;
+    while(index) {
+        result += (index % base) * digit_weight;
+        index /= base;
+        digit_weight /= base;
+    }
+    return result;
+}
+
+// https://web.maths.unsw.edu.au/~fkuo/sobol/ (Joe-Kuo direction numbers, first 3 dimensions)
+static glm::vec3 sobol_point(unsigned int index)
+{
+    static unsigned int direction_numbers[3][32];
+    static bool is_init = false;
+    if(!is_init) {
+        const unsigned int s[3]    = {0, 1, 2};
+        const unsigned int a[3]    = {0, 0, 1};
+        const unsigned int m[3][2] = {{0, 0}, {1, 0}, {1, 3}};
+        for(int k = 0; k < 32; k++) {
+            direction_numbers[0][k] = 1u << (31 - k);
+        }
+        for(int d = 1; d < 3; d++) {
+            unsigned int* v = direction_numbers[d];
+            for(int k = 0; k < 32; k++) {
+                if(k < static_cast<int>(s[d])) {
+                    v[k] = m[d][k] << (31 - k);
+                    continue;
+                }
+                v[k] = v[k - s[d]] ^ (v[k - s[d]] >> s[d]);
+                for(int j = 1; j < static_cast<int>(s[d]); j++) {
+                    v[k] ^= ((a[d] >> (s[d] - 1 - j)) & 1) * v[k - j];
+                }
+            }
+        }
+        is_init = true;
+    }
+    unsigned int gray_code = index ^ (index >> 1);
+    unsigned int x[3] = {0, 0, 0};
+    for(int k = 0; k < 32 && gray_code; k++, gray_code >>= 1) {
+        if(gray_code & 1) {
+            for(int d = 0; d < 3; d++) {
+                x[d] ^= direction_numbers[d][k];
+            }
+        }
+    }
+    const float scale = 1.0f / 4294967296.0f; // 2^32
+    return glm::vec3(x[0] * scale, x[1] * scale, x[2] * scale);
+}
+
+// http://www.cs.columbia.edu/~allen/F15/NOTES/Probabilisticpath.pdf (Gaussian and bridge-test sampling)
+void PRM::randomize_waypoints(size_t        n,
+                              sample_type_t sample_type,
+                              float         sample_sigma)
 {
     m_octree->clear();
     m_waypoints.clear();
     glm::vec3 scatter_min = m_octree->get_origin();
     glm::vec3 scatter_max = m_octree->get_origin() + m_octree->get_dim();
-    for(int i = 0; i < static_cast<int>(n); i++) {
-        glm::vec3 rand_vec(static_cast<float>(rand()) / RAND_MAX,
-                           static_cast<float>(rand()) / RAND_MAX,
-                           static_cast<float>(rand()) / RAND_MAX);
-        glm::vec3 origin = MIX(scatter_min, scatter_max, rand_vec);
-        m_octree->insert(i, origin);
-        PRM_Waypoint* waypoint = new PRM_Waypoint(origin);
-        m_waypoints.push_back(waypoint);
+    float sigma = (sample_sigma > 0) ? sample_sigma : glm::length(m_octree->get_dim()) * 0.05f;
+    size_t max_attempts = n * 100; // obstacle-biased samplers reject most candidates
+    size_t attempts = 0;
+    while(m_waypoints.size() < n) {
+        switch(sample_type) {
+            case SAMPLE_TYPE_UNIFORM:
+                add_waypoint(sample_uniform());
+                break;
+            case SAMPLE_TYPE_HALTON:
+                {
+                    unsigned int index = m_waypoints.size() + 1; // skip origin
+                    glm::vec3 alpha(radical_inverse(index, 2),
+                                    radical_inverse(index, 3),
+                                    radical_inverse(index, 5));
+                    add_waypoint(MIX(scatter_min, scatter_max, alpha));
+                }
+                break;
+            case SAMPLE_TYPE_SOBOL:
+                add_waypoint(MIX(scatter_min, scatter_max, sobol_point(m_waypoints.size() + 1))); // skip origin
+                break;
+            case SAMPLE_TYPE_GAUSSIAN:
+                {
+                    // keep the free sample of a pair straddling an obstacle surface
+                    glm::vec3 p1 = sample_uniform();
+                    glm::vec3 p2 = sample_gaussian(p1, sigma);
+                    bool is_p1_collide = is_point_collide(p1);
+                    bool is_p2_collide = is_point_collide(p2);
+                    if(is_p1_collide != is_p2_collide) {
+                        glm::vec3 origin = is_p1_collide ? p2 : p1;
+                        if(is_within(origin, scatter_min, scatter_max)) {
+                            add_waypoint(origin);
+                        }
+                    }
+                }
+                break;
+            case SAMPLE_TYPE_BRIDGE:
+                {
+                    // keep the free midpoint of a short bridge whose endpoints both collide
+                    glm::vec3 p1 = sample_uniform();
+                    if(!is_point_collide(p1)) {
+                        break;
+                    }
+                    glm::vec3 p2 = sample_gaussian(p1, sigma);
+                    if(!is_point_collide(p2)) {
+                        break;
+                    }
+                    glm::vec3 midpoint = (p1 + p2) * 0.5f;
+                    if(!is_point_collide(midpoint) && is_within(midpoint, scatter_min, scatter_max)) {
+                        add_waypoint(midpoint);
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        if(++attempts >= max_attempts) {
+            std::cout << "Info: PRM sampler gave up after " << attempts << " attempts with " << m_waypoints.size() << " waypoints" << std::endl;
+            break;
+        }
     }
 }
 
@@ -173,28 +285,22 @@ bool PRM::find_shortest_path(glm::vec3 start_pos, glm::vec3 finish_pos, std::vec
 
 void PRM::prune_edges()
 {
+    std::vector<std::pair<glm::vec3, glm::vec3>> segments;
+    for(std::vector<std::tuple<int, int, float>>::iterator p = m_edges.begin(); p != m_edges.end(); ++p) {
+        segments.push_back(std::make_pair(m_waypoints[std::get<EXPORT_EDGE_P1>(*p)]->get_origin(),
+                                          m_waypoints[std::get<EXPORT_EDGE_P2>(*p)]->get_origin()));
+    }
+    std::vector<bool> is_collide_vec;
+    find_segment_collisions(segments, &is_collide_vec);
     for(int i = m_edges.size() - 1; i >= 0; i--) {
-        int p1_index = std::get<EXPORT_EDGE_P1>(m_edges[i]);
-        int p2_index = std::get<EXPORT_EDGE_P2>(m_edges[i]);
-        glm::vec3 p1 = m_waypoints[p1_index]->get_origin();
-        glm::vec3 p2 = m_waypoints[p2_index]->get_origin();
-        float dist = glm::distance(p1, p2);
-        if(dist < EPSILON) {
+        if(!is_collide_vec[i]) {
             continue;
         }
-        glm::vec3 dir = glm::normalize(p2 - p1);
-        bool is_collide = false;
-        for(std::vector<Mesh*>::iterator q = m_obstacles.begin(); q != m_obstacles.end(); ++q) {
-            if((*q)->is_ray_intersect(*q, p1, dir)) {
-                is_collide = true;
-                break;
-            }
-        }
-        if(is_collide) {
-            m_edges.erase(m_edges.begin() + i);
-            m_waypoints[p1_index]->disconnect(p2_index);
-            m_waypoints[p2_index]->disconnect(p1_index);
-        }
+        int p1_index = std::get<EXPORT_EDGE_P1>(m_edges[i]);
+        int p2_index = std::get<EXPORT_EDGE_P2>(m_edges[i]);
+        m_edges.erase(m_edges.begin() + i);
+        m_waypoints[p1_index]->disconnect(p2_index);
+        m_waypoints[p2_index]->disconnect(p1_index);
     }
 }
 
@@ -221,6 +327,253 @@ bool PRM::export_edges(std::vector<std::tuple<int, int, float>>* edges) const
     return true;
 }
 
+bool PRM::export_path_values(const std::vector<int>& path, std::vector<glm::vec3>* path_values) const
+{
+    if(!path_values) {
+        return false;
+    }
+    for(std::vector<int>::const_iterator p = path.begin(); p != path.end(); ++p) {
+        PRM_Waypoint* waypoint = at(*p);
+        if(!waypoint) {
+            return false;
+        }
+        path_values->push_back(waypoint->get_origin());
+    }
+    return true;
+}
+
+//=====================
+// path post-processing
+//=====================
+
+// https://en.wikipedia.org/wiki/Any-angle_path_planning
+bool PRM::shortcut_path(std::vector<glm::vec3>* path_values,
+                        shortcut_type_t         shortcut_type,
+                        int                     iters)
+{
+    if(!path_values) {
+        return false;
+    }
+    if(path_values->size() < 3) {
+        return true; // nothing to shortcut
+    }
+    switch(shortcut_type) {
+        case SHORTCUT_TYPE_GREEDY:
+            {
+                // from each vertex, jump to the farthest vertex still in line-of-sight
+                std::vector<glm::vec3> shortcut_path_values;
+                int n = path_values->size();
+                int i = 0;
+                shortcut_path_values.push_back((*path_values)[0]);
+                while(i < n - 1) {
+                    std::vector<std::pair<glm::vec3, glm::vec3>> segments;
+                    for(int j = n - 1; j > i + 1; j--) {
+                        segments.push_back(std::make_pair((*path_values)[i], (*path_values)[j]));
+                    }
+                    std::vector<bool> is_collide_vec;
+                    find_segment_collisions(segments, &is_collide_vec);
+                    int next_index = i + 1; // adjacent vertices always in line-of-sight
+                    for(int k = 0; k < static_cast<int>(is_collide_vec.size()); k++) {
+                        if(!is_collide_vec[k]) {
+                            next_index = n - 1 - k;
+                            break;
+                        }
+                    }
+                    shortcut_path_values.push_back((*path_values)[next_index]);
+                    i = next_index;
+                }
+                *path_values = shortcut_path_values;
+            }
+            break;
+        case SHORTCUT_TYPE_RANDOM:
+            {
+                // each round, validate a batch of random vertex pairs and splice in non-overlapping winners
+                int batch_size = std::max(static_cast<int>(path_values->size()) / 2, 1);
+                for(int round = 0; round < iters && path_values->size() >= 3; round++) {
+                    int n = path_values->size();
+                    std::vector<std::pair<int, int>>             index_pairs;
+                    std::vector<std::pair<glm::vec3, glm::vec3>> segments;
+                    for(int k = 0; k < batch_size; k++) {
+                        std::uniform_int_distribution<int> i_distribution(0, n - 3);
+                        int i = i_distribution(m_rng);
+                        std::uniform_int_distribution<int> j_distribution(i + 2, n - 1);
+                        int j = j_distribution(m_rng);
+                        index_pairs.push_back(std::make_pair(i, j));
+                        segments.push_back(std::make_pair((*path_values)[i], (*path_values)[j]));
+                    }
+                    std::vector<bool> is_collide_vec;
+                    find_segment_collisions(segments, &is_collide_vec);
+                    std::vector<bool> is_removed(n, false);
+                    std::vector<bool> is_pinned(n, false);
+                    for(int k = 0; k < batch_size; k++) {
+                        if(is_collide_vec[k]) {
+                            continue;
+                        }
+                        int i = index_pairs[k].first;
+                        int j = index_pairs[k].second;
+                        bool is_overlap = is_removed[i] || is_removed[j];
+                        for(int m = i + 1; m < j && !is_overlap; m++) {
+                            is_overlap = is_removed[m] || is_pinned[m];
+                        }
+                        if(is_overlap) {
+                            continue;
+                        }
+                        for(int m = i + 1; m < j; m++) {
+                            is_removed[m] = true;
+                        }
+                        is_pinned[i] = is_pinned[j] = true;
+                    }
+                    std::vector<glm::vec3> shortcut_path_values;
+                    for(int m = 0; m < n; m++) {
+                        if(!is_removed[m]) {
+                            shortcut_path_values.push_back((*path_values)[m]);
+                        }
+                    }
+                    *path_values = shortcut_path_values;
+                }
+            }
+            break;
+    }
+    return true;
+}
+
+bool PRM::smooth_path(const std::vector<glm::vec3>& path_values,
+                      int                           samples_per_segment,
+                      float                         control_point_scale,
+                      std::vector<glm::vec3>*       smooth_path_values) const
+{
+    if(!smooth_path_values || samples_per_segment < 1) {
+        return false;
+    }
+    int n = path_values.size();
+    if(n < 3) {
+        *smooth_path_values = path_values;
+        return true;
+    }
+
+    // same control point placement as Keyframe::update_control_points
+    std::vector<glm::vec3> control_points1(n);
+    std::vector<glm::vec3> control_points2(n);
+    for(int i = 0; i < n; i++) {
+        glm::vec3 prev_point = path_values[std::max(i - 1, 0)];
+        glm::vec3 next_point = path_values[std::min(i + 1, n - 1)];
+        glm::vec3 control_point_offset = (next_point - prev_point) * 0.5f * control_point_scale;
+        if(i == 0 || i == n - 1) {
+            control_point_offset = glm::vec3(0);
+        }
+        control_points1[i] = path_values[i] - control_point_offset;
+        control_points2[i] = path_values[i] + control_point_offset;
+    }
+
+    // sample each curved segment, then validate all samples in one batch
+    std::vector<std::pair<glm::vec3, glm::vec3>> segments;
+    for(int i = 0; i < n - 1; i++) {
+        glm::vec3 prev_sample = path_values[i];
+        for(int j = 1; j <= samples_per_segment; j++) {
+            float alpha = static_cast<float>(j) / samples_per_segment;
+            glm::vec3 sample = bezier_interpolate(path_values[i], control_points2[i], control_points1[i + 1], path_values[i + 1], alpha);
+            segments.push_back(std::make_pair(prev_sample, sample));
+            prev_sample = sample;
+        }
+    }
+    std::vector<bool> is_collide_vec;
+    find_segment_collisions(segments, &is_collide_vec);
+
+    // keep curved segments that stay clear, fall back to straight segments elsewhere
+    smooth_path_values->push_back(path_values[0]);
+    for(int i = 0; i < n - 1; i++) {
+        bool is_collide = false;
+        for(int j = 0; j < samples_per_segment && !is_collide; j++) {
+            is_collide = is_collide_vec[i * samples_per_segment + j];
+        }
+        if(is_collide) {
+            smooth_path_values->push_back(path_values[i + 1]);
+            continue;
+        }
+        for(int j = 0; j < samples_per_segment; j++) {
+            smooth_path_values->push_back(segments[i * samples_per_segment + j].second);
+        }
+    }
+    return true;
+}
+
+bool PRM::is_point_collide(glm::vec3 pos) const
+{
+    std::vector<std::pair<glm::vec3, glm::vec3>> segments;
+    segments.push_back(std::make_pair(pos, pos));
+    std::vector<bool> is_collide_vec;
+    find_segment_collisions(segments, &is_collide_vec);
+    return is_collide_vec[0];
+}
+
+bool PRM::is_segment_collide(glm::vec3 p1, glm::vec3 p2) const
+{
+    std::vector<std::pair<glm::vec3, glm::vec3>> segments;
+    segments.push_back(std::make_pair(p1, p2));
+    std::vector<bool> is_collide_vec;
+    find_segment_collisions(segments, &is_collide_vec);
+    return is_collide_vec[0];
+}
+
+// obstacle-major traversal so each obstacle transform and inverse is computed once per batch
+void PRM::find_segment_collisions(const std::vector<std::pair<glm::vec3, glm::vec3>>& segments,
+                                  std::vector<bool>*                                  is_collide_vec) const
+{
+    if(!is_collide_vec) {
+        return;
+    }
+    is_collide_vec->assign(segments.size(), false);
+    for(std::vector<Mesh*>::const_iterator p = m_obstacles.begin(); p != m_obstacles.end(); ++p) {
+        glm::mat4 obstacle_transform         = (*p)->get_transform();
+        glm::mat4 obstacle_inverse_transform = (*p)->get_inverse_transform();
+        glm::vec3 obstacle_min;
+        glm::vec3 obstacle_max;
+        (*p)->get_min_max(&obstacle_min, &obstacle_max);
+
+        // bounding sphere for early out
+        glm::vec3 obstacle_center = glm::vec3(obstacle_transform * glm::vec4((obstacle_min + obstacle_max) * 0.5f, 1));
+        float     obstacle_radius = glm::distance(glm::vec3(obstacle_transform * glm::vec4(obstacle_min, 1)),
+                                                  glm::vec3(obstacle_transform * glm::vec4(obstacle_max, 1))) * 0.5f;
+        float     reach_radius    = obstacle_radius + m_agent_radius;
+
+        for(int i = 0; i < static_cast<int>(segments.size()); i++) {
+            if((*is_collide_vec)[i]) {
+                continue;
+            }
+            glm::vec3 p1 = segments[i].first;
+            glm::vec3 p2 = segments[i].second;
+
+            // test if segment comes within reach of bounding sphere
+            glm::vec3 segment_dir      = p2 - p1;
+            float     segment_length2  = glm::dot(segment_dir, segment_dir);
+            float     alpha            = (segment_length2 < EPSILON) ? 0 : CLAMP(glm::dot(obstacle_center - p1, segment_dir) / segment_length2, 0.0f, 1.0f);
+            glm::vec3 nearest_point    = p1 + segment_dir * alpha;
+            if(glm::distance(nearest_point, obstacle_center) > reach_radius) {
+                continue; // if not, no point in testing OOB collision
+            }
+
+            // zero-length segment is a point test -- never skip it, the obstacle-biased samplers depend on it
+            if(segment_length2 < EPSILON && m_agent_radius <= 0) {
+                if(is_within(glm::vec3(obstacle_inverse_transform * glm::vec4(p1, 1)), obstacle_min, obstacle_max)) {
+                    (*is_collide_vec)[i] = true;
+                }
+                continue;
+            }
+
+            if(capsule_box_intersect(obstacle_transform,
+                                     obstacle_inverse_transform,
+                                     obstacle_min,
+                                     obstacle_max,
+                                     p1,
+                                     p2,
+                                     m_agent_radius))
+            {
+                (*is_collide_vec)[i] = true;
+            }
+        }
+    }
+}
+
 void PRM::add_obstacle(Mesh* obstacle)
 {
     m_obstacles.push_back(obstacle);
@@ -245,4 +598,28 @@ void PRM::clear()
     m_obstacles.clear();
 }
 
+glm::vec3 PRM::sample_uniform()
+{
+    std::uniform_real_distribution<float> distribution(0, 1);
+    glm::vec3 rand_vec(distribution(m_rng),
+                       distribution(m_rng),
+                       distribution(m_rng));
+    return MIX(m_octree->get_origin(), m_octree->get_origin() + m_octree->get_dim(), rand_vec);
+}
+
+glm::vec3 PRM::sample_gaussian(glm::vec3 center, float sigma)
+{
+    std::normal_distribution<float> distribution(0, sigma);
+    return center + glm::vec3(distribution(m_rng),
+                              distribution(m_rng),
+                              distribution(m_rng));
+}
+
+void PRM::add_waypoint(glm::vec3 origin)
+{
+    m_octree->insert(m_waypoints.size(), origin);
+    PRM_Waypoint* waypoint = new PRM_Waypoint(origin);
+    m_waypoints.push_back(waypoint);
+}
+
 }
@@ -0,0 +1,271 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ParallelMechanism.h>
+#include <Util.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+namespace vt {
+
+//================
+// StewartPlatform
+//================
+
+StewartPlatform::StewartPlatform()
+{
+}
+
+StewartPlatform::~StewartPlatform()
+{
+}
+
+int StewartPlatform::add_leg(glm::vec3 base_anchor,
+                             glm::vec3 local_platform_anchor,
+                             float     min_length,
+                             float     max_length)
+{
+    m_base_anchors.push_back(base_anchor);
+    m_local_platform_anchors.push_back(local_platform_anchor);
+    m_min_lengths.push_back(min_length);
+    m_max_lengths.push_back(max_length);
+    return m_base_anchors.size() - 1;
+}
+
+void StewartPlatform::clear()
+{
+    m_base_anchors.clear();
+    m_local_platform_anchors.clear();
+    m_min_lengths.clear();
+    m_max_lengths.clear();
+}
+
+// actuator length is just the anchor-to-anchor distance
+bool StewartPlatform::solve_ik(const glm::mat4 &platform_transform, float* lengths) const
+{
+    bool is_valid = true;
+    int n = size();
+    for(int i = 0; i < n; i++) {
+        glm::vec3 platform_anchor = glm::vec3(platform_transform * glm::vec4(m_local_platform_anchors[i], 1));
+        lengths[i] = glm::distance(platform_anchor, m_base_anchors[i]);
+        if(lengths[i] < m_min_lengths[i] || lengths[i] > m_max_lengths[i]) {
+            is_valid = false;
+        }
+    }
+    return is_valid;
+}
+
+void StewartPlatform::solve_ik_batch(const glm::mat4* platform_transforms,
+                                     size_t           count,
+                                     float*           lengths,
+                                     char*            is_valid) const
+{
+    int n = size();
+    for(size_t i = 0; i < count; i++) {
+        is_valid[i] = solve_ik(platform_transforms[i], &lengths[i * n]);
+    }
+}
+
+// unknowns are platform translation and a small rotation applied on the left (6 dof)
+// residual_i = |p + R * a_i - b_i| - length_i, row_i = [u_i, (R * a_i) x u_i]
+bool StewartPlatform::solve_fk(const float* lengths,
+                               glm::mat4*   platform_transform,
+                               int          iters,
+                               float        accept_length_error) const
+{
+    int n = size();
+    if(!n || !platform_transform) {
+        return false;
+    }
+    glm::vec3 origin      = glm::vec3((*platform_transform)[3]);
+    glm::quat orientation = glm::normalize(glm::quat_cast(glm::mat3(*platform_transform)));
+    std::vector<float> jacobian(n * 6);
+    std::vector<float> residuals(n);
+    bool is_solved = false;
+    for(int i = 0;; i++) {
+        float max_error = 0;
+        for(int j = 0; j < n; j++) {
+            glm::vec3 arm = orientation * m_local_platform_anchors[j];
+            glm::vec3 leg = origin + arm - m_base_anchors[j];
+            float length = glm::length(leg);
+            if(length < EPSILON) {
+                return false;
+            }
+            glm::vec3 u = leg / length;
+            glm::vec3 w = glm::cross(arm, u);
+            residuals[j] = length - lengths[j];
+            max_error    = std::max(max_error, static_cast<float>(fabs(residuals[j])));
+            for(int k = 0; k < 3; k++) {
+                jacobian[j * 6 + k]     = u[k];
+                jacobian[j * 6 + 3 + k] = w[k];
+            }
+        }
+        if(max_error < accept_length_error) {
+            is_solved = true;
+            break;
+        }
+        if(i == iters) {
+            break;
+        }
+
+        // gauss-newton with light damping -- (J^T * J + damping^2 * I) * dx = -J^T * r
+        float jtj[36];
+        float rhs[6];
+        for(int r1 = 0; r1 < 6; r1++) {
+            for(int r2 = 0; r2 < 6; r2++) {
+                float sum = (r1 == r2) ? EPSILON : 0;
+                for(int j = 0; j < n; j++) {
+                    sum += jacobian[j * 6 + r1] * jacobian[j * 6 + r2];
+                }
+                jtj[r1 * 6 + r2] = sum;
+            }
+            float sum = 0;
+            for(int j = 0; j < n; j++) {
+                sum -= jacobian[j * 6 + r1] * residuals[j];
+            }
+            rhs[r1] = sum;
+        }
+        if(!solve_linear_system(jtj, rhs, 6)) {
+            break;
+        }
+        origin += glm::vec3(rhs[0], rhs[1], rhs[2]);
+        glm::vec3 rotation_delta(rhs[3], rhs[4], rhs[5]);
+        float angle = glm::length(rotation_delta);
+        if(angle > EPSILON * EPSILON) {
+            orientation = glm::normalize(GLM_ANGLE_AXIS(glm::degrees(angle), rotation_delta / angle) * orientation);
+        }
+    }
+    *platform_transform = glm::translate(glm::mat4(1), origin) * glm::mat4_cast(orientation);
+    return is_solved;
+}
+
+//===========
+// DeltaRobot
+//===========
+
+DeltaRobot::DeltaRobot(float base_radius,
+                       float effector_radius,
+                       float upper_arm_length,
+                       float forearm_length,
+                       int   arm_count)
+    : m_base_radius(base_radius),
+      m_effector_radius(effector_radius),
+      m_upper_arm_length(upper_arm_length),
+      m_forearm_length(forearm_length),
+      m_arm_count(arm_count)
+{
+}
+
+DeltaRobot::~DeltaRobot()
+{
+}
+
+glm::vec3 DeltaRobot::get_arm_dir(int arm_index) const
+{
+    return euler_to_offset(glm::vec3(0, 0, arm_index * 360.0f / m_arm_count));
+}
+
+glm::vec3 DeltaRobot::get_elbow(int arm_index, float angle) const
+{
+    float theta = glm::radians(angle);
+    return get_arm_dir(arm_index) * (m_base_radius + m_upper_arm_length * cos(theta)) -
+           VEC_UP * (m_upper_arm_length * static_cast<float>(sin(theta)));
+}
+
+// in each arm's vertical plane the elbow circle meets the forearm sphere where
+// A * cos(theta) + B * sin(theta) = K -- pick the elbow-out root
+bool DeltaRobot::solve_ik(glm::vec3 effector_origin, float* angles) const
+{
+    bool is_valid = true;
+    for(int i = 0; i < m_arm_count; i++) {
+        glm::vec3 arm_dir     = get_arm_dir(i);
+        glm::vec3 tangent_dir = glm::normalize(glm::cross(arm_dir, VEC_UP));
+        float ex = glm::dot(effector_origin, arm_dir) + m_effector_radius;
+        float ey = effector_origin.y;
+        float ez = glm::dot(effector_origin, tangent_dir);
+        float dx = m_base_radius - ex;
+        float a  = 2 * m_upper_arm_length * dx;
+        float b  = 2 * m_upper_arm_length * ey;
+        float k  = m_forearm_length * m_forearm_length - m_upper_arm_length * m_upper_arm_length - dx * dx - ey * ey - ez * ez;
+        float r  = sqrt(a * a + b * b);
+        if(r < EPSILON || fabs(k) > r) {
+            is_valid = false;
+            angles[i] = 0;
+            continue;
+        }
+        float phi    = atan2(b, a);
+        float alpha  = acos(k / r);
+        float theta1 = phi + alpha;
+        float theta2 = phi - alpha;
+        angles[i] = glm::degrees((cos(theta1) > cos(theta2)) ? theta1 : theta2);
+    }
+    return is_valid;
+}
+
+void DeltaRobot::solve_ik_batch(const glm::vec3* effector_origins,
+                                size_t           count,
+                                float*           angles,
+                                char*            is_valid) const
+{
+    for(size_t i = 0; i < count; i++) {
+        is_valid[i] = solve_ik(effector_origins[i], &angles[i * m_arm_count]);
+    }
+}
+
+// trilateration -- all spheres share the forearm radius
+bool DeltaRobot::solve_fk(const float* angles, glm::vec3* effector_origin) const
+{
+    if(m_arm_count < 3 || !effector_origin) {
+        return false;
+    }
+    glm::vec3 centers[3];
+    for(int i = 0; i < 3; i++) {
+        centers[i] = get_elbow(i, angles[i]) - get_arm_dir(i) * m_effector_radius;
+    }
+    glm::vec3 c21 = centers[1] - centers[0];
+    glm::vec3 c31 = centers[2] - centers[0];
+    float d = glm::length(c21);
+    if(d < EPSILON) {
+        return false;
+    }
+    glm::vec3 ex = c21 / d;
+    float i = glm::dot(ex, c31);
+    glm::vec3 ey = c31 - ex * i;
+    float j = glm::length(ey);
+    if(j < EPSILON) {
+        return false; // collinear
+    }
+    ey /= j;
+    glm::vec3 ez = glm::cross(ex, ey);
+    float x = d * 0.5f;
+    float y = (i * i + j * j) / (2 * j) - (i / j) * x;
+    float z_squared = m_forearm_length * m_forearm_length - x * x - y * y;
+    if(z_squared < 0) {
+        return false;
+    }
+    float z = sqrt(z_squared);
+    glm::vec3 p1 = centers[0] + ex * x + ey * y + ez * z;
+    glm::vec3 p2 = centers[0] + ex * x + ey * y - ez * z;
+    *effector_origin = (p1.y < p2.y) ? p1 : p2;
+    return true;
+}
+
+}
@@ -33,41 +33,6 @@ class Mesh;
 Mesh* cast_mesh(MeshBase* mesh);
 MeshBase* cast_mesh_base(Mesh* mesh);
 
-void PrimitiveFactory::get_box_corners(glm::vec3        (&points)[8],
-                                       const glm::vec3* origin,
-                                       const glm::vec3* dim)
-{
-    // points
-    //
-    //     y
-    //     4-------7
-    //    /|      /|
-    //   / |     / |
-    //  5-------6  |
-    //  |  0----|--3 x
-    //  | /     | /
-    //  |/      |/
-    //  1-------2
-    // z
-
-    points[0] = glm::vec3(0, 0, 0);
-    points[1] = glm::vec3(0, 0, 1);
-    points[2] = glm::vec3(1, 0, 1);
-    points[3] = glm::vec3(1, 0, 0);
-    points[4] = glm::vec3(0, 1, 0);
-    points[5] = glm::vec3(0, 1, 1);
-    points[6] = glm::vec3(1, 1, 1);
-    points[7] = glm::vec3(1, 1, 0);
-    if(!origin && !dim) {
-        return;
-    }
-    glm::vec3 _origin = origin ? *origin : glm::vec3(0);
-    glm::vec3 _dim    = dim    ? *dim    : glm::vec3(1);
-    for(int i = 0; i < 8; i++) {
-        points[i] = _origin + points[i] * _dim;
-    }
-}
-
 Mesh* PrimitiveFactory::create_grid(const std::string& name,
                                           int          cols,
                                           int          rows,
@@ -408,7 +373,7 @@ Mesh* PrimitiveFactory::create_box(const std::string& name,
     // z
 
     glm::vec3 dim(width, height, length);
-    get_box_corners(points, NULL, &dim);
+    vt::get_box_corners(points, NULL, &dim);
 
     int tri_indices[6][4];
     glm::vec3 tri_normals[6];
@@ -32,11 +32,13 @@
 namespace vt {
 
 Program::var_attribute_type_to_name_table_t Program::m_var_attribute_type_to_name_table[] = {
-        {Program::var_attribute_type_texcoord,        "texcoord"},
-        {Program::var_attribute_type_vertex_normal,   "vertex_normal"},
-        {Program::var_attribute_type_vertex_position, "vertex_position"},
-        {Program::var_attribute_type_vertex_tangent,  "vertex_tangent"},
-        {Program::var_attribute_type_count,           ""},
+        {Program::var_attribute_type_instance_color,     "instance_color"},
+        {Program::var_attribute_type_instance_transform, "instance_transform"},
+        {Program::var_attribute_type_texcoord,           "texcoord"},
+        {Program::var_attribute_type_vertex_normal,      "vertex_normal"},
+        {Program::var_attribute_type_vertex_position,    "vertex_position"},
+        {Program::var_attribute_type_vertex_tangent,     "vertex_tangent"},
+        {Program::var_attribute_type_count,              ""},
         };
 
 Program::var_uniform_type_to_name_table_t Program::m_var_uniform_type_to_name_table[] = {
@@ -0,0 +1,365 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <ReachabilityMap.h>
+#include <KinematicChain.h>
+#include <ThreadPool.h>
+#include <Util.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define REACHABILITY_MAP_MAGIC   "VTRM"
+#define REACHABILITY_MAP_VERSION 2
+
+#define REACHABILITY_MAP_BLOCK_SIZE 4096 // samples per seed -- fixes the sample sequence regardless of thread count
+
+namespace vt {
+
+struct ReachabilitySampler
+{
+    KinematicChain             m_chain; // private copy -- solvers and forward kinematics are not const
+    glm::vec3                  m_min;
+    glm::ivec3                 m_dim;
+    float                      m_voxel_size;
+    size_t                     m_sample_count;
+    std::vector<unsigned char> m_bits;
+};
+
+// xorshift -- rand() is neither thread-safe nor reproducible across threads
+static inline float random_unit(uint32_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return static_cast<float>(*state) / 4294967296.0f;
+}
+
+// fixed seed per block -- same map every build
+static inline uint32_t get_block_seed(size_t block_index)
+{
+    uint32_t seed = 2463534242u + static_cast<uint32_t>(block_index) * 2654435761u;
+    return seed ? seed : 1; // xorshift state must be nonzero
+}
+
+static void sample_block(ReachabilitySampler* sampler, size_t block_index)
+{
+    KinematicChain &chain = sampler->m_chain;
+    int n = chain.size();
+    uint32_t state = get_block_seed(block_index);
+    size_t begin = block_index * REACHABILITY_MAP_BLOCK_SIZE;
+    size_t end   = std::min(begin + REACHABILITY_MAP_BLOCK_SIZE, sampler->m_sample_count);
+    for(size_t i = begin; i < end; i++) {
+        for(int j = 0; j < n; j++) {
+            float alpha = random_unit(&state);
+            if(chain.has_limits(j)) {
+                chain.set_value(j, MIX(chain.get_min_value(j), chain.get_max_value(j), alpha));
+            } else if(chain.get_joint_type(j) == KinematicChain::JOINT_TYPE_REVOLUTE) {
+                chain.set_value(j, MIX(-180.0f, 180.0f, alpha));
+            } // unlimited prismatic joints stay where they are
+        }
+        chain.update();
+        glm::ivec3 voxel = glm::ivec3(glm::floor((chain.get_end_effector_tip() - sampler->m_min) / sampler->m_voxel_size));
+        if(voxel.x < 0 || voxel.y < 0 || voxel.z < 0 ||
+           voxel.x >= sampler->m_dim.x || voxel.y >= sampler->m_dim.y || voxel.z >= sampler->m_dim.z)
+        {
+            continue;
+        }
+        int index = (voxel.z * sampler->m_dim.y + voxel.y) * sampler->m_dim.x + voxel.x;
+        sampler->m_bits[index >> 3] |= (1 << (index & 7));
+    }
+}
+
+// one pool chunk per block -- each thread samples into its own grid
+class ReachabilitySampleTask : public ThreadPoolTask
+{
+public:
+    ReachabilitySampleTask(std::vector<ReachabilitySampler>* samplers)
+        : m_samplers(samplers)
+    {
+    }
+    void run(int thread_index, int chunk_index, size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; i++) {
+            sample_block(&(*m_samplers)[thread_index], i);
+        }
+    }
+
+private:
+    std::vector<ReachabilitySampler>* m_samplers;
+};
+
+ReachabilityMap::ReachabilityMap()
+    : m_min(0),
+      m_dim(0),
+      m_voxel_size(0),
+      m_signature(0)
+{
+}
+
+ReachabilityMap::~ReachabilityMap()
+{
+}
+
+//========
+// offline
+//========
+
+bool ReachabilityMap::build(const KinematicChain &chain,
+                            float                voxel_size,
+                            size_t               sample_count,
+                            int                  thread_count)
+{
+    clear();
+    int n = chain.size();
+    if(!n || voxel_size < EPSILON) {
+        return false;
+    }
+
+    // bound workspace by total link length (plus full prismatic stroke)
+    float radius = glm::length(chain.get_local_end_effector_tip());
+    for(int j = 0; j < n; j++) {
+        radius += glm::length(chain.get_offset(j));
+        if(chain.get_joint_type(j) == KinematicChain::JOINT_TYPE_PRISMATIC) {
+            radius += chain.has_limits(j) ? std::max(fabs(chain.get_min_value(j)), fabs(chain.get_max_value(j))) :
+                                            fabs(chain.get_value(j));
+        }
+    }
+    radius += voxel_size;
+    int side = static_cast<int>(ceil(radius * 2 / voxel_size));
+    m_min        = glm::vec3(-radius);
+    m_dim        = glm::ivec3(side);
+    m_voxel_size = voxel_size;
+    m_signature  = get_signature(chain, voxel_size, sample_count);
+    m_bits.assign((side * side * side + 7) / 8, 0);
+
+    // each sampler fills a private grid, merged afterwards
+    // NOTE: samples are split into fixed blocks with their own seeds, and or-ing the grids is
+    //       order independent, so the map is identical for any thread count or chunk schedule
+    if(thread_count <= 0) {
+        thread_count = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    }
+    size_t block_count = (sample_count + REACHABILITY_MAP_BLOCK_SIZE - 1) / REACHABILITY_MAP_BLOCK_SIZE;
+    thread_count = std::max(static_cast<int>(std::min(static_cast<size_t>(thread_count), block_count)), 1);
+    ThreadPool thread_pool(thread_count);
+    std::vector<ReachabilitySampler> samplers(thread_pool.get_thread_count());
+    for(int i = 0; i < static_cast<int>(samplers.size()); i++) {
+        ReachabilitySampler &sampler = samplers[i];
+        sampler.m_chain        = chain;
+        sampler.m_chain.set_base_transform(glm::mat4(1));
+        sampler.m_min          = m_min;
+        sampler.m_dim          = m_dim;
+        sampler.m_voxel_size   = m_voxel_size;
+        sampler.m_sample_count = sample_count;
+        sampler.m_bits.assign(m_bits.size(), 0);
+    }
+    ReachabilitySampleTask task(&samplers);
+    thread_pool.parallel_for(block_count, 1, &task);
+    for(std::vector<ReachabilitySampler>::iterator p = samplers.begin(); p != samplers.end(); ++p) {
+        for(size_t i = 0; i < m_bits.size(); i++) {
+            m_bits[i] |= (*p).m_bits[i];
+        }
+    }
+
+    // grow by one voxel to close gaps between samples -- map is used to reject, so err on reachable
+    std::vector<unsigned char> bits(m_bits);
+    for(int z = 0; z < m_dim.z; z++) {
+        for(int y = 0; y < m_dim.y; y++) {
+            for(int x = 0; x < m_dim.x; x++) {
+                int index = (z * m_dim.y + y) * m_dim.x + x;
+                if(!(bits[index >> 3] & (1 << (index & 7)))) {
+                    continue;
+                }
+                static const int offsets[][3] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+                for(int k = 0; k < 6; k++) {
+                    int nx = x + offsets[k][0];
+                    int ny = y + offsets[k][1];
+                    int nz = z + offsets[k][2];
+                    if(nx < 0 || ny < 0 || nz < 0 || nx >= m_dim.x || ny >= m_dim.y || nz >= m_dim.z) {
+                        continue;
+                    }
+                    int neighbor_index = (nz * m_dim.y + ny) * m_dim.x + nx;
+                    m_bits[neighbor_index >> 3] |= (1 << (neighbor_index & 7));
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void ReachabilityMap::clear()
+{
+    m_min        = glm::vec3(0);
+    m_dim        = glm::ivec3(0);
+    m_voxel_size = 0;
+    m_signature  = 0;
+    m_bits.clear();
+}
+
+//========
+// runtime
+//========
+
+int ReachabilityMap::get_voxel_index(glm::vec3 local_point) const
+{
+    if(m_bits.empty()) {
+        return -1;
+    }
+    glm::ivec3 voxel = glm::ivec3(glm::floor((local_point - m_min) / m_voxel_size));
+    if(voxel.x < 0 || voxel.y < 0 || voxel.z < 0 ||
+       voxel.x >= m_dim.x || voxel.y >= m_dim.y || voxel.z >= m_dim.z)
+    {
+        return -1;
+    }
+    return (voxel.z * m_dim.y + voxel.y) * m_dim.x + voxel.x;
+}
+
+bool ReachabilityMap::is_reachable(glm::vec3 local_point) const
+{
+    int index = get_voxel_index(local_point);
+    if(index < 0) {
+        return false;
+    }
+    return m_bits[index >> 3] & (1 << (index & 7));
+}
+
+bool ReachabilityMap::is_reachable(const glm::mat4 &base_inverse_transform, glm::vec3 abs_point) const
+{
+    return is_reachable(glm::vec3(base_inverse_transform * glm::vec4(abs_point, 1)));
+}
+
+size_t ReachabilityMap::get_reachable_count() const
+{
+    size_t count = 0;
+    for(std::vector<unsigned char>::const_iterator p = m_bits.begin(); p != m_bits.end(); ++p) {
+        for(unsigned char bits = *p; bits; bits &= bits - 1) {
+            count++;
+        }
+    }
+    return count;
+}
+
+//==============
+// serialization
+//==============
+
+// fnv-1a over everything that shapes the workspace
+uint32_t ReachabilityMap::get_signature(const KinematicChain &chain, float voxel_size, size_t sample_count)
+{
+    std::vector<float> layout;
+    int n = chain.size();
+    for(int j = 0; j < n; j++) {
+        glm::vec3 offset = chain.get_offset(j);
+        glm::vec3 axis   = chain.get_axis(j);
+        glm::quat pre    = chain.get_pre_orientation(j);
+        glm::quat post   = chain.get_post_orientation(j);
+        float values[] = {static_cast<float>(chain.get_joint_type(j)),
+                          offset.x, offset.y, offset.z,
+                          axis.x, axis.y, axis.z,
+                          pre.w, pre.x, pre.y, pre.z,
+                          post.w, post.x, post.y, post.z,
+                          static_cast<float>(chain.has_limits(j)), chain.get_min_value(j), chain.get_max_value(j)};
+        layout.insert(layout.end(), values, values + sizeof(values) / sizeof(float));
+    }
+    glm::vec3 tip = chain.get_local_end_effector_tip();
+    layout.push_back(tip.x);
+    layout.push_back(tip.y);
+    layout.push_back(tip.z);
+    layout.push_back(voxel_size);
+    uint32_t hash = 2166136261u;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&layout[0]);
+    for(size_t i = 0; i < layout.size() * sizeof(float); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    uint64_t count = sample_count; // hashed as an integer -- a float would merge nearby counts
+    bytes = reinterpret_cast<const unsigned char*>(&count);
+    for(size_t i = 0; i < sizeof(count); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// NOTE: native byte order
+bool ReachabilityMap::save(std::string filename) const
+{
+    if(m_bits.empty()) {
+        return false;
+    }
+    FILE* file = fopen(filename.c_str(), "wb");
+    if(!file) {
+        return false;
+    }
+    uint32_t version = REACHABILITY_MAP_VERSION;
+    int32_t  dim[]   = {m_dim.x, m_dim.y, m_dim.z};
+    float    min[]   = {m_min.x, m_min.y, m_min.z};
+    bool is_ok = fwrite(REACHABILITY_MAP_MAGIC, 1, 4, file) == 4 &&
+                 fwrite(&version, sizeof(version), 1, file) == 1 &&
+                 fwrite(&m_signature, sizeof(m_signature), 1, file) == 1 &&
+                 fwrite(dim, sizeof(int32_t), 3, file) == 3 &&
+                 fwrite(min, sizeof(float), 3, file) == 3 &&
+                 fwrite(&m_voxel_size, sizeof(m_voxel_size), 1, file) == 1 &&
+                 fwrite(&m_bits[0], 1, m_bits.size(), file) == m_bits.size();
+    fclose(file);
+    return is_ok;
+}
+
+bool ReachabilityMap::load(std::string filename)
+{
+    clear();
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(!file) {
+        return false;
+    }
+    char     magic[4];
+    uint32_t version   = 0;
+    uint32_t signature = 0;
+    int32_t  dim[3]    = {0, 0, 0};
+    float    min[3]    = {0, 0, 0};
+    float    voxel_size = 0;
+    bool is_ok = fread(magic, 1, 4, file) == 4 &&
+                 !memcmp(magic, REACHABILITY_MAP_MAGIC, 4) &&
+                 fread(&version, sizeof(version), 1, file) == 1 &&
+                 version == REACHABILITY_MAP_VERSION &&
+                 fread(&signature, sizeof(signature), 1, file) == 1 &&
+                 fread(dim, sizeof(int32_t), 3, file) == 3 &&
+                 fread(min, sizeof(float), 3, file) == 3 &&
+                 fread(&voxel_size, sizeof(voxel_size), 1, file) == 1 &&
+                 dim[0] > 0 && dim[1] > 0 && dim[2] > 0 && voxel_size > 0;
+    if(is_ok) {
+        size_t byte_count = (static_cast<size_t>(dim[0]) * dim[1] * dim[2] + 7) / 8;
+        m_bits.resize(byte_count);
+        is_ok = fread(&m_bits[0], 1, byte_count, file) == byte_count;
+    }
+    fclose(file);
+    if(!is_ok) {
+        clear();
+        return false;
+    }
+    m_min        = glm::vec3(min[0], min[1], min[2]);
+    m_dim        = glm::ivec3(dim[0], dim[1], dim[2]);
+    m_voxel_size = voxel_size;
+    m_signature  = signature;
+    return true;
+}
+
+}
@@ -73,6 +73,16 @@
 
 namespace vt {
 
+static void print_bitmap_string(void* font, const char* s)
+{
+    if(s && *s != '\0') {
+        while(*s) {
+            glutBitmapCharacter(font, *s);
+            s++;
+        }
+    }
+}
+
 DebugObjectContext::DebugObjectContext()
     : m_transform(glm::translate(glm::mat4(1), glm::vec3(0)))
 {
@@ -92,6 +102,7 @@ Scene::Scene()
       m_overlay(NULL),
       m_normal_material(NULL),
       m_wireframe_material(NULL),
+      m_wireframe_instanced_material(NULL),
       m_ssao_material(NULL),
       m_bloom_kernel(NULL),
       m_glow_cutoff_threshold(0),
@@ -184,6 +195,7 @@ void Scene::reset()
     m_camera = NULL;
     m_lights.clear();
     m_meshes.clear();
+    m_transform_store.clear();
     m_materials.clear();
     m_textures.clear();
 }
@@ -223,6 +235,7 @@ Mesh* Scene::find_mesh(std::string name)
 void Scene::add_mesh(Mesh* mesh)
 {
     m_meshes.push_back(mesh);
+    m_transform_store.add(mesh);
 }
 
 void Scene::remove_mesh(Mesh* mesh)
@@ -233,6 +246,7 @@ void Scene::remove_mesh(Mesh* mesh)
     }
     (*p)->link_parent(NULL);
     (*p)->unlink_children();
+    m_transform_store.remove(*p);
     m_meshes.erase(p);
 }
 
@@ -299,7 +313,9 @@ void Scene::render(bool                clear_canvas,
     if(clear_canvas) {
         glClearColor(0, 0, 0, 1);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        TransformObject::advance_frame_generation(); // new frame
     }
+    m_transform_store.update(); // all world transforms in one pass
     int i = 0;
     for(lights_t::const_iterator p = m_lights.begin(); p != m_lights.end(); ++p) {
         glm::vec3 light_pos = (*p)->get_origin();
@@ -552,12 +568,17 @@ void Scene::render(bool                clear_canvas,
                 shader_context = mesh->get_normal_shader_context(m_normal_material);
                 break;
             case use_material_type_t::USE_WIREFRAME_MATERIAL:
-                shader_context = mesh->get_wireframe_shader_context(m_wireframe_material);
+                shader_context = mesh->get_wireframe_shader_context(mesh->get_vbo_instance_transforms() ? m_wireframe_instanced_material : m_wireframe_material);
                 break;
             case use_material_type_t::USE_SSAO_MATERIAL:
                 shader_context = mesh->get_ssao_shader_context(m_ssao_material);
                 break;
         }
+        if(shader_context && mesh->get_vbo_instance_transforms() &&
+           !shader_context->get_material()->get_program()->has_var(Program::VAR_TYPE_ATTRIBUTE, Program::var_attribute_type_instance_transform))
+        {
+            continue; // override material can't place instances -- skip rather than draw them all at the mesh origin
+        }
         if(!shader_context) {
             continue;
         }
@@ -671,6 +692,7 @@ void Scene::render(bool                clear_canvas,
                 shader_context->set_viewport_dim(glm::value_ptr(m_camera->get_dim()));
             }
         }
+        mesh->update_instance_buffers();
         shader_context->render();
     }
 }
@@ -808,7 +830,7 @@ void Scene::draw_octree(Octree* node, glm::mat4 camera_transform) const
     glm::vec3 origin = node->get_origin();
     glm::vec3 dim    = node->get_dim();
 #endif
-    vt::PrimitiveFactory::get_box_corners(points, &origin, &dim);
+    vt::get_box_corners(points, &origin, &dim);
 
     glLoadMatrixf(glm::value_ptr(camera_transform));
     glLineWidth(bbox_line_width);
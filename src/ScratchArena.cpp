@@ -0,0 +1,80 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ScratchArena.h>
+#include <vector>
+#include <algorithm>
+#include <new>
+
+namespace vt {
+
+ScratchArena::ScratchArena(size_t block_size)
+    : m_block_size(block_size),
+      m_block_index(0),
+      m_offset(0),
+      m_capacity(0),
+      m_used(0)
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    for(std::vector<char*>::iterator p = m_blocks.begin(); p != m_blocks.end(); ++p) {
+        delete[] *p;
+    }
+}
+
+// first fit from the current block on -- a new block is only added when none of the kept ones fit
+// NOTE: blocks come from new char[], so aligning the offset aligns the address for any fundamental type
+//       and block growth shows up in anything counting operator new
+void* ScratchArena::alloc(size_t size, size_t alignment)
+{
+    if(!size) {
+        return NULL;
+    }
+    while(m_block_index < m_blocks.size()) {
+        size_t offset = (m_offset + alignment - 1) / alignment * alignment;
+        if(offset + size <= m_block_sizes[m_block_index]) {
+            m_offset = offset + size;
+            m_used  += size;
+            return m_blocks[m_block_index] + offset;
+        }
+        m_block_index++;
+        m_offset = 0;
+    }
+    size_t block_size = std::max(m_block_size, size);
+    char*  block      = new (std::nothrow) char[block_size];
+    if(!block) {
+        return NULL;
+    }
+    m_blocks.push_back(block);
+    m_block_sizes.push_back(block_size);
+    m_capacity += block_size;
+    m_block_index = m_blocks.size() - 1;
+    m_offset      = 0;
+    return alloc(size, alignment);
+}
+
+void ScratchArena::reset()
+{
+    m_block_index = 0;
+    m_offset      = 0;
+    m_used        = 0;
+}
+
+}
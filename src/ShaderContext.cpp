@@ -38,13 +38,17 @@ ShaderContext::ShaderContext(Material* material,
                              Buffer*   vbo_vert_normal,
                              Buffer*   vbo_vert_tangent,
                              Buffer*   vbo_tex_coords,
-                             Buffer*   ibo_tri_indices)
+                             Buffer*   ibo_tri_indices,
+                             Buffer*   vbo_instance_transforms,
+                             Buffer*   vbo_instance_colors)
     : m_material(material),
       m_vbo_vert_coords(vbo_vert_coords),
       m_vbo_vert_normal(vbo_vert_normal),
       m_vbo_vert_tangent(vbo_vert_tangent),
       m_vbo_tex_coords(vbo_tex_coords),
       m_ibo_tri_indices(ibo_tri_indices),
+      m_vbo_instance_transforms(vbo_instance_transforms),
+      m_vbo_instance_colors(vbo_instance_colors),
       m_textures(material->get_textures())
 {
     Program* program = material->get_program();
@@ -136,9 +140,36 @@ void ShaderContext::render()
                                                                                       0,        // no extra data between each position
                                                                                       0);       // offset of first element
     }
+    bool use_instance_transforms = m_vbo_instance_transforms &&
+                                   m_material->get_program()->has_var(Program::VAR_TYPE_ATTRIBUTE, Program::var_attribute_type_instance_transform);
+    bool use_instance_colors     = use_instance_transforms && m_vbo_instance_colors &&
+                                   m_material->get_program()->has_var(Program::VAR_TYPE_ATTRIBUTE, Program::var_attribute_type_instance_color);
+    if(use_instance_transforms) {
+        m_var_attributes[Program::var_attribute_type_instance_transform]->instanced_vertex_attrib_pointer(m_vbo_instance_transforms,
+                                                                                                         4,  // number of elements per column, here (x, y, z, w)
+                                                                                                         4); // number of columns
+    }
+    if(use_instance_colors) {
+        m_var_attributes[Program::var_attribute_type_instance_color]->instanced_vertex_attrib_pointer(m_vbo_instance_colors,
+                                                                                                     3); // number of elements per instance, here (r, g, b)
+    }
     if(m_ibo_tri_indices) {
         m_ibo_tri_indices->bind();
-        glDrawElements(GL_TRIANGLES, m_ibo_tri_indices->size()/sizeof(GLushort), GL_UNSIGNED_SHORT, 0);
+        if(use_instance_transforms) {
+            glDrawElementsInstanced(GL_TRIANGLES,
+                                    m_ibo_tri_indices->size()/sizeof(GLushort),
+                                    GL_UNSIGNED_SHORT,
+                                    0,
+                                    m_vbo_instance_transforms->size()/(sizeof(GLfloat) * 16));
+        } else {
+            glDrawElements(GL_TRIANGLES, m_ibo_tri_indices->size()/sizeof(GLushort), GL_UNSIGNED_SHORT, 0);
+        }
+    }
+    if(use_instance_transforms) {
+        m_var_attributes[Program::var_attribute_type_instance_transform]->disable_instanced_vertex_attrib_array(4);
+    }
+    if(use_instance_colors) {
+        m_var_attributes[Program::var_attribute_type_instance_color]->disable_instanced_vertex_attrib_array();
     }
     for(int i = 0; i < Program::var_attribute_type_count; i++) {
         if(m_var_attributes[i] && m_var_attributes[i]->is_enabled()) {
@@ -0,0 +1,161 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <Simulation.h>
+#include <ThreadPool.h>
+#include <ScratchArena.h>
+#include <vector>
+#include <algorithm>
+
+namespace vt {
+
+// forwards pool chunks to the simulation's pass
+class Simulation::PassTask : public ThreadPoolTask
+{
+public:
+    PassTask(Simulation* simulation, int pass)
+        : m_simulation(simulation),
+          m_pass(pass)
+    {
+    }
+    void run(int thread_index, int chunk_index, size_t begin, size_t end)
+    {
+        ScratchArena* scratch_arena = m_simulation->m_scratch_arenas[thread_index];
+        scratch_arena->reset();
+        m_simulation->run_pass(m_pass, chunk_index, begin, end, scratch_arena);
+    }
+
+private:
+    Simulation* m_simulation;
+    int         m_pass;
+};
+
+Simulation::Simulation(float fixed_dt)
+    : m_fixed_dt(fixed_dt),
+      m_time_accumulator(0),
+      m_time(0),
+      m_step_count(0),
+      m_thread_pool(new ThreadPool(1))
+{
+    create_scratch_arenas();
+}
+
+Simulation::~Simulation()
+{
+    destroy_scratch_arenas();
+    delete m_thread_pool;
+}
+
+//=========
+// stepping
+//=========
+
+void Simulation::step(float dt)
+{
+    update(dt);
+    m_time += dt;
+    m_step_count++;
+    for(std::vector<SimulationObserver*>::iterator p = m_observers.begin(); p != m_observers.end(); ++p) {
+        (*p)->on_step(this);
+    }
+}
+
+// consume wall-clock time in whole fixed steps -- the remainder carries over to the next call
+int Simulation::advance(float elapsed_time, int max_steps)
+{
+    m_time_accumulator += elapsed_time;
+    int steps = 0;
+    while(m_time_accumulator >= m_fixed_dt && steps < max_steps) {
+        step(m_fixed_dt);
+        m_time_accumulator -= m_fixed_dt;
+        steps++;
+    }
+    if(steps == max_steps) {
+        m_time_accumulator = 0; // drop the backlog rather than spiral
+    }
+    return steps;
+}
+
+//==========
+// threading
+//==========
+
+int Simulation::get_thread_count() const
+{
+    return m_thread_pool->get_thread_count();
+}
+
+void Simulation::set_thread_count(int thread_count)
+{
+    destroy_scratch_arenas();
+    delete m_thread_pool;
+    m_thread_pool = new ThreadPool(thread_count);
+    create_scratch_arenas();
+}
+
+void Simulation::parallel_for(int pass, size_t count)
+{
+    PassTask task(this, pass);
+    m_thread_pool->parallel_for(count, SIMULATION_GRAIN_SIZE, &task);
+}
+
+int Simulation::get_chunk_count(size_t count)
+{
+    return ThreadPool::get_chunk_count(count, SIMULATION_GRAIN_SIZE);
+}
+
+void Simulation::create_scratch_arenas()
+{
+    int thread_count = m_thread_pool->get_thread_count();
+    for(int i = 0; i < thread_count; i++) {
+        m_scratch_arenas.push_back(new ScratchArena());
+    }
+}
+
+void Simulation::destroy_scratch_arenas()
+{
+    for(std::vector<ScratchArena*>::iterator p = m_scratch_arenas.begin(); p != m_scratch_arenas.end(); ++p) {
+        delete *p;
+    }
+    m_scratch_arenas.clear();
+}
+
+//==========
+// observers
+//==========
+
+void Simulation::add_observer(SimulationObserver* observer)
+{
+    if(!observer) {
+        return;
+    }
+    if(std::find(m_observers.begin(), m_observers.end(), observer) != m_observers.end()) {
+        return;
+    }
+    m_observers.push_back(observer);
+}
+
+void Simulation::remove_observer(SimulationObserver* observer)
+{
+    std::vector<SimulationObserver*>::iterator p = std::find(m_observers.begin(), m_observers.end(), observer);
+    if(p != m_observers.end()) {
+        m_observers.erase(p);
+    }
+}
+
+}
@@ -0,0 +1,128 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <ThreadPool.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace vt {
+
+ThreadPool::ThreadPool(int thread_count)
+    : m_task(NULL),
+      m_count(0),
+      m_grain(0),
+      m_next_chunk(0),
+      m_chunk_count(0),
+      m_pending_chunks(0),
+      m_batch(0),
+      m_is_shutdown(false)
+{
+    if(thread_count <= 0) {
+        thread_count = std::thread::hardware_concurrency();
+    }
+    if(thread_count <= 1) {
+        return; // run on caller thread
+    }
+    for(int i = 1; i < thread_count; i++) { // caller thread is the first worker
+        m_threads.push_back(std::thread(&ThreadPool::worker, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_is_shutdown = true;
+    }
+    m_work_cond.notify_all();
+    for(std::vector<std::thread>::iterator p = m_threads.begin(); p != m_threads.end(); ++p) {
+        (*p).join();
+    }
+}
+
+// returns once every chunk has run -- the caller thread takes chunks too
+void ThreadPool::parallel_for(size_t count, size_t grain, ThreadPoolTask* task)
+{
+    int chunk_count = get_chunk_count(count, grain);
+    if(!task || !chunk_count) {
+        return;
+    }
+    if(m_threads.empty() || chunk_count == 1) {
+        for(int i = 0; i < chunk_count; i++) {
+            task->run(0, i, i * grain, std::min((i + 1) * grain, count));
+        }
+        return;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task           = task;
+    m_count          = count;
+    m_grain          = grain;
+    m_next_chunk     = 0;
+    m_chunk_count    = chunk_count;
+    m_pending_chunks = chunk_count;
+    m_batch++;
+    m_work_cond.notify_all();
+    lock.unlock();
+    run_chunks(0);
+    lock.lock();
+    while(m_pending_chunks) {
+        m_done_cond.wait(lock);
+    }
+    m_task = NULL;
+}
+
+// claim chunks until none are left -- called without the lock held
+void ThreadPool::run_chunks(int thread_index)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(m_next_chunk < m_chunk_count) {
+        int             chunk_index = m_next_chunk++;
+        ThreadPoolTask* task        = m_task;
+        size_t          begin       = chunk_index * m_grain;
+        size_t          end         = std::min(begin + m_grain, m_count);
+        lock.unlock();
+        task->run(thread_index, chunk_index, begin, end);
+        lock.lock();
+        if(!--m_pending_chunks) {
+            m_done_cond.notify_all();
+        }
+    }
+}
+
+void ThreadPool::worker(int thread_index)
+{
+    unsigned long batch = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true) {
+        while(!m_is_shutdown && m_batch == batch) {
+            m_work_cond.wait(lock);
+        }
+        if(m_is_shutdown) {
+            return;
+        }
+        batch = m_batch;
+        lock.unlock();
+        run_chunks(thread_index);
+        lock.lock();
+    }
+}
+
+}
@@ -0,0 +1,490 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <Trajectory.h>
+#include <TransformObject.h>
+#include <Simulation.h>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define TRAJECTORY_MAGIC           "VTTJ"
+#define TRAJECTORY_INDEX_MAGIC     "VTTI"
+#define TRAJECTORY_VERSION         1
+#define TRAJECTORY_COMPONENT_COUNT 10    // origin xyz, orientation wxyz, scale xyz
+#define TRAJECTORY_QUAT_SCALE      32767 // unit quaternion components quantize to int16 range
+#define TRAJECTORY_TRAILER_SIZE    (sizeof(uint64_t) * 2 + sizeof(uint32_t) + 4)
+#define TRAJECTORY_QUANTIZED_MAX   (INT32_MAX / 2) // keeps keyframe values and frame-to-frame deltas within int32
+
+namespace vt {
+
+//===============
+// varint helpers
+//===============
+
+// zigzag -- small deltas of either sign become small unsigned values
+static inline void put_varint(std::vector<unsigned char>* bytes, int32_t value)
+{
+    uint32_t u = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    while(u >= 0x80) {
+        bytes->push_back(static_cast<unsigned char>(u | 0x80));
+        u >>= 7;
+    }
+    bytes->push_back(static_cast<unsigned char>(u));
+}
+
+static inline bool get_varint(const std::vector<unsigned char> &bytes, size_t* pos, int32_t* value)
+{
+    uint32_t u     = 0;
+    int      shift = 0;
+    while(true) {
+        if(*pos >= bytes.size() || shift > 28) {
+            return false;
+        }
+        unsigned char b = bytes[(*pos)++];
+        u |= static_cast<uint32_t>(b & 0x7F) << shift;
+        if(!(b & 0x80)) {
+            break;
+        }
+        shift += 7;
+    }
+    *value = static_cast<int32_t>(u >> 1) ^ -static_cast<int32_t>(u & 1);
+    return true;
+}
+
+static inline void put_float(std::vector<unsigned char>* bytes, float value)
+{
+    unsigned char raw[sizeof(float)];
+    memcpy(raw, &value, sizeof(float));
+    bytes->insert(bytes->end(), raw, raw + sizeof(float));
+}
+
+static inline bool get_float(const std::vector<unsigned char> &bytes, size_t* pos, float* value)
+{
+    if(*pos + sizeof(float) > bytes.size()) {
+        return false;
+    }
+    memcpy(value, &bytes[*pos], sizeof(float));
+    *pos += sizeof(float);
+    return true;
+}
+
+// clamped before the cast -- converting an out-of-range (or nan) value to int32 is undefined
+static inline int32_t quantize(float value, float quantum)
+{
+    double q = floor(static_cast<double>(value) / quantum + 0.5);
+    if(q != q) {
+        return 0;
+    }
+    q = std::max(q, -static_cast<double>(TRAJECTORY_QUANTIZED_MAX));
+    q = std::min(q,  static_cast<double>(TRAJECTORY_QUANTIZED_MAX));
+    return static_cast<int32_t>(q);
+}
+
+//=================
+// TrajectoryWriter
+//=================
+
+TrajectoryWriter::TrajectoryWriter()
+    : m_file(NULL),
+      m_mode(TRAJECTORY_MODE_DELTA),
+      m_object_count(0),
+      m_chunk_frame_count(TRAJECTORY_CHUNK_FRAME_COUNT),
+      m_quantum(TRAJECTORY_QUANTUM),
+      m_frame_count(0),
+      m_chunk_frame_index(0),
+      m_byte_count(0),
+      m_is_ok(false)
+{
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    close();
+}
+
+bool TrajectoryWriter::open(std::string       filename,
+                            int               object_count,
+                            trajectory_mode_t mode,
+                            float             frame_dt,
+                            float             quantum,
+                            int               chunk_frame_count)
+{
+    close();
+    if(object_count < 0 || quantum <= 0 || chunk_frame_count <= 0) {
+        return false;
+    }
+    m_file = fopen(filename.c_str(), "wb");
+    if(!m_file) {
+        return false;
+    }
+    m_mode              = mode;
+    m_object_count      = object_count;
+    m_chunk_frame_count = chunk_frame_count;
+    m_quantum           = quantum;
+    m_frame_count       = 0;
+    m_chunk_frame_index = 0;
+    m_origins.assign(object_count, glm::vec3(0));
+    m_orientations.assign(object_count, glm::quat(1, 0, 0, 0));
+    m_scales.assign(object_count, glm::vec3(1));
+    m_prev_quantized.assign(object_count * TRAJECTORY_COMPONENT_COUNT, 0);
+    m_chunk_bytes.clear();
+    m_chunk_offsets.clear();
+
+    uint32_t version = TRAJECTORY_VERSION;
+    uint32_t header[] = {static_cast<uint32_t>(mode),
+                         static_cast<uint32_t>(object_count),
+                         static_cast<uint32_t>(chunk_frame_count)};
+    m_is_ok = fwrite(TRAJECTORY_MAGIC, 1, 4, m_file) == 4 &&
+              fwrite(&version, sizeof(version), 1, m_file) == 1 &&
+              fwrite(header, sizeof(uint32_t), 3, m_file) == 3 &&
+              fwrite(&quantum, sizeof(quantum), 1, m_file) == 1 &&
+              fwrite(&frame_dt, sizeof(frame_dt), 1, m_file) == 1;
+    m_byte_count = ftell(m_file);
+    return m_is_ok;
+}
+
+// trailing index -- chunk offsets, then where they start, frame count, chunk count and a magic to find them by
+bool TrajectoryWriter::close()
+{
+    if(!m_file) {
+        return false;
+    }
+    if(m_chunk_frame_index) {
+        flush_chunk();
+    }
+    uint64_t index_offset = m_byte_count;
+    uint64_t frame_count  = m_frame_count;
+    uint32_t chunk_count  = m_chunk_offsets.size();
+    m_is_ok = m_is_ok &&
+              (m_chunk_offsets.empty() || fwrite(&m_chunk_offsets[0], sizeof(uint64_t), chunk_count, m_file) == chunk_count) &&
+              fwrite(&index_offset, sizeof(index_offset), 1, m_file) == 1 &&
+              fwrite(&frame_count, sizeof(frame_count), 1, m_file) == 1 &&
+              fwrite(&chunk_count, sizeof(chunk_count), 1, m_file) == 1 &&
+              fwrite(TRAJECTORY_INDEX_MAGIC, 1, 4, m_file) == 4;
+    m_is_ok = !fclose(m_file) && m_is_ok;
+    m_file = NULL;
+    return m_is_ok;
+}
+
+void TrajectoryWriter::set_transform(int       index,
+                                     glm::vec3 origin,
+                                     glm::quat orientation,
+                                     glm::vec3 scale)
+{
+    if(index < 0 || index >= m_object_count) {
+        return;
+    }
+    m_origins[index]      = origin;
+    m_orientations[index] = orientation;
+    m_scales[index]       = scale;
+}
+
+bool TrajectoryWriter::write_frame()
+{
+    if(!m_file || !m_is_ok) {
+        return false;
+    }
+    encode_frame();
+    m_frame_count++;
+    if(++m_chunk_frame_index == m_chunk_frame_count) {
+        return flush_chunk();
+    }
+    return true;
+}
+
+bool TrajectoryWriter::write_frame(const std::vector<TransformObject*> &objects)
+{
+    int n = std::min(static_cast<int>(objects.size()), m_object_count);
+    for(int i = 0; i < n; i++) {
+        set_transform(i, objects[i]->get_origin(), objects[i]->get_orientation(), objects[i]->get_scale());
+    }
+    return write_frame();
+}
+
+bool TrajectoryWriter::write_frame(const Simulation* simulation)
+{
+    int n = std::min(static_cast<int>(simulation->get_agent_count()), m_object_count);
+    for(int i = 0; i < n; i++) {
+        set_transform(i, simulation->get_agent_origin(i), simulation->get_agent_orientation(i));
+    }
+    return write_frame();
+}
+
+// appends the staged frame to the chunk being built -- the chunk's first frame is its keyframe
+void TrajectoryWriter::encode_frame()
+{
+    if(m_mode == TRAJECTORY_MODE_FULL) {
+        for(int i = 0; i < m_object_count; i++) {
+            const glm::vec3 &origin      = m_origins[i];
+            const glm::quat &orientation = m_orientations[i];
+            const glm::vec3 &scale       = m_scales[i];
+            float values[TRAJECTORY_COMPONENT_COUNT] = {origin.x, origin.y, origin.z,
+                                                        orientation.w, orientation.x, orientation.y, orientation.z,
+                                                        scale.x, scale.y, scale.z};
+            for(int k = 0; k < TRAJECTORY_COMPONENT_COUNT; k++) {
+                put_float(&m_chunk_bytes, values[k]);
+            }
+        }
+        return;
+    }
+    bool is_keyframe = !m_chunk_frame_index;
+    for(int i = 0; i < m_object_count; i++) {
+        const glm::vec3 &origin      = m_origins[i];
+        glm::quat        orientation = glm::normalize(m_orientations[i]);
+        const glm::vec3 &scale       = m_scales[i];
+        if(orientation.w < 0) { // q and -q are the same rotation -- pick one so deltas stay small
+            orientation = -orientation;
+        }
+        int32_t quantized[TRAJECTORY_COMPONENT_COUNT] = {quantize(origin.x, m_quantum),
+                                                         quantize(origin.y, m_quantum),
+                                                         quantize(origin.z, m_quantum),
+                                                         quantize(orientation.w, 1.0f / TRAJECTORY_QUAT_SCALE),
+                                                         quantize(orientation.x, 1.0f / TRAJECTORY_QUAT_SCALE),
+                                                         quantize(orientation.y, 1.0f / TRAJECTORY_QUAT_SCALE),
+                                                         quantize(orientation.z, 1.0f / TRAJECTORY_QUAT_SCALE),
+                                                         quantize(scale.x, m_quantum),
+                                                         quantize(scale.y, m_quantum),
+                                                         quantize(scale.z, m_quantum)};
+        int32_t* prev_quantized = &m_prev_quantized[i * TRAJECTORY_COMPONENT_COUNT];
+        for(int k = 0; k < TRAJECTORY_COMPONENT_COUNT; k++) {
+            put_varint(&m_chunk_bytes, is_keyframe ? quantized[k] : quantized[k] - prev_quantized[k]);
+            prev_quantized[k] = quantized[k];
+        }
+    }
+}
+
+// chunk -- frame count, byte count, payload
+bool TrajectoryWriter::flush_chunk()
+{
+    uint32_t frame_count = m_chunk_frame_index;
+    uint32_t byte_count  = m_chunk_bytes.size();
+    m_chunk_offsets.push_back(m_byte_count);
+    m_is_ok = m_is_ok &&
+              fwrite(&frame_count, sizeof(frame_count), 1, m_file) == 1 &&
+              fwrite(&byte_count, sizeof(byte_count), 1, m_file) == 1 &&
+              (!byte_count || fwrite(&m_chunk_bytes[0], 1, byte_count, m_file) == byte_count);
+    m_byte_count       += sizeof(frame_count) + sizeof(byte_count) + byte_count;
+    m_chunk_frame_index = 0;
+    m_chunk_bytes.clear(); // keeps capacity -- steady-state recording doesn't allocate
+    return m_is_ok;
+}
+
+//=================
+// TrajectoryReader
+//=================
+
+TrajectoryReader::TrajectoryReader()
+    : m_file(NULL),
+      m_mode(TRAJECTORY_MODE_DELTA),
+      m_object_count(0),
+      m_chunk_frame_count(TRAJECTORY_CHUNK_FRAME_COUNT),
+      m_quantum(TRAJECTORY_QUANTUM),
+      m_frame_dt(0),
+      m_frame_count(0),
+      m_frame_index(0),
+      m_chunk_index(-1),
+      m_chunk_frame_index(-1),
+      m_chunk_frames(0),
+      m_read_pos(0)
+{
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    close();
+}
+
+bool TrajectoryReader::open(std::string filename)
+{
+    close();
+    m_file = fopen(filename.c_str(), "rb");
+    if(!m_file) {
+        return false;
+    }
+    char     magic[4];
+    uint32_t version     = 0;
+    uint32_t header[3]   = {0, 0, 0};
+    float    quantum     = 0;
+    float    frame_dt    = 0;
+    uint64_t index_offset = 0;
+    uint64_t frame_count  = 0;
+    uint32_t chunk_count  = 0;
+    char     index_magic[4];
+    bool is_ok = fread(magic, 1, 4, m_file) == 4 &&
+                 !memcmp(magic, TRAJECTORY_MAGIC, 4) &&
+                 fread(&version, sizeof(version), 1, m_file) == 1 &&
+                 version == TRAJECTORY_VERSION &&
+                 fread(header, sizeof(uint32_t), 3, m_file) == 3 &&
+                 fread(&quantum, sizeof(quantum), 1, m_file) == 1 &&
+                 fread(&frame_dt, sizeof(frame_dt), 1, m_file) == 1 &&
+                 header[0] < TRAJECTORY_MODE_COUNT && header[2] > 0 && quantum > 0 &&
+                 !fseek(m_file, -static_cast<long>(TRAJECTORY_TRAILER_SIZE), SEEK_END) &&
+                 fread(&index_offset, sizeof(index_offset), 1, m_file) == 1 &&
+                 fread(&frame_count, sizeof(frame_count), 1, m_file) == 1 &&
+                 fread(&chunk_count, sizeof(chunk_count), 1, m_file) == 1 &&
+                 fread(index_magic, 1, 4, m_file) == 4 &&
+                 !memcmp(index_magic, TRAJECTORY_INDEX_MAGIC, 4) &&
+                 frame_count <= static_cast<uint64_t>(chunk_count) * header[2];
+    if(is_ok) {
+        m_chunk_offsets.resize(chunk_count);
+        is_ok = !fseek(m_file, index_offset, SEEK_SET) &&
+                (!chunk_count || fread(&m_chunk_offsets[0], sizeof(uint64_t), chunk_count, m_file) == chunk_count);
+    }
+    if(!is_ok) {
+        close();
+        return false;
+    }
+    m_mode              = static_cast<trajectory_mode_t>(header[0]);
+    m_object_count      = header[1];
+    m_chunk_frame_count = header[2];
+    m_quantum           = quantum;
+    m_frame_dt          = frame_dt;
+    m_frame_count       = frame_count;
+    m_origins.assign(m_object_count, glm::vec3(0));
+    m_orientations.assign(m_object_count, glm::quat(1, 0, 0, 0));
+    m_scales.assign(m_object_count, glm::vec3(1));
+    m_quantized.assign(m_object_count * TRAJECTORY_COMPONENT_COUNT, 0);
+    return m_frame_count ? seek(0) : true;
+}
+
+void TrajectoryReader::close()
+{
+    if(m_file) {
+        fclose(m_file);
+        m_file = NULL;
+    }
+    m_frame_count       = 0;
+    m_frame_index       = 0;
+    m_chunk_index       = -1;
+    m_chunk_frame_index = -1;
+    m_chunk_offsets.clear();
+}
+
+// decodes forward from the nearest keyframe -- at most a chunk's worth of frames
+bool TrajectoryReader::seek(size_t frame_index)
+{
+    if(!m_file || frame_index >= m_frame_count) {
+        return false;
+    }
+    int chunk_index       = frame_index / m_chunk_frame_count;
+    int chunk_frame_index = frame_index % m_chunk_frame_count;
+    if(chunk_index != m_chunk_index) {
+        if(!load_chunk(chunk_index)) {
+            return false;
+        }
+    }
+    if(chunk_frame_index >= static_cast<int>(m_chunk_frames)) {
+        return false;
+    }
+    if(m_mode == TRAJECTORY_MODE_FULL) { // fixed-size frames -- jump straight there
+        m_read_pos          = static_cast<size_t>(chunk_frame_index) * m_object_count * TRAJECTORY_COMPONENT_COUNT * sizeof(float);
+        m_chunk_frame_index = chunk_frame_index - 1;
+    } else if(chunk_frame_index <= m_chunk_frame_index) { // behind us -- back to the keyframe
+        m_read_pos          = 0;
+        m_chunk_frame_index = -1;
+    }
+    while(m_chunk_frame_index < chunk_frame_index) {
+        if(!decode_frame()) {
+            m_chunk_index = -1; // corrupt -- don't trust the cache
+            return false;
+        }
+        m_chunk_frame_index++;
+    }
+    m_frame_index = frame_index;
+    return true;
+}
+
+void TrajectoryReader::apply(const std::vector<TransformObject*> &objects) const
+{
+    int n = std::min(static_cast<int>(objects.size()), m_object_count);
+    for(int i = 0; i < n; i++) {
+        objects[i]->set_origin(m_origins[i]);
+        objects[i]->set_orientation(m_orientations[i]);
+        objects[i]->set_scale(m_scales[i]);
+    }
+}
+
+bool TrajectoryReader::load_chunk(int chunk_index)
+{
+    m_chunk_index       = -1;
+    m_chunk_frame_index = -1;
+    m_read_pos          = 0;
+    if(chunk_index < 0 || chunk_index >= static_cast<int>(m_chunk_offsets.size())) {
+        return false;
+    }
+    uint32_t frame_count = 0;
+    uint32_t byte_count  = 0;
+    bool is_ok = !fseek(m_file, m_chunk_offsets[chunk_index], SEEK_SET) &&
+                 fread(&frame_count, sizeof(frame_count), 1, m_file) == 1 &&
+                 fread(&byte_count, sizeof(byte_count), 1, m_file) == 1;
+    if(!is_ok) {
+        return false;
+    }
+    m_chunk_bytes.resize(byte_count);
+    if(byte_count && fread(&m_chunk_bytes[0], 1, byte_count, m_file) != byte_count) {
+        return false;
+    }
+    m_chunk_frames = frame_count;
+    m_chunk_index  = chunk_index;
+    return true;
+}
+
+bool TrajectoryReader::decode_frame()
+{
+    if(m_mode == TRAJECTORY_MODE_FULL) {
+        for(int i = 0; i < m_object_count; i++) {
+            float values[TRAJECTORY_COMPONENT_COUNT];
+            for(int k = 0; k < TRAJECTORY_COMPONENT_COUNT; k++) {
+                if(!get_float(m_chunk_bytes, &m_read_pos, &values[k])) {
+                    return false;
+                }
+            }
+            m_origins[i]      = glm::vec3(values[0], values[1], values[2]);
+            m_orientations[i] = glm::quat(values[3], values[4], values[5], values[6]);
+            m_scales[i]       = glm::vec3(values[7], values[8], values[9]);
+        }
+        return true;
+    }
+    bool is_keyframe = (m_chunk_frame_index == -1);
+    for(int i = 0; i < m_object_count; i++) {
+        int32_t* quantized = &m_quantized[i * TRAJECTORY_COMPONENT_COUNT];
+        for(int k = 0; k < TRAJECTORY_COMPONENT_COUNT; k++) {
+            int32_t value = 0;
+            if(!get_varint(m_chunk_bytes, &m_read_pos, &value)) {
+                return false;
+            }
+            quantized[k] = is_keyframe ? value : quantized[k] + value;
+        }
+        m_origins[i]      = glm::vec3(quantized[0], quantized[1], quantized[2]) * m_quantum;
+        m_orientations[i] = glm::normalize(glm::quat(static_cast<float>(quantized[3]) / TRAJECTORY_QUAT_SCALE,
+                                                     static_cast<float>(quantized[4]) / TRAJECTORY_QUAT_SCALE,
+                                                     static_cast<float>(quantized[5]) / TRAJECTORY_QUAT_SCALE,
+                                                     static_cast<float>(quantized[6]) / TRAJECTORY_QUAT_SCALE));
+        m_scales[i]       = glm::vec3(quantized[7], quantized[8], quantized[9]) * m_quantum;
+    }
+    return true;
+}
+
+}
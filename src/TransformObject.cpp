@@ -16,17 +16,23 @@
 // along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <TransformObject.h>
+#include <TransformStore.h>
 #include <NamedObject.h>
 #include <Util.h>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtx/vector_angle.hpp>
+#include <glm/gtx/quaternion.hpp>
 #include <glm/glm.hpp>
+#include <vector>
 #include <set>
 
 //#define DEBUG
 
 namespace vt {
 
+unsigned long TransformObject::s_frame_generation = 0;
+
 TransformObject::TransformObject(const std::string& name,
                                        glm::vec3    origin,
                                        glm::vec3    euler,
@@ -36,22 +42,46 @@ TransformObject::TransformObject(const std::string& name,
       m_debug_end_effector_tip_dir(0),
       m_debug_local_pivot(0),
       m_debug_local_target(0),
-      m_origin(origin),
+      m_debug_ik_iters(0),
+      m_debug_ik_residual(0),
+      m_origin(&m_own_origin),
       m_euler(euler),
-      m_scale(scale),
+      m_orientation(&m_own_orientation),
+      m_scale(&m_own_scale),
+      m_transform(&m_own_transform),
+      m_transform_kind(TRANSFORM_KIND_TRS),
       m_parent(NULL),
       m_joint_type(                     JOINT_TYPE_REVOLUTE),
       m_enable_joint_constraints(       glm::ivec3(0)),
       m_joint_constraints_center(       glm::vec3(0)),
       m_joint_constraints_max_deviation(glm::vec3(0)),
       m_hinge_type(EULER_INDEX_UNDEF),
+      m_own_origin(origin),
+      m_own_orientation(euler_to_quat(euler)),
+      m_own_scale(scale),
+      m_own_transform(1),
+      m_is_recalibrating_heading(false),
       m_is_dirty_transform(true),
-      m_is_dirty_normal_transform(true)
+      m_is_dirty_inverse_transform(true),
+      m_is_dirty_normal_transform(true),
+      m_is_dirty_euler(false),
+      m_transform_generation(0),
+      m_transform_store(NULL),
+      m_transform_store_index(-1)
 {
 }
 
 TransformObject::~TransformObject()
 {
+    if(m_transform_store) {
+        m_transform_store->remove(this);
+    }
+    if(m_parent) {
+        m_parent->get_children().erase(this); // make parent forget you
+    }
+    for(std::set<TransformObject*>::iterator p = m_children.begin(); p != m_children.end(); ++p) {
+        (*p)->m_parent = NULL; // make children forget you
+    }
 }
 
 //===============
@@ -60,29 +90,48 @@ TransformObject::~TransformObject()
 
 void TransformObject::set_origin(glm::vec3 origin)
 {
-    m_origin = origin;
+    *m_origin = origin;
     apply_joint_constraints();
     mark_dirty_transform();
 }
 
+const glm::vec3 &TransformObject::get_euler() const
+{
+    if(m_is_dirty_euler) {
+        update_euler();
+    }
+    return m_euler;
+}
+
 void TransformObject::set_euler(glm::vec3 euler)
 {
-    m_euler = euler;
+    m_euler          = euler;
+    m_is_dirty_euler = false;
+    update_orientation();
     apply_joint_constraints();
     mark_dirty_transform();
 }
 
 void TransformObject::set_scale(glm::vec3 scale)
 {
-    m_scale = scale;
+    *m_scale = scale;
+    mark_dirty_transform();
+}
+
+// quaternion fast path -- euler is only recomputed if joint constraints need it
+void TransformObject::set_orientation(glm::quat orientation)
+{
+    *m_orientation   = glm::normalize(orientation);
+    m_is_dirty_euler = true;
+    apply_joint_constraints();
     mark_dirty_transform();
 }
 
 void TransformObject::reset_transform()
 {
-    m_origin = glm::vec3(0);
+    *m_origin = glm::vec3(0);
     set_euler(glm::vec3(0));
-    m_scale = glm::vec3(1);
+    *m_scale = glm::vec3(1);
     mark_dirty_transform();
 }
 
@@ -100,12 +149,12 @@ glm::vec3 TransformObject::in_parent_system(glm::vec3 abs_point) const
     if(!m_parent) {
         return abs_point;
     }
-    return glm::vec3(glm::inverse(m_parent->get_transform()) * glm::vec4(abs_point, 1));
+    return glm::vec3(m_parent->get_inverse_transform() * glm::vec4(abs_point, 1));
 }
 
 glm::vec3 TransformObject::from_origin_in_parent_system(glm::vec3 abs_point) const
 {
-    return in_parent_system(abs_point) - m_origin;
+    return in_parent_system(abs_point) - *m_origin;
 }
 
 glm::vec3 TransformObject::get_abs_left_direction()
@@ -133,6 +182,16 @@ glm::vec3 TransformObject::get_abs_direction(euler_index_t euler_index)
     }
 }
 
+// NOTE: ignores scale
+glm::quat TransformObject::get_abs_orientation() const
+{
+    glm::quat abs_orientation = *m_orientation;
+    for(TransformObject* p = m_parent; p; p = p->m_parent) {
+        abs_orientation = *p->m_orientation * abs_orientation;
+    }
+    return abs_orientation;
+}
+
 //=============================
 // coordinate system operations
 //=============================
@@ -144,22 +203,33 @@ void TransformObject::point_at_local(glm::vec3 local_target, glm::vec3* local_up
 
 void TransformObject::set_local_rotation_transform(glm::mat4 rotation_transform)
 {
-    glm::vec3 local_heading      = glm::vec3(rotation_transform * glm::vec4(VEC_FORWARD, 1));
-    glm::vec3 local_up_direction = glm::vec3(rotation_transform * glm::vec4(VEC_UP, 1));
-    point_at_local(local_heading, &local_up_direction);
+    set_orientation(glm::quat_cast(rotation_transform));
 }
 
 void TransformObject::rotate(glm::mat4 rotation_transform)
 {
-    glm::vec3 abs_origin         = in_abs_system();
-    glm::vec3 local_heading      = from_origin_in_parent_system(abs_origin + glm::vec3(rotation_transform * glm::vec4(get_abs_heading(), 1)));
-    glm::vec3 local_up_direction = from_origin_in_parent_system(abs_origin + glm::vec3(rotation_transform * glm::vec4(get_abs_up_direction(), 1)));
-    point_at_local(local_heading, &local_up_direction);
+    rotate(glm::quat_cast(rotation_transform));
+}
+
+// conjugate absolute rotation into parent system: local' = parent^-1 * abs_rotation * parent * local
+void TransformObject::rotate(glm::quat abs_rotation)
+{
+    if(!m_parent) {
+        set_orientation(abs_rotation * *m_orientation);
+        return;
+    }
+    glm::quat parent_abs_orientation = m_parent->get_abs_orientation();
+    set_orientation(glm::inverse(parent_abs_orientation) * abs_rotation * parent_abs_orientation * *m_orientation);
 }
 
 void TransformObject::rotate(float angle_delta, glm::vec3 pivot)
 {
-    rotate(GLM_ROTATION_TRANSFORM(glm::mat4(1), angle_delta, pivot));
+    rotate(GLM_ANGLE_AXIS(angle_delta, safe_normalize(pivot)));
+}
+
+void TransformObject::rotate_local(glm::quat local_rotation)
+{
+    set_orientation(local_rotation * *m_orientation);
 }
 
 //==================
@@ -175,7 +245,7 @@ void TransformObject::link_parent(TransformObject* new_parent, bool keep_transfo
     if(new_parent) {
         if(keep_transform) {
             // unproject to global space and then reproject to new parent space
-            glm::mat4 new_parent_inverse_transform = glm::inverse(new_parent->get_transform());
+            glm::mat4 new_parent_inverse_transform = new_parent->get_inverse_transform();
             flatten(&new_parent_inverse_transform);
 
             // break all connections -- TODO: review this
@@ -202,7 +272,14 @@ void TransformObject::link_parent(TransformObject* new_parent, bool keep_transfo
             }
         }
     }
+    if(m_transform_store) {
+        m_transform_store->mark_dirty_topology();
+    }
+    if(new_parent && new_parent->m_transform_store) {
+        new_parent->m_transform_store->mark_dirty_topology();
+    }
     m_parent = new_parent;
+    mark_dirty_transform(); // new lineage
     if(keep_transform) {
         set_axis(abs_origin);
     } else {
@@ -243,8 +320,7 @@ void TransformObject::set_enable_joint_constraints(glm::ivec3 enable_joint_const
 // explode heading into axis endpoints and reconstruct heading from axis endpoints
 void TransformObject::recalibrate_heading_in_parent_system()
 {
-    static bool disable_recursion = false;
-    if(!is_hinge() || disable_recursion) {
+    if(!is_hinge() || m_is_recalibrating_heading) {
         return;
     }
 
@@ -326,9 +402,9 @@ void TransformObject::recalibrate_heading_in_parent_system()
     }
 
     // reconstruct heading from local axis endpoints
-    disable_recursion = true;
+    m_is_recalibrating_heading = true; // per-object guard -- chains may be solved on different threads
     point_at_local(local_heading, &local_up_dir);
-    disable_recursion = false;
+    m_is_recalibrating_heading = false;
 }
 
 // hinge constraints algorithm core
@@ -337,6 +413,9 @@ void TransformObject::apply_hinge_constraints_within_plane_of_free_rotation()
     if(!is_hinge()) {
         return;
     }
+    if(m_is_dirty_euler) {
+        update_euler();
+    }
 
     glm::vec3 parent_abs_origin;
     glm::mat4 parent_transform;
@@ -367,6 +446,7 @@ void TransformObject::apply_hinge_constraints_within_plane_of_free_rotation()
         // suppress roll and yaw and remap pitch from [-90, 90] to [-90, -270]
         m_euler[EULER_INDEX_ROLL] = m_euler[EULER_INDEX_YAW] = 0;                                 // suppress roll and yaw
         m_euler[EULER_INDEX_PITCH]                           = -180 - m_euler[EULER_INDEX_PITCH]; // remap pitch from [-90, 90] to [-90, -270]
+        update_orientation();
         mark_dirty_transform();
 
         // recalculate local vars to reflect change
@@ -379,6 +459,8 @@ void TransformObject::apply_hinge_constraints_within_plane_of_free_rotation()
     // if not roll hinge joint and upside down for some reason, right it
     if(!is_roll_hinge && fabs(m_euler[vt::EULER_INDEX_ROLL]) > 90) {
         m_euler[vt::EULER_INDEX_ROLL] = 0;
+        update_orientation();
+        mark_dirty_transform();
     }
 
     // if not violating constraints, leave it
@@ -396,19 +478,51 @@ void TransformObject::apply_hinge_constraints_within_plane_of_free_rotation()
     glm::vec3 min_dir = dir_from_point_as_offset_in_other_system(min_local_euler, parent_transform, parent_abs_origin, is_roll_hinge);
     glm::vec3 max_dir = dir_from_point_as_offset_in_other_system(max_local_euler, parent_transform, parent_abs_origin, is_roll_hinge);
     m_euler[m_hinge_type] = (glm::distance(deviation_dir, min_dir) < glm::distance(deviation_dir, max_dir)) ? min_value : max_value;
+    update_orientation();
     mark_dirty_transform();
 }
 
+// same rules as apply_joint_constraints, but on a candidate orientation without touching the object
+glm::quat TransformObject::constrain_local_orientation(glm::quat local_orientation) const
+{
+    if(m_joint_type != JOINT_TYPE_REVOLUTE || (!is_hinge() && !m_enable_joint_constraints[EULER_INDEX_ROLL])) {
+        return local_orientation;
+    }
+    glm::vec3 euler = quat_to_euler(local_orientation);
+    for(int i = 0; i < 3; i++) {
+        if(is_hinge()) {
+            if(i != m_hinge_type) {
+                continue;
+            }
+        } else if(!m_enable_joint_constraints[i]) {
+            break;
+        }
+        if(angle_distance(euler[i], m_joint_constraints_center[i]) > m_joint_constraints_max_deviation[i]) {
+            float min_value = m_joint_constraints_center[i] - m_joint_constraints_max_deviation[i];
+            float max_value = m_joint_constraints_center[i] + m_joint_constraints_max_deviation[i];
+            euler[i] = (angle_distance(euler[i], min_value) < angle_distance(euler[i], max_value)) ? min_value : max_value;
+        }
+    }
+    return euler_to_quat(euler);
+}
+
 void TransformObject::apply_joint_constraints()
 {
     switch(m_joint_type) {
         case JOINT_TYPE_REVOLUTE:
+            if(!is_hinge() && !m_enable_joint_constraints[EULER_INDEX_ROLL]) {
+                return; // nothing to clamp -- don't pay for euler
+            }
+            if(m_is_dirty_euler) {
+                update_euler();
+            }
             if(!is_hinge()) {
                 for(int i = 0; i < 3 && m_enable_joint_constraints[i]; i++) {
                     if(angle_distance(m_euler[i], m_joint_constraints_center[i]) > m_joint_constraints_max_deviation[i]) {
                         float min_value = m_joint_constraints_center[i] - m_joint_constraints_max_deviation[i];
                         float max_value = m_joint_constraints_center[i] + m_joint_constraints_max_deviation[i];
                         m_euler[i] = (angle_distance(m_euler[i], min_value) < angle_distance(m_euler[i], max_value)) ? min_value : max_value;
+                        update_orientation();
                         mark_dirty_transform();
                     }
                 }
@@ -419,10 +533,10 @@ void TransformObject::apply_joint_constraints()
             break;
         case JOINT_TYPE_PRISMATIC:
             for(int i = 0; i < 3 && m_enable_joint_constraints[i]; i++) {
-                if(fabs(m_origin[i] - m_joint_constraints_center[i]) > m_joint_constraints_max_deviation[i]) {
+                if(fabs((*m_origin)[i] - m_joint_constraints_center[i]) > m_joint_constraints_max_deviation[i]) {
                     float min_value = m_joint_constraints_center[i] - m_joint_constraints_max_deviation[i];
                     float max_value = m_joint_constraints_center[i] + m_joint_constraints_max_deviation[i];
-                    m_origin[i] = (fabs(m_origin[i] - min_value) < fabs(m_origin[i] - max_value)) ? min_value : max_value;
+                    (*m_origin)[i] = (fabs((*m_origin)[i] - min_value) < fabs((*m_origin)[i] - max_value)) ? min_value : max_value;
                     mark_dirty_transform();
                 }
             }
@@ -502,10 +616,9 @@ bool TransformObject::solve_ik_ccd(TransformObject* root,
             if(!current_segment->arcball(&local_arc_pivot_dir, &angle_delta, _target, end_effector_tip)) {
                 continue;
             }
-            glm::mat4 local_arc_rotation_transform = GLM_ROTATION_TRANSFORM(glm::mat4(1), -angle_delta, local_arc_pivot_dir);
     // attempt #3 -- same as attempt #2, but make use of roll component (suitable for ropes/snakes/boids)
     #if 1
-            current_segment->set_local_rotation_transform(local_arc_rotation_transform * current_segment->get_local_rotation_transform());
+            current_segment->rotate_local(GLM_ANGLE_AXIS(-angle_delta, safe_normalize(local_arc_pivot_dir)));
             // update guide wires (for debug)
             glm::vec3 debug_local_target_dir              = safe_normalize(current_segment->from_origin_in_parent_system(_target));
             glm::vec3 debug_local_end_effector_tip_dir    = safe_normalize(current_segment->from_origin_in_parent_system(end_effector_tip));
@@ -524,6 +637,7 @@ bool TransformObject::solve_ik_ccd(TransformObject* root,
         #endif
     // attempt #2 -- do rotations in Cartesian coordinates (suitable for robots)
     #else
+            glm::mat4 local_arc_rotation_transform = GLM_ROTATION_TRANSFORM(glm::mat4(1), -angle_delta, local_arc_pivot_dir);
             current_segment->point_at_local(as_offset_in_other_system(current_segment->get_euler(), local_arc_rotation_transform));
     #endif
             sum_angle += angle_delta;
@@ -553,6 +667,480 @@ bool TransformObject::solve_ik_ccd(TransformObject* root,
     return false;
 }
 
+// http://www.andreasaristidou.com/FABRIK.html
+// NOTE: sweeps operate on cached joint positions/orientations -- the chain is written back once per solve
+bool TransformObject::solve_ik_fabrik(TransformObject* root,
+                                      glm::vec3        local_end_effector_tip,
+                                      glm::vec3        target,
+                                      glm::vec3*       end_effector_dir,
+                                      int              iters,
+                                      float            accept_end_effector_distance)
+{
+    std::vector<TransformObject*> segments; // root first
+    for(TransformObject* current_segment = this; current_segment && current_segment != root->get_parent(); current_segment = current_segment->get_parent()) {
+        segments.insert(segments.begin(), current_segment);
+    }
+    int n = segments.size();
+    if(!n) {
+        return false;
+    }
+
+    // prismatic joints slide toward target once (same as ccd), then stay rigid during the sweeps
+    for(int j = n - 1; j >= 0; j--) {
+        TransformObject* current_segment = segments[j];
+        if(current_segment->get_joint_type() != JOINT_TYPE_PRISMATIC) {
+            continue;
+        }
+        glm::vec3 end_effector_tip = in_abs_system(local_end_effector_tip);
+        current_segment->set_origin(current_segment->get_origin() + (current_segment->from_origin_in_parent_system(target) -
+                                                                     current_segment->from_origin_in_parent_system(end_effector_tip)));
+    }
+
+    // capture chain
+    std::vector<glm::vec3> joints(n + 1); // joints[n] is end effector tip
+    std::vector<float>     bone_lengths(n);
+    std::vector<glm::vec3> local_bone_dirs(n);
+    std::vector<glm::quat> local_orientations(n);
+    for(int j = 0; j < n; j++) {
+        joints[j]             = segments[j]->in_abs_system();
+        local_orientations[j] = segments[j]->get_orientation();
+    }
+    joints[n] = in_abs_system(local_end_effector_tip);
+    for(int j = 0; j < n; j++) {
+        glm::vec3 local_bone = (j + 1 < n) ? segments[j + 1]->get_origin() : local_end_effector_tip;
+        local_bone_dirs[j] = safe_normalize(local_bone * segments[j]->get_scale());
+        bone_lengths[j]    = glm::distance(joints[j], joints[j + 1]);
+    }
+    glm::vec3 base             = joints[0];
+    glm::quat base_orientation = root->get_parent() ? root->get_parent()->get_abs_orientation() : glm::quat(1, 0, 0, 0);
+
+    bool is_solved = false;
+    int i = 0;
+    for(; i < iters; i++) {
+        if(glm::distance(joints[n], target) < accept_end_effector_distance) {
+            is_solved = true;
+            break;
+        }
+
+        // backward reaching -- from end effector to base
+        joints[n] = target;
+        int first_joint = n - 1;
+        if(end_effector_dir && n > 1) {
+            joints[n - 1] = target - safe_normalize(*end_effector_dir) * bone_lengths[n - 1];
+            first_joint = n - 2;
+        }
+        for(int j = first_joint; j > 0; j--) {
+            joints[j] = joints[j + 1] + safe_normalize(joints[j] - joints[j + 1]) * bone_lengths[j];
+        }
+
+        // forward reaching -- from base to end effector, enforcing joint constraints along the way
+        joints[0] = base;
+        glm::quat parent_abs_orientation = base_orientation;
+        for(int j = 0; j < n; j++) {
+            TransformObject* current_segment = segments[j];
+            glm::quat abs_orientation = parent_abs_orientation * local_orientations[j];
+            if(current_segment->get_joint_type() == JOINT_TYPE_REVOLUTE) {
+                glm::vec3 current_dir = abs_orientation * local_bone_dirs[j];
+                glm::vec3 desired_dir = joints[j + 1] - joints[j];
+                if(current_segment->is_hinge()) {
+                    // stay within plane of free rotation
+                    glm::vec3 hinge_axis = abs_orientation * get_absolute_direction(current_segment->get_hinge_type());
+                    current_dir = rejection_from(current_dir, hinge_axis);
+                    desired_dir = rejection_from(desired_dir, hinge_axis);
+                }
+                if(glm::length(current_dir) > EPSILON && glm::length(desired_dir) > EPSILON) {
+                    glm::quat abs_delta = glm::rotation(glm::normalize(current_dir), glm::normalize(desired_dir));
+                    local_orientations[j] = current_segment->constrain_local_orientation(glm::inverse(parent_abs_orientation) * abs_delta * abs_orientation);
+                    abs_orientation       = parent_abs_orientation * local_orientations[j];
+                }
+            }
+            joints[j + 1] = joints[j] + (abs_orientation * local_bone_dirs[j]) * bone_lengths[j];
+            parent_abs_orientation = abs_orientation;
+        }
+    }
+    m_debug_ik_iters    = i;
+    m_debug_ik_residual = glm::distance(joints[n], target);
+    if(!is_solved && m_debug_ik_residual < accept_end_effector_distance) {
+        is_solved = true;
+    }
+
+    // write back
+    for(int j = 0; j < n; j++) {
+        if(segments[j]->get_joint_type() == JOINT_TYPE_REVOLUTE) {
+            segments[j]->set_orientation(local_orientations[j]);
+        }
+    }
+    return is_solved;
+}
+
+// damped least squares: dq = J^T * (J * J^T + damping^2 * I)^-1 * e
+// http://www.math.ucsd.edu/~sbuss/ResearchWeb/ikmethods/iksurvey.pdf
+// NOTE: iterates on cached joint frames -- the chain is written back once per solve
+bool TransformObject::solve_ik_jacobian(TransformObject* root,
+                                        glm::vec3        local_end_effector_tip,
+                                        glm::vec3        target,
+                                        glm::vec3*       end_effector_dir,
+                                        int              iters,
+                                        float            accept_end_effector_distance,
+                                        float            damping)
+{
+    std::vector<TransformObject*> segments; // root first
+    for(TransformObject* current_segment = this; current_segment && current_segment != root->get_parent(); current_segment = current_segment->get_parent()) {
+        segments.insert(segments.begin(), current_segment);
+    }
+    int n = segments.size();
+    if(!n) {
+        return false;
+    }
+
+    // capture chain as offsets in parent rotation frame + local orientations
+    glm::quat base_orientation = root->get_parent() ? root->get_parent()->get_abs_orientation() : glm::quat(1, 0, 0, 0);
+    glm::vec3 base_origin      = root->get_parent() ? root->get_parent()->in_abs_system() : glm::vec3(0);
+    std::vector<glm::vec3> local_offsets(n + 1); // local_offsets[n] is end effector tip
+    std::vector<glm::quat> local_orientations(n);
+    {
+        glm::quat parent_abs_orientation = base_orientation;
+        glm::vec3 parent_abs_origin      = base_origin;
+        for(int j = 0; j < n; j++) {
+            glm::vec3 abs_origin  = segments[j]->in_abs_system();
+            local_offsets[j]      = glm::inverse(parent_abs_orientation) * (abs_origin - parent_abs_origin);
+            local_orientations[j] = segments[j]->get_orientation();
+            parent_abs_orientation = parent_abs_orientation * local_orientations[j];
+            parent_abs_origin      = abs_origin;
+        }
+        local_offsets[n] = glm::inverse(parent_abs_orientation) * (in_abs_system(local_end_effector_tip) - parent_abs_origin);
+    }
+
+    int rows = end_effector_dir ? 6 : 3;
+    glm::vec3 desired_dir = end_effector_dir ? safe_normalize(*end_effector_dir) : glm::vec3(0);
+    std::vector<glm::vec3> joints(n + 1);
+    std::vector<glm::quat> abs_orientations(n);
+    std::vector<glm::vec3> col_axes;       // world axis per column
+    std::vector<int>       col_segments;   // segment index per column
+    std::vector<char>      col_prismatic;
+    std::vector<float>     jacobian;       // rows x cols, column-major
+    std::vector<float>     jjt(rows * rows);
+    float                  error[6];
+    std::vector<glm::vec3> rotation_deltas(n);
+    std::vector<glm::vec3> translation_deltas(n);
+    bool is_solved = false;
+    int i = 0;
+    for(; i <= iters; i++) {
+        // forward kinematics + cached world joint axes in one pass
+        glm::quat parent_abs_orientation = base_orientation;
+        glm::vec3 parent_abs_origin      = base_origin;
+        col_axes.clear();
+        col_segments.clear();
+        col_prismatic.clear();
+        for(int j = 0; j < n; j++) {
+            TransformObject* current_segment = segments[j];
+            joints[j]           = parent_abs_origin + parent_abs_orientation * local_offsets[j];
+            abs_orientations[j] = parent_abs_orientation * local_orientations[j];
+            if(current_segment->get_joint_type() == JOINT_TYPE_PRISMATIC) {
+                for(int k = 0; k < 3; k++) {
+                    if(current_segment->m_enable_joint_constraints[k] && current_segment->m_joint_constraints_max_deviation[k] < EPSILON) {
+                        continue; // locked axis
+                    }
+                    glm::vec3 axis(0); // origin component k -- not get_absolute_direction(k), which is euler-indexed
+                    axis[k] = 1;
+                    col_axes.push_back(parent_abs_orientation * axis);
+                    col_segments.push_back(j);
+                    col_prismatic.push_back(true);
+                }
+            } else if(current_segment->is_hinge()) {
+                col_axes.push_back(abs_orientations[j] * get_absolute_direction(current_segment->get_hinge_type()));
+                col_segments.push_back(j);
+                col_prismatic.push_back(false);
+            } else {
+                for(int k = 0; k < 3; k++) {
+                    col_axes.push_back(get_absolute_direction(k)); // ball joint -- any world basis will do
+                    col_segments.push_back(j);
+                    col_prismatic.push_back(false);
+                }
+            }
+            parent_abs_orientation = abs_orientations[j];
+            parent_abs_origin      = joints[j];
+        }
+        joints[n] = joints[n - 1] + abs_orientations[n - 1] * local_offsets[n];
+
+        // residual
+        glm::vec3 position_error = target - joints[n];
+        glm::vec3 rotation_error = glm::vec3(0);
+        if(end_effector_dir) {
+            rotation_error = glm::cross(safe_normalize(joints[n] - joints[n - 1]), desired_dir);
+        }
+        m_debug_ik_residual = glm::length(position_error) + glm::length(rotation_error);
+        if(glm::length(position_error) < accept_end_effector_distance && glm::length(rotation_error) < accept_end_effector_distance) {
+            is_solved = true;
+            break;
+        }
+        if(i == iters) {
+            break;
+        }
+
+        // jacobian
+        int cols = col_axes.size();
+        if(!cols) {
+            break;
+        }
+        jacobian.assign(rows * cols, 0);
+        for(int c = 0; c < cols; c++) {
+            glm::vec3 axis = col_axes[c];
+            glm::vec3 linear;
+            glm::vec3 angular;
+            if(col_prismatic[c]) {
+                linear  = axis;
+                angular = glm::vec3(0);
+            } else {
+                linear  = glm::cross(axis, joints[n] - joints[col_segments[c]]);
+                angular = axis;
+            }
+            for(int r = 0; r < 3; r++) {
+                jacobian[c * rows + r] = linear[r];
+                if(end_effector_dir) {
+                    jacobian[c * rows + 3 + r] = angular[r];
+                }
+            }
+        }
+        for(int r = 0; r < 3; r++) {
+            error[r] = position_error[r];
+            if(end_effector_dir) {
+                error[3 + r] = rotation_error[r];
+            }
+        }
+
+        // solve (J * J^T + damping^2 * I) * y = e
+        for(int r1 = 0; r1 < rows; r1++) {
+            for(int r2 = 0; r2 < rows; r2++) {
+                float sum = (r1 == r2) ? damping * damping : 0;
+                for(int c = 0; c < cols; c++) {
+                    sum += jacobian[c * rows + r1] * jacobian[c * rows + r2];
+                }
+                jjt[r1 * rows + r2] = sum;
+            }
+        }
+        if(!solve_linear_system(&jjt[0], error, rows)) {
+            break;
+        }
+
+        // dq = J^T * y -- accumulate per segment, then apply
+        rotation_deltas.assign(n, glm::vec3(0));
+        translation_deltas.assign(n, glm::vec3(0));
+        for(int c = 0; c < cols; c++) {
+            float dq = 0;
+            for(int r = 0; r < rows; r++) {
+                dq += jacobian[c * rows + r] * error[r];
+            }
+            if(col_prismatic[c]) {
+                translation_deltas[col_segments[c]] += col_axes[c] * dq;
+            } else {
+                rotation_deltas[col_segments[c]] += col_axes[c] * dq;
+            }
+        }
+        parent_abs_orientation = base_orientation;
+        for(int j = 0; j < n; j++) {
+            TransformObject* current_segment = segments[j];
+            if(current_segment->get_joint_type() == JOINT_TYPE_PRISMATIC) {
+                local_offsets[j] += glm::inverse(parent_abs_orientation) * translation_deltas[j];
+
+                // stay within joint limits so write-back doesn't undo what we converged to
+                for(int k = 0; k < 3; k++) {
+                    if(current_segment->m_enable_joint_constraints[k]) {
+                        float min_value = current_segment->m_joint_constraints_center[k] - current_segment->m_joint_constraints_max_deviation[k];
+                        float max_value = current_segment->m_joint_constraints_center[k] + current_segment->m_joint_constraints_max_deviation[k];
+                        local_offsets[j][k] = std::max(min_value, std::min(local_offsets[j][k], max_value));
+                    }
+                }
+            } else {
+                float angle = glm::length(rotation_deltas[j]);
+                if(angle > EPSILON * EPSILON) {
+                    glm::quat abs_delta = GLM_ANGLE_AXIS(glm::degrees(angle), rotation_deltas[j] / angle);
+                    local_orientations[j] = current_segment->constrain_local_orientation(glm::inverse(parent_abs_orientation) * abs_delta * abs_orientations[j]);
+                }
+            }
+            parent_abs_orientation = parent_abs_orientation * local_orientations[j];
+        }
+    }
+    m_debug_ik_iters = i;
+
+    // write back
+    for(int j = 0; j < n; j++) {
+        if(segments[j]->get_joint_type() == JOINT_TYPE_PRISMATIC) {
+            segments[j]->set_origin(segments[j]->in_parent_system(joints[j])); // applies joint constraints
+        } else {
+            segments[j]->set_orientation(local_orientations[j]);
+        }
+    }
+    return is_solved;
+}
+
+// closed-form ik applies to: optional yaw hinge + 2 or 3 parallel pitch hinges (typical legs)
+bool TransformObject::get_analytic_ik_chain(TransformObject*               root,
+                                            TransformObject**              yaw_segment,
+                                            std::vector<TransformObject*>* planar_segments)
+{
+    std::vector<TransformObject*> segments; // root first
+    for(TransformObject* current_segment = this; current_segment && current_segment != root->get_parent(); current_segment = current_segment->get_parent()) {
+        if(current_segment->get_joint_type() != JOINT_TYPE_REVOLUTE) {
+            return false;
+        }
+        segments.insert(segments.begin(), current_segment);
+    }
+    TransformObject* _yaw_segment = NULL;
+    if(segments.size() > 1 && segments[0]->get_hinge_type() == EULER_INDEX_YAW) {
+        _yaw_segment = segments[0];
+        segments.erase(segments.begin());
+    }
+    if(segments.size() != 2 && segments.size() != 3) {
+        return false;
+    }
+    glm::vec3 plane_normal = safe_normalize(segments[0]->get_abs_left_direction());
+    for(std::vector<TransformObject*>::iterator p = segments.begin(); p != segments.end(); ++p) {
+        if((*p)->get_hinge_type() != EULER_INDEX_PITCH) {
+            return false;
+        }
+        if(fabs(glm::dot(safe_normalize((*p)->get_abs_left_direction()), plane_normal)) < 1 - EPSILON * 10) {
+            return false; // not planar
+        }
+    }
+    if(yaw_segment) {
+        *yaw_segment = _yaw_segment;
+    }
+    if(planar_segments) {
+        *planar_segments = segments;
+    }
+    return true;
+}
+
+// constant time -- yaw swings the leg plane through the target, then law of cosines within the plane
+// for 3 bones, the last bone keeps its current direction (or end_effector_dir) and the other 2 reach its base
+bool TransformObject::solve_ik_analytic(TransformObject* root,
+                                        glm::vec3        local_end_effector_tip,
+                                        glm::vec3        target,
+                                        glm::vec3*       end_effector_dir,
+                                        float            accept_end_effector_distance)
+{
+    TransformObject*              yaw_segment = NULL;
+    std::vector<TransformObject*> planar_segments;
+    if(!get_analytic_ik_chain(root, &yaw_segment, &planar_segments)) {
+        return false;
+    }
+    return solve_ik_analytic_chain(yaw_segment, planar_segments, local_end_effector_tip, target, end_effector_dir, accept_end_effector_distance);
+}
+
+// chain already classified by get_analytic_ik_chain
+bool TransformObject::solve_ik_analytic_chain(TransformObject*               yaw_segment,
+                                              std::vector<TransformObject*>& planar_segments,
+                                              glm::vec3                      local_end_effector_tip,
+                                              glm::vec3                      target,
+                                              glm::vec3*                     end_effector_dir,
+                                              float                          accept_end_effector_distance)
+{
+    // yaw
+    if(yaw_segment) {
+        glm::vec3 yaw_axis    = safe_normalize(yaw_segment->get_abs_up_direction());
+        glm::vec3 yaw_pivot   = yaw_segment->in_abs_system();
+        glm::vec3 current_dir = rejection_from(in_abs_system(local_end_effector_tip) - yaw_pivot, yaw_axis);
+        glm::vec3 desired_dir = rejection_from(target - yaw_pivot, yaw_axis);
+        if(glm::length(current_dir) > EPSILON && glm::length(desired_dir) > EPSILON) {
+            yaw_segment->rotate(GLM_ANGLE_AXIS(signed_angle(current_dir, desired_dir, yaw_axis), yaw_axis));
+        }
+    }
+
+    // capture plane
+    int n = planar_segments.size();
+    glm::vec3 plane_normal = safe_normalize(planar_segments[0]->get_abs_left_direction());
+    std::vector<glm::vec3> joints(n + 1);
+    std::vector<float>     bone_lengths(n);
+    for(int j = 0; j < n; j++) {
+        joints[j] = planar_segments[j]->in_abs_system();
+    }
+    joints[n] = in_abs_system(local_end_effector_tip);
+    for(int j = 0; j < n; j++) {
+        bone_lengths[j] = glm::distance(joints[j], joints[j + 1]);
+    }
+    glm::vec3 base    = joints[0];
+    glm::vec3 _target = nearest_point_on_plane(base, plane_normal, target);
+
+    // wrist
+    glm::vec3 wrist = _target;
+    if(n == 3) {
+        glm::vec3 last_dir = rejection_from(end_effector_dir ? *end_effector_dir : joints[3] - joints[2], plane_normal);
+        if(glm::length(last_dir) < EPSILON) {
+            last_dir = _target - base;
+        }
+        last_dir = safe_normalize(last_dir);
+        wrist    = _target - last_dir * bone_lengths[2];
+        if(glm::distance(wrist, base) > bone_lengths[0] + bone_lengths[1]) {
+            // out of reach -- straighten toward target
+            wrist = _target - safe_normalize(_target - base) * bone_lengths[2];
+        }
+    }
+
+    // law of cosines -- keep current bend direction
+    int bend_sign = SIGN(glm::dot(glm::cross(joints[1] - joints[0], joints[2] - joints[1]), plane_normal));
+    if(!bend_sign) {
+        bend_sign = 1;
+    }
+    glm::vec3 elbow;
+    glm::vec3 reached_wrist;
+    if(!two_bone_ik(base, wrist, plane_normal, bone_lengths[0], bone_lengths[1], bend_sign, &elbow, &reached_wrist)) {
+        if(glm::distance(base, wrist) < EPSILON) {
+            return false;
+        }
+    }
+    std::vector<glm::vec3> bone_dirs(n);
+    bone_dirs[0] = elbow - base;
+    bone_dirs[1] = reached_wrist - elbow;
+    if(n == 3) {
+        bone_dirs[2] = _target - reached_wrist;
+    }
+
+    // write back -- each pitch hinge turns about the shared plane normal
+    for(int j = 0; j < n; j++) {
+        glm::vec3 bone_end    = (j + 1 < n) ? planar_segments[j + 1]->in_abs_system() : in_abs_system(local_end_effector_tip);
+        glm::vec3 current_dir = bone_end - planar_segments[j]->in_abs_system();
+        planar_segments[j]->rotate(GLM_ANGLE_AXIS(signed_angle(current_dir, bone_dirs[j], plane_normal), plane_normal));
+    }
+    m_debug_ik_iters    = 0;
+    m_debug_ik_residual = glm::distance(in_abs_system(local_end_effector_tip), target);
+    return m_debug_ik_residual < accept_end_effector_distance;
+}
+
+bool TransformObject::solve_ik(ik_type_t        ik_type,
+                               TransformObject* root,
+                               glm::vec3        local_end_effector_tip,
+                               glm::vec3        target,
+                               glm::vec3*       end_effector_dir,
+                               int              iters,
+                               float            accept_end_effector_distance,
+                               float            accept_avg_angle_distance)
+{
+    m_debug_ik_iters = iters; // solvers that know better overwrite this
+    switch(ik_type) {
+        case IK_TYPE_FABRIK:
+            return solve_ik_fabrik(root, local_end_effector_tip, target, end_effector_dir, iters, accept_end_effector_distance);
+        case IK_TYPE_JACOBIAN:
+            return solve_ik_jacobian(root, local_end_effector_tip, target, end_effector_dir, iters, accept_end_effector_distance);
+        case IK_TYPE_ANALYTIC:
+            {
+                TransformObject*              yaw_segment = NULL;
+                std::vector<TransformObject*> planar_segments;
+                if(get_analytic_ik_chain(root, &yaw_segment, &planar_segments)) {
+                    return solve_ik_analytic_chain(yaw_segment, planar_segments, local_end_effector_tip, target, end_effector_dir, accept_end_effector_distance);
+                }
+            }
+            // fall through -- no closed-form solution for this chain
+        case IK_TYPE_CCD:
+        default:
+            {
+                bool result = solve_ik_ccd(root, local_end_effector_tip, target, end_effector_dir, iters, accept_end_effector_distance, accept_avg_angle_distance);
+                m_debug_ik_residual = glm::distance(in_abs_system(local_end_effector_tip), target);
+                return result;
+            }
+    }
+}
+
 void TransformObject::update_boid(glm::vec3 target,
                                   float     forward_speed,
                                   float     angle_delta,
@@ -562,13 +1150,13 @@ void TransformObject::update_boid(glm::vec3 target,
     if(!arcball(&local_arc_pivot_dir, NULL, target, in_abs_system(VEC_FORWARD))) {
         return;
     }
-    int avoid_or_seek = (glm::distance(target, m_origin) < avoid_radius) ? -1 : 1;
-    glm::mat4 local_arc_rotation_transform = GLM_ROTATION_TRANSFORM(glm::mat4(1), -angle_delta * avoid_or_seek, local_arc_pivot_dir);
+    int avoid_or_seek = (glm::distance(target, *m_origin) < avoid_radius) ? -1 : 1;
 // attempt #3 -- same as attempt #2, but make use of roll component (suitable for ropes/snakes/boids)
 #if 1
-    set_local_rotation_transform(local_arc_rotation_transform * get_local_rotation_transform());
+    rotate_local(GLM_ANGLE_AXIS(-angle_delta * avoid_or_seek, safe_normalize(local_arc_pivot_dir)));
 // attempt #2 -- do rotations in Cartesian coordinates (suitable for robots)
 #else
+    glm::mat4 local_arc_rotation_transform = GLM_ROTATION_TRANSFORM(glm::mat4(1), -angle_delta * avoid_or_seek, local_arc_pivot_dir);
     point_at_local(as_offset_in_other_system(get_euler(), local_arc_rotation_transform));
 #endif
     set_origin(in_abs_system(VEC_FORWARD * forward_speed));
@@ -583,20 +1171,27 @@ void TransformObject::update_boid(float forward_speed)
 // core functionality
 //===================
 
-const glm::mat4 &TransformObject::get_transform(bool trace_down)
+// recompute only what is stale -- a clean node implies a clean lineage up to the root
+const glm::mat4 &TransformObject::get_transform()
 {
-    if(trace_down) {
-        update_transform_hier();
-        return m_transform;
-    }
     if(m_is_dirty_transform) {
         update_transform();
         if(m_parent) {
-            m_transform = m_parent->get_transform(false) * m_transform;
+            *m_transform = m_parent->get_transform() * *m_transform;
         }
-        m_is_dirty_transform = false;
+        m_is_dirty_transform   = false;
+        m_transform_generation = s_frame_generation;
     }
-    return m_transform;
+    return *m_transform;
+}
+
+const glm::mat4 &TransformObject::get_inverse_transform()
+{
+    if(m_is_dirty_inverse_transform) {
+        update_inverse_transform();
+        m_is_dirty_inverse_transform = false;
+    }
+    return m_inverse_transform;
 }
 
 const glm::mat4 &TransformObject::get_normal_transform()
@@ -610,7 +1205,7 @@ const glm::mat4 &TransformObject::get_normal_transform()
 
 glm::mat4 TransformObject::get_local_rotation_transform() const
 {
-    return GLM_EULER_TRANSFORM(EULER_YAW(m_euler), EULER_PITCH(m_euler), EULER_ROLL(m_euler));
+    return glm::mat4_cast(*m_orientation);
 }
 
 //========
@@ -619,23 +1214,48 @@ glm::mat4 TransformObject::get_local_rotation_transform() const
 
 void TransformObject::update_transform()
 {
-    m_transform = glm::translate(glm::mat4(1), m_origin) * get_local_rotation_transform() * glm::scale(glm::mat4(1), m_scale);
+    *m_transform = glm::translate(glm::mat4(1), *m_origin) * get_local_rotation_transform() * glm::scale(glm::mat4(1), *m_scale);
 }
 
-void TransformObject::update_transform_hier()
+// invalidate self and descendants only
+// NOTE: a dirty node implies a dirty subtree, so propagation stops at the first already-dirty descendant
+void TransformObject::mark_dirty_transform()
 {
-    for(std::set<TransformObject*>::iterator p = m_children.begin(); p != m_children.end(); ++p) {
-        (*p)->mark_dirty_transform(); // mark entire subtree dirty
-        (*p)->update_transform_hier();
+    m_is_dirty_inverse_transform = true;
+    m_is_dirty_normal_transform  = true;
+    if(m_is_dirty_transform) {
+        return;
+    }
+    m_is_dirty_transform = true;
+    if(m_transform_store) {
+        m_transform_store->mark_dirty(m_transform_store_index);
     }
-    if(m_children.empty()) {
-        get_transform(false); // update entire leaf-to-root lineage for all leaf nodes
+    for(std::set<TransformObject*>::iterator p = m_children.begin(); p != m_children.end(); ++p) {
+        (*p)->mark_dirty_transform();
     }
 }
 
+// world transforms are rigid+scale (camera is a lookAt view), so an affine inverse suffices
+void TransformObject::update_inverse_transform()
+{
+    m_inverse_transform = glm::affineInverse(get_transform());
+}
+
 void TransformObject::update_normal_transform()
 {
-    m_normal_transform = glm::transpose(glm::inverse(get_transform()));
+    m_normal_transform = glm::transpose(get_inverse_transform());
+}
+
+void TransformObject::update_euler() const
+{
+    m_euler          = quat_to_euler(*m_orientation);
+    m_is_dirty_euler = false;
+}
+
+// call after writing m_euler directly
+void TransformObject::update_orientation()
+{
+    *m_orientation = euler_to_quat(m_euler);
 }
 
 }
@@ -0,0 +1,232 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <TransformStore.h>
+#include <TransformObject.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+#include <set>
+
+namespace vt {
+
+TransformStore::TransformStore()
+    : m_is_dirty_topology(false)
+{
+}
+
+TransformStore::~TransformStore()
+{
+    clear();
+}
+
+//===========
+// membership
+//===========
+
+void TransformStore::add(TransformObject* object)
+{
+    if(!object) {
+        return;
+    }
+    m_members.insert(object);
+    m_is_dirty_topology = true;
+}
+
+void TransformStore::remove(TransformObject* object)
+{
+    if(!object) {
+        return;
+    }
+    m_members.erase(object);
+    if(object->m_transform_store == this) {
+        int index = object->m_transform_store_index;
+        detach(object); // object takes its values back
+        m_objects[index] = NULL; // never touch it again
+    }
+    m_is_dirty_topology = true;
+}
+
+void TransformStore::clear()
+{
+    for(std::vector<TransformObject*>::iterator p = m_objects.begin(); p != m_objects.end(); ++p) {
+        if(*p) {
+            detach(*p);
+        }
+    }
+    m_members.clear();
+    m_objects.clear();
+    m_parent_indices.clear();
+    m_transform_kinds.clear();
+    m_origins.clear();
+    m_orientations.clear();
+    m_scales.clear();
+    m_world_transforms.clear();
+    m_is_dirty_local.clear();
+    m_is_dirty.clear();
+    m_is_dirty_topology = false;
+}
+
+size_t TransformStore::size()
+{
+    if(m_is_dirty_topology) {
+        rebuild();
+    }
+    return m_objects.size();
+}
+
+//===============
+// batched update
+//===============
+
+// one linear pass over the flat arrays -- a parent's world transform is always final before its children are visited
+// NOTE: only dirty slots touch their object (to clear its dirty flag), and only custom transforms make a virtual call
+void TransformStore::update()
+{
+    if(m_is_dirty_topology) {
+        rebuild();
+    }
+    unsigned long frame_generation = TransformObject::get_frame_generation();
+    int n = m_objects.size();
+    for(int i = 0; i < n; i++) {
+        int parent_index = m_parent_indices[i];
+        bool is_dirty = m_is_dirty_local[i] || (parent_index >= 0 && m_is_dirty[parent_index]);
+        m_is_dirty[i] = is_dirty;
+        if(!is_dirty) {
+            continue;
+        }
+        TransformObject* object = m_objects[i];
+        glm::mat4 local_transform;
+        switch(m_transform_kinds[i]) {
+            case TransformObject::TRANSFORM_KIND_TRS:
+                local_transform = glm::translate(glm::mat4(1), m_origins[i]) * glm::mat4_cast(m_orientations[i]) * glm::scale(glm::mat4(1), m_scales[i]);
+                break;
+            case TransformObject::TRANSFORM_KIND_TRANSLATE:
+                local_transform = glm::translate(glm::mat4(1), m_origins[i]);
+                break;
+            default:
+                object->update_transform(); // lands in m_world_transforms[i] through the view
+                local_transform = m_world_transforms[i];
+                break;
+        }
+        if(parent_index >= 0) {
+            m_world_transforms[i] = m_world_transforms[parent_index] * local_transform;
+        } else if(object->m_parent) {
+            m_world_transforms[i] = object->m_parent->get_transform() * local_transform; // parent outside store
+        } else {
+            m_world_transforms[i] = local_transform;
+        }
+        object->m_is_dirty_transform   = false;
+        object->m_transform_generation = frame_generation;
+        m_is_dirty_local[i] = false;
+    }
+}
+
+// topological sort (breadth-first from roots) -- parents precede children
+void TransformStore::rebuild()
+{
+    for(std::vector<TransformObject*>::iterator p = m_objects.begin(); p != m_objects.end(); ++p) {
+        if(*p) {
+            detach(*p);
+        }
+    }
+    m_objects.clear();
+
+    // roots are members with no member ancestor
+    // NOTE: m_transform_store doubles as a "visited" mark while sorting -- slots are attached below
+    for(std::set<TransformObject*>::iterator p = m_members.begin(); p != m_members.end(); ++p) {
+        bool is_root = true;
+        for(TransformObject* q = (*p)->m_parent; q; q = q->m_parent) {
+            if(m_members.find(q) != m_members.end()) {
+                is_root = false;
+                break;
+            }
+        }
+        if(is_root && !(*p)->m_transform_store) {
+            (*p)->m_transform_store = this;
+            m_objects.push_back(*p);
+        }
+    }
+
+    // descendants are pulled in whether or not they are members
+    for(size_t head = 0; head < m_objects.size(); head++) {
+        std::set<TransformObject*> &children = m_objects[head]->get_children();
+        for(std::set<TransformObject*>::iterator p = children.begin(); p != children.end(); ++p) {
+            if((*p)->m_transform_store) {
+                continue; // owned by another store
+            }
+            (*p)->m_transform_store = this;
+            m_objects.push_back(*p);
+        }
+    }
+
+    // size every array before handing out views -- growing a vector would move the slots
+    int n = m_objects.size();
+    m_parent_indices.resize(n);
+    m_transform_kinds.resize(n);
+    m_origins.resize(n);
+    m_orientations.resize(n);
+    m_scales.resize(n);
+    m_world_transforms.resize(n);
+    m_is_dirty_local.assign(n, true);
+    m_is_dirty.assign(n, true);
+    for(int i = 0; i < n; i++) {
+        attach(m_objects[i], i);
+    }
+    for(int i = 0; i < n; i++) {
+        TransformObject* parent = m_objects[i]->m_parent;
+        m_parent_indices[i] = (parent && parent->m_transform_store == this) ? parent->m_transform_store_index : -1;
+        m_objects[i]->mark_dirty_transform(); // new slots have no resolved world transform
+    }
+    m_is_dirty_topology = false;
+}
+
+// move the object's values into slot index and point its views there
+void TransformStore::attach(TransformObject* object, int index)
+{
+    m_transform_kinds[index]  = object->m_transform_kind;
+    m_origins[index]          = *object->m_origin;
+    m_orientations[index]     = *object->m_orientation;
+    m_scales[index]           = *object->m_scale;
+    m_world_transforms[index] = *object->m_transform;
+    object->m_origin                = &m_origins[index];
+    object->m_orientation           = &m_orientations[index];
+    object->m_scale                 = &m_scales[index];
+    object->m_transform             = &m_world_transforms[index];
+    object->m_transform_store       = this;
+    object->m_transform_store_index = index;
+}
+
+// hand the slot's values back to the object's own storage
+void TransformStore::detach(TransformObject* object)
+{
+    if(object->m_transform_store_index >= 0) {
+        object->m_own_origin      = *object->m_origin;
+        object->m_own_orientation = *object->m_orientation;
+        object->m_own_scale       = *object->m_scale;
+        object->m_own_transform   = *object->m_transform;
+    }
+    object->m_origin                = &object->m_own_origin;
+    object->m_orientation           = &object->m_own_orientation;
+    object->m_scale                 = &object->m_own_scale;
+    object->m_transform             = &object->m_own_transform;
+    object->m_transform_store       = NULL;
+    object->m_transform_store_index = -1;
+}
+
+}
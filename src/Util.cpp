@@ -26,25 +26,14 @@
 #include <regex.h>
 #include <math.h>
 #include <stdarg.h>
-#include <GL/glut.h>
-#include <png.h>
 #include <memory.h>
 #include <random>
+#include <algorithm>
 
 #define EPSILON2 (EPSILON * 0.9) // factor >= 1 causes artifacts
 
 namespace vt {
 
-void print_bitmap_string(void* font, const char* s)
-{
-    if(s && *s != '\0') {
-        while(*s) {
-            glutBitmapCharacter(font, *s);
-            s++;
-        }
-    }
-}
-
 glm::vec3 euler_to_offset(glm::vec3  euler,
                           glm::vec3* up_direction) // out
 {
@@ -100,6 +89,21 @@ glm::vec3 offset_to_euler(glm::vec3  offset,
     return euler;
 }
 
+// same convention as GLM_EULER_TRANSFORM (yaw * pitch * roll), without building a matrix
+glm::quat euler_to_quat(glm::vec3 euler)
+{
+    return GLM_ANGLE_AXIS(EULER_YAW(euler),   VEC_UP) *
+           GLM_ANGLE_AXIS(EULER_PITCH(euler), VEC_LEFT) *
+           GLM_ANGLE_AXIS(EULER_ROLL(euler),  VEC_FORWARD);
+}
+
+// same branch choices as offset_to_euler, so constraint logic sees identical angles
+glm::vec3 quat_to_euler(glm::quat q)
+{
+    glm::vec3 up_direction = q * VEC_UP;
+    return offset_to_euler(q * VEC_FORWARD, &up_direction);
+}
+
 glm::vec3 as_offset_in_other_system(glm::vec3 euler, glm::mat4 transform, bool as_up_direction)
 {
     glm::vec3 offset;
@@ -159,6 +163,44 @@ float angle_distance(float angle1, float angle2)
     return angle_diff;
 }
 
+// in degrees, counter-clockwise about axis
+float signed_angle(glm::vec3 a, glm::vec3 b, glm::vec3 axis)
+{
+    return glm::degrees(atan2(glm::dot(glm::cross(a, b), axis), glm::dot(a, b)));
+}
+
+// law of cosines -- bend_sign picks which side of base-to-target the elbow goes
+// returns false if target is out of reach (end is then the nearest reachable point)
+bool two_bone_ik(glm::vec3  base,
+                 glm::vec3  target,
+                 glm::vec3  plane_normal,
+                 float      length1,
+                 float      length2,
+                 int        bend_sign,
+                 glm::vec3* elbow,
+                 glm::vec3* end)
+{
+    glm::vec3 offset = target - base;
+    float dist = glm::length(offset);
+    if(dist < EPSILON) {
+        return false;
+    }
+    glm::vec3 dir = offset / dist;
+    float min_reach = fabs(length1 - length2);
+    float max_reach = length1 + length2;
+    bool is_reachable = (dist >= min_reach && dist <= max_reach);
+    dist = CLAMP(dist, min_reach, max_reach);
+    float cos_alpha = CLAMP((length1 * length1 + dist * dist - length2 * length2) / (2 * length1 * dist), -1.0f, 1.0f);
+    float alpha     = glm::degrees(static_cast<float>(acos(cos_alpha)));
+    if(elbow) {
+        *elbow = base + (GLM_ANGLE_AXIS(-bend_sign * alpha, plane_normal) * dir) * length1;
+    }
+    if(end) {
+        *end = base + dir * dist;
+    }
+    return is_reachable;
+}
+
 glm::vec3 nearest_point_on_plane(glm::vec3 plane_origin, glm::vec3 plane_normal, glm::vec3 point)
 {
     return point - plane_normal * (glm::dot(point, plane_normal) - glm::dot(plane_origin, plane_normal));
@@ -242,6 +284,41 @@ glm::vec3 get_absolute_direction(int euler_index)
     return glm::vec3(0);
 }
 
+void get_box_corners(glm::vec3        (&points)[8],
+                     const glm::vec3* origin,
+                     const glm::vec3* dim)
+{
+    // points
+    //
+    //     y
+    //     4-------7
+    //    /|      /|
+    //   / |     / |
+    //  5-------6  |
+    //  |  0----|--3 x
+    //  | /     | /
+    //  |/      |/
+    //  1-------2
+    // z
+
+    points[0] = glm::vec3(0, 0, 0);
+    points[1] = glm::vec3(0, 0, 1);
+    points[2] = glm::vec3(1, 0, 1);
+    points[3] = glm::vec3(1, 0, 0);
+    points[4] = glm::vec3(0, 1, 0);
+    points[5] = glm::vec3(0, 1, 1);
+    points[6] = glm::vec3(1, 1, 1);
+    points[7] = glm::vec3(1, 1, 0);
+    if(!origin && !dim) {
+        return;
+    }
+    glm::vec3 _origin = origin ? *origin : glm::vec3(0);
+    glm::vec3 _dim    = dim    ? *dim    : glm::vec3(1);
+    for(int i = 0; i < 8; i++) {
+        points[i] = _origin + points[i] * _dim;
+    }
+}
+
 bool is_within(glm::vec3 pos, glm::vec3 _min, glm::vec3 _max)
 {
     glm::vec3 __min = _min - glm::vec3(EPSILON);
@@ -310,6 +387,229 @@ float ray_box_intersect(glm::mat4  box_transform,
     return _dist;
 }
 
+// "slab method" clipped to the segment's parametric range [0, 1]
+static bool segment_slab_intersect(glm::vec3 local_p1,
+                                   glm::vec3 local_p2,
+                                   glm::vec3 box_min,
+                                   glm::vec3 box_max)
+{
+    glm::vec3 local_dir = local_p2 - local_p1;
+    float t_min = 0;
+    float t_max = 1;
+    for(int i = 0; i < 3; i++) {
+        if(fabs(local_dir[i]) < EPSILON) { // segment parallel to slab
+            if(local_p1[i] < box_min[i] || local_p1[i] > box_max[i]) {
+                return false;
+            }
+            continue;
+        }
+        float inv_dir = 1.0f / local_dir[i];
+        float t1      = (box_min[i] - local_p1[i]) * inv_dir;
+        float t2      = (box_max[i] - local_p1[i]) * inv_dir;
+        if(t1 > t2) {
+            std::swap(t1, t2);
+        }
+        t_min = std::max(t_min, t1);
+        t_max = std::min(t_max, t2);
+        if(t_min > t_max) {
+            return false; // all it takes is one gap
+        }
+    }
+    return true;
+}
+
+// NOTE: affine maps preserve the segment parameter, so the test runs in box-local space
+bool segment_box_intersect(glm::mat4 box_inverse_transform,
+                           glm::vec3 box_min,
+                           glm::vec3 box_max,
+                           glm::vec3 p1,
+                           glm::vec3 p2)
+{
+    glm::vec3 local_p1 = glm::vec3(box_inverse_transform * glm::vec4(p1, 1));
+    glm::vec3 local_p2 = glm::vec3(box_inverse_transform * glm::vec4(p2, 1));
+    return segment_slab_intersect(local_p1, local_p2, box_min, box_max);
+}
+
+// "slab method" -- true when the ray overlaps the box anywhere within its parametric range [0, max_dist]
+// NOTE: a ray starting inside the box always overlaps it and reports where it leaves, which may lie past max_dist
+bool ray_aabb_intersect(glm::vec3 box_min,
+                        glm::vec3 box_max,
+                        glm::vec3 ray_origin,
+                        glm::vec3 ray_dir,
+                        float     max_dist,
+                        float*    dist)
+{
+    float t_enter = -BIG_NUMBER;
+    float t_exit  =  BIG_NUMBER;
+    for(int i = 0; i < 3; i++) {
+        if(fabs(ray_dir[i]) < EPSILON) { // ray parallel to slab
+            if(ray_origin[i] < box_min[i] || ray_origin[i] > box_max[i]) {
+                return false;
+            }
+            continue;
+        }
+        float inv_dir = 1.0f / ray_dir[i];
+        float t1      = (box_min[i] - ray_origin[i]) * inv_dir;
+        float t2      = (box_max[i] - ray_origin[i]) * inv_dir;
+        if(t1 > t2) {
+            std::swap(t1, t2);
+        }
+        t_enter = std::max(t_enter, t1);
+        t_exit  = std::min(t_exit,  t2);
+        if(t_enter > t_exit) {
+            return false; // all it takes is one gap
+        }
+    }
+    if(t_exit < 0) { // box behind ray
+        return false;
+    }
+    if(t_enter < 0) { // ray starts inside -- overlaps for any max_dist, so never cull on the exit distance
+        if(dist) {
+            *dist = t_exit;
+        }
+        return true;
+    }
+    if(t_enter > max_dist) { // box beyond reach
+        return false;
+    }
+    if(dist) {
+        *dist = t_enter;
+    }
+    return true;
+}
+
+// same distance as ray_box_intersect without the per-face plane tests
+// NOTE: affine maps preserve the ray parameter, so the test runs in box-local space
+float ray_box_distance(glm::mat4 box_inverse_transform,
+                       glm::vec3 box_min,
+                       glm::vec3 box_max,
+                       glm::vec3 ray_origin,
+                       glm::vec3 ray_dir)
+{
+    glm::vec3 local_ray_origin = glm::vec3(box_inverse_transform * glm::vec4(ray_origin, 1));
+    glm::vec3 local_ray_dir    = glm::mat3(box_inverse_transform) * ray_dir;
+    float dist = BIG_NUMBER;
+    if(!ray_aabb_intersect(box_min, box_max, local_ray_origin, local_ray_dir, BIG_NUMBER, &dist)) {
+        return BIG_NUMBER;
+    }
+    return dist;
+}
+
+// decompose box transform into world-space center, unit axes and half-extents (assumes no shear)
+static void get_box_frame(glm::mat4  box_transform,
+                          glm::vec3  box_min,
+                          glm::vec3  box_max,
+                          glm::vec3* box_center,
+                          glm::vec3* box_axes,
+                          glm::vec3* box_half_dim)
+{
+    *box_center = glm::vec3(box_transform * glm::vec4((box_min + box_max) * 0.5f, 1));
+    glm::vec3 half_dim = (box_max - box_min) * 0.5f;
+    for(int i = 0; i < 3; i++) {
+        glm::vec3 axis        = glm::vec3(box_transform[i]);
+        float     axis_length = glm::length(axis);
+        box_axes[i]           = (axis_length < EPSILON) ? glm::vec3(0) : axis * (1 / axis_length);
+        (*box_half_dim)[i]    = half_dim[i] * axis_length;
+    }
+}
+
+static float point_box_frame_distance(glm::vec3        box_center,
+                                      const glm::vec3* box_axes,
+                                      glm::vec3        box_half_dim,
+                                      glm::vec3        point)
+{
+    glm::vec3 offset = point - box_center;
+    float sum_squares = 0;
+    for(int i = 0; i < 3; i++) {
+        float excess = fabs(glm::dot(offset, box_axes[i])) - box_half_dim[i];
+        if(excess > 0) {
+            sum_squares += excess * excess;
+        }
+    }
+    return sqrt(sum_squares);
+}
+
+float point_box_distance(glm::mat4 box_transform,
+                         glm::vec3 box_min,
+                         glm::vec3 box_max,
+                         glm::vec3 point)
+{
+    glm::vec3 box_center;
+    glm::vec3 box_axes[3];
+    glm::vec3 box_half_dim;
+    get_box_frame(box_transform, box_min, box_max, &box_center, box_axes, &box_half_dim);
+    return point_box_frame_distance(box_center, box_axes, box_half_dim, point);
+}
+
+// swept sphere (capsule) vs OBB
+// distance from a point on the segment to the box is convex along the segment, so golden-section search finds the closest approach
+bool capsule_box_intersect(glm::mat4 box_transform,
+                           glm::mat4 box_inverse_transform,
+                           glm::vec3 box_min,
+                           glm::vec3 box_max,
+                           glm::vec3 p1,
+                           glm::vec3 p2,
+                           float     radius)
+{
+    if(radius <= 0) {
+        return segment_box_intersect(box_inverse_transform, box_min, box_max, p1, p2);
+    }
+    glm::vec3 box_center;
+    glm::vec3 box_axes[3];
+    glm::vec3 box_half_dim;
+    get_box_frame(box_transform, box_min, box_max, &box_center, box_axes, &box_half_dim);
+
+    // early out -- segment misses box inflated by radius (conservative)
+    glm::vec3 frame_p1;
+    glm::vec3 frame_p2;
+    for(int i = 0; i < 3; i++) {
+        frame_p1[i] = glm::dot(p1 - box_center, box_axes[i]);
+        frame_p2[i] = glm::dot(p2 - box_center, box_axes[i]);
+    }
+    glm::vec3 inflated_half_dim = box_half_dim + glm::vec3(radius);
+    if(!segment_slab_intersect(frame_p1, frame_p2, -inflated_half_dim, inflated_half_dim)) {
+        return false;
+    }
+
+    // early out -- segment core touches box
+    if(segment_slab_intersect(frame_p1, frame_p2, -box_half_dim, box_half_dim)) {
+        return true;
+    }
+
+    // rounded corners/edges -- find closest approach
+    const float golden_ratio = 0.618034f;
+    float a = 0;
+    float b = 1;
+    float c = b - (b - a) * golden_ratio;
+    float d = a + (b - a) * golden_ratio;
+    float dist_c = point_box_frame_distance(box_center, box_axes, box_half_dim, MIX(p1, p2, c));
+    float dist_d = point_box_frame_distance(box_center, box_axes, box_half_dim, MIX(p1, p2, d));
+    for(int i = 0; i < 32; i++) {
+        if(std::min(dist_c, dist_d) <= radius) {
+            return true;
+        }
+        if(dist_c < dist_d) {
+            b      = d;
+            d      = c;
+            dist_d = dist_c;
+            c      = b - (b - a) * golden_ratio;
+            dist_c = point_box_frame_distance(box_center, box_axes, box_half_dim, MIX(p1, p2, c));
+        } else {
+            a      = c;
+            c      = d;
+            dist_c = dist_d;
+            d      = a + (b - a) * golden_ratio;
+            dist_d = point_box_frame_distance(box_center, box_axes, box_half_dim, MIX(p1, p2, d));
+        }
+        if((b - a) * glm::distance(p1, p2) < EPSILON) {
+            break;
+        }
+    }
+    return std::min(dist_c, dist_d) <= radius ||
+           point_box_frame_distance(box_center, box_axes, box_half_dim, p1) <= radius ||
+           point_box_frame_distance(box_center, box_axes, box_half_dim, p2) <= radius;
+}
+
 glm::vec3 get_random_offset()
 {
     return glm::vec3(rand() / RAND_MAX,
@@ -410,6 +710,44 @@ glm::vec3 bezier_interpolate(glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3
     return (p1 * w1) + (p2 * w2) + (p3 * w3) + (p4 * w4);
 }
 
+// gaussian elimination with partial pivoting -- for the small dense systems in ik/kinematics
+// a is row-major n x n (destroyed), b is replaced by the solution
+bool solve_linear_system(float* a, float* b, int n)
+{
+    for(int col = 0; col < n; col++) {
+        int pivot_row = col;
+        for(int row = col + 1; row < n; row++) {
+            if(fabs(a[row * n + col]) > fabs(a[pivot_row * n + col])) {
+                pivot_row = row;
+            }
+        }
+        if(fabs(a[pivot_row * n + col]) < EPSILON * EPSILON) {
+            return false; // singular
+        }
+        if(pivot_row != col) {
+            for(int k = 0; k < n; k++) {
+                std::swap(a[col * n + k], a[pivot_row * n + k]);
+            }
+            std::swap(b[col], b[pivot_row]);
+        }
+        for(int row = col + 1; row < n; row++) {
+            float factor = a[row * n + col] / a[col * n + col];
+            for(int k = col; k < n; k++) {
+                a[row * n + k] -= factor * a[col * n + k];
+            }
+            b[row] -= factor * b[col];
+        }
+    }
+    for(int row = n - 1; row >= 0; row--) {
+        float sum = b[row];
+        for(int k = row + 1; k < n; k++) {
+            sum -= a[row * n + k] * b[k];
+        }
+        b[row] = sum / a[row * n + row];
+    }
+    return true;
+}
+
 bool read_file(std::string filename, std::string &s)
 {
     FILE* file = fopen(filename.c_str(), "rb");
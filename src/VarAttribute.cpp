@@ -58,4 +58,30 @@ void VarAttribute::vertex_attrib_pointer(Buffer*       buffer,
                           pointer);
 }
 
+void VarAttribute::instanced_vertex_attrib_pointer(Buffer* buffer,
+                                                   GLint   size,
+                                                   int     slot_count) const
+{
+    buffer->bind();
+    for(int i = 0; i < slot_count; i++) {
+        glEnableVertexAttribArray(m_id + i);
+        glVertexAttribPointer(m_id + i,
+                              size,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              sizeof(GLfloat) * size * slot_count,                          // one instance
+                              reinterpret_cast<const GLvoid*>(sizeof(GLfloat) * size * i)); // one column
+        glVertexAttribDivisor(m_id + i, 1);
+    }
+}
+
+// restore per-vertex stepping -- the slots may be reused by non-instanced programs
+void VarAttribute::disable_instanced_vertex_attrib_array(int slot_count) const
+{
+    for(int i = 0; i < slot_count; i++) {
+        glVertexAttribDivisor(m_id + i, 0);
+        glDisableVertexAttribArray(m_id + i);
+    }
+}
+
 }
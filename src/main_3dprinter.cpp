@@ -417,13 +417,14 @@ void onTick()
     if(user_input) {
         for(std::vector<IK_Leg*>::iterator r = ik_legs.begin(); r != ik_legs.end(); ++r) {
             std::vector<vt::Mesh*> &ik_meshes = (*r)->m_ik_meshes;
-            ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_meshes[0],
-                                                          glm::vec3(0, 0, IK_SEGMENT_2_LENGTH),
-                                                          (*r)->m_joint->in_abs_system(),
-                                                          NULL,
-                                                          IK_ITERS,
-                                                          ACCEPT_END_EFFECTOR_DISTANCE,
-                                                          ACCEPT_AVG_ANGLE_DISTANCE);
+            ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik(vt::TransformObject::IK_TYPE_CCD,
+                                                      ik_meshes[0],
+                                                      glm::vec3(0, 0, IK_SEGMENT_2_LENGTH),
+                                                      (*r)->m_joint->in_abs_system(),
+                                                      NULL,
+                                                      IK_ITERS,
+                                                      ACCEPT_END_EFFECTOR_DISTANCE,
+                                                      ACCEPT_AVG_ANGLE_DISTANCE);
         }
         user_input = false;
     }
@@ -38,11 +38,13 @@
 #include <glm/gtx/vector_angle.hpp>
 #include <shader_utils.h>
 
+#include <BoidSimulation.h>
 #include <Buffer.h>
 #include <Camera.h>
 #include <Octree.h>
 #include <File3ds.h>
 #include <FrameBuffer.h>
+#include <InstancedMesh.h>
 #include <Light.h>
 #include <Material.h>
 #include <Mesh.h>
@@ -52,6 +54,7 @@
 #include <Program.h>
 #include <Scene.h>
 #include <Shader.h>
+#include <Simulation.h>
 #include <ShaderContext.h>
 #include <Texture.h>
 #include <Util.h>
@@ -71,6 +74,8 @@
 #define BOID_OBSTACLE_AVOID_RADIUS   2
 #define BOID_OBSTACLE_REVERSE_RADIUS 1
 
+#define SIMULATION_THREAD_COUNT 0 // 0 -- one per hardware thread
+
 #define BOID_COUNT            80
 #define BOID_DIM              glm::vec3(0.0625, 0.0625, 0.25)
 #define BOID_INIT_SCATTER_MAX glm::vec3(5)
@@ -102,8 +107,10 @@ int init_screen_width  = 800,
     init_screen_height = 600;
 vt::Camera  *camera         = NULL;
 vt::Octree  *octree         = NULL;
+vt::BoidSimulation* boid_simulation = NULL;
 vt::Mesh    *mesh_skybox    = NULL,
             *box            = NULL;
+vt::InstancedMesh* boid_mesh = NULL; // one draw call for all boids
 vt::Light   *light          = NULL,
             *light2         = NULL,
             *light3         = NULL;
@@ -148,11 +155,49 @@ int angle_delta = 1;
 int target_index = 7;
 glm::vec3 targets[8];
 
-std::vector<vt::Mesh*> boid_meshes;
-float boid_speeds[BOID_COUNT];
-
 std::vector<vt::Mesh*> obstacle_meshes;
 
+// rendering follows the simulation, never the other way around
+class BoidMeshObserver : public vt::SimulationObserver
+{
+public:
+    void on_step(vt::Simulation* simulation)
+    {
+        vt::BoidSimulation* _boid_simulation = static_cast<vt::BoidSimulation*>(simulation);
+        if(!boid_mesh) {
+            return;
+        }
+        boid_mesh->m_debug_lines.clear();
+        int n = boid_mesh->get_instance_count();
+        for(int index = 0; index < n; index++) {
+            boid_mesh->set_instance_transform(index,
+                                              _boid_simulation->get_agent_origin(index),
+                                              _boid_simulation->get_agent_orientation(index));
+            if(show_guide_wires) {
+                _boid_simulation->get_agent_debug_lines(index, &m_agent_debug_lines);
+                boid_mesh->m_debug_lines.insert(boid_mesh->m_debug_lines.end(), m_agent_debug_lines.begin(), m_agent_debug_lines.end());
+            }
+            if(wireframe_mode) {
+                switch(_boid_simulation->get_agent_behavior(index)) {
+                    case vt::BoidStore::BOID_BEHAVIOR_WANDER:         boid_mesh->set_instance_color(index, glm::vec3(0, 0, 1)); break; // blue
+                    case vt::BoidStore::BOID_BEHAVIOR_HOMING:         boid_mesh->set_instance_color(index, glm::vec3(0, 1, 1)); break; // cyan
+                    case vt::BoidStore::BOID_BEHAVIOR_FLOCKING:       boid_mesh->set_instance_color(index, glm::vec3(0, 1, 0)); break; // green
+                    case vt::BoidStore::BOID_BEHAVIOR_SEPARATION:     boid_mesh->set_instance_color(index, glm::vec3(1, 0, 0)); break; // red
+                    case vt::BoidStore::BOID_BEHAVIOR_AVOID_OBSTACLE: boid_mesh->set_instance_color(index, glm::vec3(1, 0, 1)); break; // magenta
+                    default:
+                        boid_mesh->set_instance_color(index, glm::vec3(1));
+                        break;
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<std::tuple<glm::vec3, glm::vec3, glm::vec3, float>> m_agent_debug_lines;
+};
+
+BoidMeshObserver boid_mesh_observer;
+
 static void randomize_meshes(std::vector<vt::Mesh*>* meshes,
                              glm::vec3               scatter_min,
                              glm::vec3               scatter_max)
@@ -168,45 +213,53 @@ static void randomize_meshes(std::vector<vt::Mesh*>* meshes,
     }
 }
 
-static void randomize_boids(std::vector<vt::Mesh*>* boid_meshes,
-                            glm::vec3               scatter_min,
-                            glm::vec3               scatter_max)
+static void randomize_boids(vt::BoidSimulation* boid_simulation,
+                            glm::vec3           scatter_min,
+                            glm::vec3           scatter_max)
 {
-    randomize_meshes(boid_meshes,
-                     scatter_min,
-                     scatter_max);
-    size_t boid_count = boid_meshes->size();
-    for(int i = 0; i < static_cast<int>(boid_count); i++) {
-        boid_speeds[i] = BOID_FORWARD_SPEED_MIN + (BOID_FORWARD_SPEED_MAX - BOID_FORWARD_SPEED_MIN) * static_cast<float>(rand()) / RAND_MAX;
+    boid_simulation->randomize_agents(scatter_min,
+                                      scatter_max);
+    boid_mesh_observer.on_step(boid_simulation);
+}
+
+static void sync_obstacles(vt::BoidSimulation*     boid_simulation,
+                           std::vector<vt::Mesh*>* obstacle_meshes)
+{
+    boid_simulation->clear_obstacles();
+    for(std::vector<vt::Mesh*>::iterator p = obstacle_meshes->begin(); p != obstacle_meshes->end(); ++p) {
+        if(*p == box) { // bounds are built into the simulation
+            continue;
+        }
+        glm::vec3 min, max;
+        (*p)->get_min_max(&min, &max);
+        boid_simulation->add_obstacle((*p)->get_origin(), (*p)->get_euler(), min, max);
     }
 }
 
-static void create_boids(vt::Scene*              scene,
-                         std::vector<vt::Mesh*>* boid_meshes,
-                         int                     boid_count,
-                         glm::vec3               scatter_min,
-                         glm::vec3               scatter_max,
-                         glm::vec3               box_dim,
-                         std::string             name)
+static void create_boids(vt::Scene*          scene,
+                         vt::BoidSimulation* boid_simulation,
+                         int                 boid_count,
+                         glm::vec3           scatter_min,
+                         glm::vec3           scatter_max,
+                         glm::vec3           box_dim,
+                         std::string         name)
 {
-    if(!scene || !boid_meshes) {
+    if(!scene || !boid_simulation) {
         return;
     }
     srand(time(NULL));
+    vt::Mesh* mesh = vt::PrimitiveFactory::create_box(name);
+    mesh->center_axis();
+    mesh->set_scale(box_dim);
+    mesh->flatten();
+    mesh->center_axis();
+    boid_mesh = new vt::InstancedMesh(name, mesh, boid_count);
+    delete mesh;
+    scene->add_mesh(boid_mesh);
     for(int i = 0; i < boid_count; i++) {
-        std::stringstream ss;
-        ss << i;
-        //ss << name << "_" << i;
-        vt::Mesh* mesh = vt::PrimitiveFactory::create_box(ss.str());
-        mesh->center_axis();
-        mesh->set_scale(box_dim);
-        mesh->flatten();
-        mesh->center_axis();
-        scene->add_mesh(mesh);
-        boid_meshes->push_back(mesh);
-        boid_speeds[i] = BOID_FORWARD_SPEED_MIN;
+        boid_simulation->add_agent(glm::vec3(0), glm::vec3(0), BOID_FORWARD_SPEED_MIN);
     }
-    randomize_boids(boid_meshes,
+    randomize_boids(boid_simulation,
                     scatter_min,
                     scatter_max);
 }
@@ -247,7 +300,7 @@ int init_resources()
 {
     glm::vec3 target_origin(-2.5, -2.5, -2.5);
     glm::vec3 target_dim(5, 5, 5);
-    vt::PrimitiveFactory::get_box_corners(targets, &target_origin, &target_dim);
+    vt::get_box_corners(targets, &target_origin, &target_dim);
 
     vt::Scene* scene = vt::Scene::instance();
 
@@ -260,6 +313,12 @@ int init_resources()
     scene->add_material(ambient_material);
     scene->set_wireframe_material(ambient_material);
 
+    vt::Material* ambient_instanced_material = new vt::Material("ambient_instanced",
+                                                                "src/shaders/ambient_instanced.v.glsl",
+                                                                "src/shaders/ambient_instanced.f.glsl");
+    scene->add_material(ambient_instanced_material);
+    scene->set_wireframe_instanced_material(ambient_instanced_material);
+
     vt::Material* skybox_material = new vt::Material("skybox",
                                                      "src/shaders/skybox.v.glsl",
                                                      "src/shaders/skybox.f.glsl",
@@ -271,6 +330,11 @@ int init_resources()
                                                     "src/shaders/phong.f.glsl");
     scene->add_material(phong_material);
 
+    vt::Material* phong_instanced_material = new vt::Material("phong_instanced",
+                                                              "src/shaders/phong_instanced.v.glsl",
+                                                              "src/shaders/phong_instanced.f.glsl");
+    scene->add_material(phong_instanced_material);
+
     texture_skybox = new vt::Texture("skybox_texture",
                                      "data/SaintPetersSquare2/posx.png",
                                      "data/SaintPetersSquare2/negx.png",
@@ -284,7 +348,26 @@ int init_resources()
     glm::vec3 origin = glm::vec3(0);
     camera = new vt::Camera("camera", origin + glm::vec3(0, 0, orbit_radius), origin);
     scene->set_camera(camera);
-    octree = new vt::Octree(OCTREE_ORIGIN, OCTREE_DIM);
+    vt::BoidParams boid_params;
+    boid_params.m_avoid_radius                = BOID_AVOID_RADIUS;
+    boid_params.m_flocking_radius             = BOID_FLOCKING_RADIUS;
+    boid_params.m_nearest_neighbor_radius     = BOID_NEAREST_NEIGHBOR_RADIUS;
+    boid_params.m_nearest_neighbor_count      = BOID_NEAREST_NEIGHBOR_COUNT;
+    boid_params.m_obstacle_avoid_radius       = BOID_OBSTACLE_AVOID_RADIUS;
+    boid_params.m_obstacle_reverse_radius     = BOID_OBSTACLE_REVERSE_RADIUS;
+    boid_params.m_angle_delta                 = BOID_ANGLE_DELTA;
+    boid_params.m_avoid_angle_delta           = BOID_AVOID_ANGLE_DELTA;
+    boid_params.m_cohesion_to_alignment_ratio = BOID_FLOCKING_COHESION_TO_ALIGNMENT_RATIO;
+    boid_params.m_max_heading_deviation       = BOID_MAX_HEADING_DEVIATION;
+    boid_params.m_max_fov_deviation           = BOID_MAX_FOV_DEVIATION;
+    boid_params.m_forward_speed_min           = BOID_FORWARD_SPEED_MIN;
+    boid_params.m_forward_speed_max           = BOID_FORWARD_SPEED_MAX;
+    boid_params.m_lidar_fov                   = BOID_LIDAR_FOV;
+    boid_simulation = new vt::BoidSimulation(OCTREE_ORIGIN, OCTREE_DIM, boid_params);
+    boid_simulation->set_target(targets[target_index]);
+    boid_simulation->set_thread_count(SIMULATION_THREAD_COUNT);
+    boid_simulation->add_observer(&boid_mesh_observer);
+    octree = boid_simulation->get_octree();
     scene->set_octree(octree);
     box = vt::PrimitiveFactory::create_box("octree", OCTREE_DIM.x, OCTREE_DIM.y, OCTREE_DIM.z);
     box->center_axis();
@@ -302,19 +385,14 @@ int init_resources()
     mesh_skybox->set_color_texture_index(mesh_skybox->get_material()->get_texture_index_by_name("skybox_texture"));
 
     create_boids(scene,
-                 &boid_meshes,
+                 boid_simulation,
                  BOID_COUNT,
                  BOID_INIT_SCATTER_MIN,
                  BOID_INIT_SCATTER_MAX,
                  BOID_DIM,
                  "boid");
-    long index = 0;
-    for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-        (*p)->set_material(phong_material);
-        (*p)->set_ambient_color(glm::vec3(0));
-        octree->insert(index, (*p)->get_origin());
-        index++;
-    }
+    boid_mesh->set_material(phong_instanced_material);
+    boid_mesh->set_ambient_color(glm::vec3(0));
 
     create_obstacles(scene,
                      &obstacle_meshes,
@@ -329,6 +407,8 @@ int init_resources()
         (*p)->set_ambient_color(glm::vec3(0));
     }
 
+    sync_obstacles(boid_simulation, &obstacle_meshes);
+
     // NOTE: must add last!
     obstacle_meshes.push_back(box);
 
@@ -339,6 +419,10 @@ int init_resources()
 
 int deinit_resources()
 {
+    if(boid_simulation) {
+        vt::Scene::instance()->set_octree(NULL);
+        delete boid_simulation;
+    }
     return 1;
 }
 
@@ -350,6 +434,7 @@ void onIdle()
 void onTick()
 {
     static unsigned int prev_tick = 0;
+    static unsigned int prev_sim_tick = 0;
     static unsigned int frames = 0;
     unsigned int tick = glutGet(GLUT_ELAPSED_TIME);
     unsigned int delta_time = tick - prev_tick;
@@ -370,236 +455,14 @@ void onTick()
     }
     frames++;
     if(!do_animation) {
+        prev_sim_tick = tick;
         return;
     }
 
-    // clear
-    //octree->clear();
-
-    long index = 0;
-    for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-        vt::Mesh* self_object = *p;
-
-        // keep boids in octree
-        glm::vec3 self_object_pos = box->wrap(self_object->get_origin());
-        self_object->set_origin(self_object_pos);
-
-        // add/update
-        if(octree->exists(index)) {
-            octree->move(index, self_object_pos);
-        } else {
-            octree->insert(index, self_object_pos);
-        }
-        index++;
-    }
-
-    // rebalance
-    octree->rebalance();
-
-    long index2 = 0;
-    for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-        vt::Mesh* self_object         = *p;
-        glm::vec3 self_object_pos     = self_object->get_origin();
-        glm::vec3 self_object_heading = self_object->get_abs_heading();
-        float     boid_speed          = boid_speeds[index2];
-
-        self_object->m_debug_lines.clear();
-
-        float lateral_offset = BIG_NUMBER * tan(glm::radians(BOID_LIDAR_FOV));
-
-        float min_nearest_distance       = BIG_NUMBER;
-        float min_nearest_distance_up    = BIG_NUMBER;
-        float min_nearest_distance_left  = BIG_NUMBER;
-        float min_nearest_distance_right = BIG_NUMBER;
-
-        glm::vec3 nearest_dir_up = vt::safe_normalize(self_object->in_abs_system(glm::vec3(0,
-                                                                                           lateral_offset,
-                                                                                           BIG_NUMBER)) - self_object->in_abs_system());
-        glm::vec3 nearest_dir_left = vt::safe_normalize(self_object->in_abs_system(glm::vec3(lateral_offset * cos(glm::radians(210.0f)),
-                                                                                             lateral_offset * sin(glm::radians(210.0f)),
-                                                                                             BIG_NUMBER)) - self_object->in_abs_system());
-        glm::vec3 nearest_dir_right = vt::safe_normalize(self_object->in_abs_system(glm::vec3(lateral_offset * cos(glm::radians(330.0f)),
-                                                                                              lateral_offset * sin(glm::radians(330.0f)),
-                                                                                              BIG_NUMBER)) - self_object->in_abs_system());
-
-        for(std::vector<vt::Mesh*>::iterator q = obstacle_meshes.begin(); q != obstacle_meshes.end(); ++q) {
-            vt::Mesh* obstacle_mesh = *q;
-
-            float nearest_distance       = BIG_NUMBER;
-            float nearest_distance_up    = BIG_NUMBER;
-            float nearest_distance_left  = BIG_NUMBER;
-            float nearest_distance_right = BIG_NUMBER;
-
-            // forward
-            obstacle_mesh->is_ray_intersect(obstacle_mesh,
-                                            self_object->in_abs_system(),
-                                            self_object->get_abs_heading(),
-                                            &nearest_distance);
-
-            // up
-            obstacle_mesh->is_ray_intersect(obstacle_mesh,
-                                            self_object->in_abs_system(),
-                                            nearest_dir_up,
-                                            &nearest_distance_up);
-
-            // left
-            obstacle_mesh->is_ray_intersect(obstacle_mesh,
-                                            self_object->in_abs_system(),
-                                            nearest_dir_left,
-                                            &nearest_distance_left);
-
-            // right
-            obstacle_mesh->is_ray_intersect(obstacle_mesh,
-                                            self_object->in_abs_system(),
-                                            nearest_dir_right,
-                                            &nearest_distance_right);
-
-            if(nearest_distance < min_nearest_distance) {
-                min_nearest_distance = nearest_distance;
-            }
-            if(nearest_distance_up < min_nearest_distance_up) {
-                min_nearest_distance_up = nearest_distance_up;
-            }
-            if(nearest_distance_left < min_nearest_distance_left) {
-                min_nearest_distance_left = nearest_distance_left;
-            }
-            if(nearest_distance_right < min_nearest_distance_right) {
-                min_nearest_distance_right = nearest_distance_right;
-            }
-        }
-
-        //self_object->m_debug_lines.push_back(std::pair<glm::vec3, glm::vec3>(self_object->in_abs_system(),
-        //                                                                     self_object->in_abs_system(glm::vec3(0, 0, min_nearest_distance))));
+    boid_simulation->set_target(targets[target_index]);
+    boid_simulation->advance((tick - prev_sim_tick) * 0.001f);
+    prev_sim_tick = tick;
 
-#if 1
-        float lateral_offset_up    = min_nearest_distance_up    * tan(glm::radians(BOID_LIDAR_FOV));
-        float lateral_offset_left  = min_nearest_distance_left  * tan(glm::radians(BOID_LIDAR_FOV));
-        float lateral_offset_right = min_nearest_distance_right * tan(glm::radians(BOID_LIDAR_FOV));
-
-        self_object->m_debug_lines.push_back(std::make_tuple(self_object->in_abs_system(),
-                                                             self_object->in_abs_system(glm::vec3(0, lateral_offset_up, min_nearest_distance_up)),
-                                                             glm::vec3(0, 1, 1),
-                                                             1));
-        self_object->m_debug_lines.push_back(std::make_tuple(self_object->in_abs_system(),
-                                                             self_object->in_abs_system(glm::vec3(lateral_offset_left * cos(glm::radians(210.0f)),
-                                                                                                  lateral_offset_left * sin(glm::radians(210.0f)),
-                                                                                                  min_nearest_distance_left)),
-                                                             glm::vec3(0, 1, 1),
-                                                             1));
-        self_object->m_debug_lines.push_back(std::make_tuple(self_object->in_abs_system(),
-                                                             self_object->in_abs_system(glm::vec3(lateral_offset_right * cos(glm::radians(330.0f)),
-                                                                                                  lateral_offset_right * sin(glm::radians(330.0f)),
-                                                                                                  min_nearest_distance_right)),
-                                                             glm::vec3(0, 1, 1),
-                                                             1));
-#endif
-
-        // obstacle normal
-        glm::vec3 nearest_obstacle_ahead  = self_object->in_abs_system() + self_object->get_abs_heading() * min_nearest_distance;
-        glm::vec3 nearest_obstacle_up     = self_object->in_abs_system() + nearest_dir_up                 * min_nearest_distance_up;
-        glm::vec3 nearest_obstacle_left   = self_object->in_abs_system() + nearest_dir_left               * min_nearest_distance_left;
-        glm::vec3 nearest_obstacle_right  = self_object->in_abs_system() + nearest_dir_right              * min_nearest_distance_right;
-        glm::vec3 nearest_obstacle_normal = vt::safe_normalize(glm::cross(nearest_obstacle_right - nearest_obstacle_up, nearest_obstacle_left - nearest_obstacle_up));
-        //self_object->m_debug_lines.push_back(std::pair<glm::vec3, glm::vec3>(nearest_obstacle,
-        //                                                                     nearest_obstacle + nearest_obstacle_normal));
-
-        if(glm::distance(self_object_pos, nearest_obstacle_ahead) < BOID_OBSTACLE_REVERSE_RADIUS) {
-            // avoid head-on collision with obstacle
-            glm::vec3 up_direction = self_object->get_abs_up_direction();
-            self_object->set_euler(vt::offset_to_euler(-self_object->get_abs_heading(), &up_direction)); // rotate 180 degrees maintaining up direction
-        } else if(glm::distance(self_object_pos, nearest_obstacle_up)    < BOID_OBSTACLE_AVOID_RADIUS ||
-                  glm::distance(self_object_pos, nearest_obstacle_left)  < BOID_OBSTACLE_AVOID_RADIUS ||
-                  glm::distance(self_object_pos, nearest_obstacle_right) < BOID_OBSTACLE_AVOID_RADIUS)
-        {
-            // avoid glancing collision with obstacle
-            // explore deepest LIDAR reading direction
-            glm::vec3 target = nearest_obstacle_ahead + nearest_obstacle_normal;
-            self_object->update_boid(target,
-                                     boid_speed,
-                                     BOID_ANGLE_DELTA,
-                                     BOID_AVOID_RADIUS); // target homing
-            if(wireframe_mode) {
-                self_object->set_ambient_color(glm::vec3(1, 0, 1)); // magenta
-            }
-        } else {
-            // flocking behavior
-            std::vector<long> nearest_k_indices;
-            bool boid_updated = false;
-            if(octree->find(self_object_pos,
-                            BOID_NEAREST_NEIGHBOR_COUNT,
-                            &nearest_k_indices,
-                            BOID_NEAREST_NEIGHBOR_RADIUS))
-            {
-                glm::vec3 group_centroid(0);
-                glm::vec3 average_heading(0);
-                size_t valid_neighbor_count = 0;
-                for(std::vector<long>::iterator q = nearest_k_indices.begin(); q != nearest_k_indices.end(); ++q) {
-                    if(*q == index2) { // ignore self
-                        continue;
-                    }
-                    vt::Mesh* other_object         = boid_meshes[*q];
-                    glm::vec3 other_object_pos     = other_object->get_origin();
-                    glm::vec3 other_object_heading = other_object->get_abs_heading();
-
-                    // collect stats
-                    if(glm::degrees(glm::angle(self_object_heading, other_object_heading))                                   < BOID_MAX_HEADING_DEVIATION &&
-                       glm::degrees(glm::angle(self_object_heading, vt::safe_normalize(other_object_pos - self_object_pos))) < BOID_MAX_FOV_DEVIATION)
-                    {
-                        group_centroid  += other_object_pos;
-                        average_heading += other_object_heading;
-                        self_object->m_debug_lines.push_back(std::make_tuple(self_object_pos, other_object_pos, glm::vec3(1, 1, 0), 1));
-                        valid_neighbor_count++;
-                    }
-                }
-                if(nearest_k_indices.size() >= 2) {
-                    vt::Mesh* nearest_other_object     = boid_meshes[nearest_k_indices[1]];
-                    glm::vec3 nearest_other_object_pos = nearest_other_object->get_origin();
-
-                    if(glm::distance(self_object_pos, nearest_other_object_pos) < BOID_AVOID_RADIUS) {
-                        self_object->update_boid(nearest_other_object_pos,
-                                                 boid_speed,
-                                                 BOID_AVOID_ANGLE_DELTA,
-                                                 BOID_AVOID_RADIUS); // separation
-                        if(wireframe_mode) {
-                            self_object->set_ambient_color(glm::vec3(1, 0, 0)); // red
-                        }
-                        boid_updated = true;
-                    } else if(valid_neighbor_count) {
-                        float contrib_factor = 1.0f / valid_neighbor_count;
-                        group_centroid *= contrib_factor;
-                        average_heading = self_object_pos + average_heading * contrib_factor;
-                        glm::vec3 weighted_average_target = MIX(group_centroid, average_heading, BOID_FLOCKING_COHESION_TO_ALIGNMENT_RATIO);
-                        self_object->update_boid(weighted_average_target,
-                                                 boid_speed,
-                                                 BOID_ANGLE_DELTA,
-                                                 0); // cohesion & alignment
-                        if(wireframe_mode) {
-                            self_object->set_ambient_color(glm::vec3(0, 1, 0)); // green
-                        }
-                        boid_updated = true;
-                    }
-                }
-            }
-            if(!boid_updated) {
-                glm::vec3 target = targets[target_index];
-                if(glm::distance(self_object_pos, target) < BOID_FLOCKING_RADIUS) {
-                    self_object->update_boid(target,
-                                             boid_speed,
-                                             BOID_ANGLE_DELTA,
-                                             BOID_AVOID_RADIUS); // target homing
-                    if(wireframe_mode) {
-                        self_object->set_ambient_color(glm::vec3(0, 1, 1)); // cyan
-                    }
-                } else {
-                    self_object->update_boid(boid_speed);
-                    if(wireframe_mode) {
-                        self_object->set_ambient_color(glm::vec3(0, 0, 1)); // blue
-                    }
-                }
-            }
-        }
-        index2++;
-    }
     static int angle = 0;
     angle = (angle + angle_delta) % 360;
 }
@@ -669,10 +532,10 @@ void onKeyboard(unsigned char key, int x, int y)
                              OBSTACLE_INIT_SCATTER_MIN,
                              OBSTACLE_INIT_SCATTER_MAX);
             obstacle_meshes.push_back(box);
-            randomize_boids(&boid_meshes,
+            sync_obstacles(boid_simulation, &obstacle_meshes);
+            randomize_boids(boid_simulation,
                             BOID_INIT_SCATTER_MIN,
                             BOID_INIT_SCATTER_MAX);
-            octree->clear();
             break;
         case 's': // paths
             show_paths = !show_paths;
@@ -681,17 +544,13 @@ void onKeyboard(unsigned char key, int x, int y)
             wireframe_mode = !wireframe_mode;
             if(wireframe_mode) {
                 glPolygonMode(GL_FRONT, GL_LINE);
-                for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-                    (*p)->set_ambient_color(glm::vec3(1));
-                }
+                boid_mesh->set_ambient_color(glm::vec3(1));
                 for(std::vector<vt::Mesh*>::iterator p = obstacle_meshes.begin(); p != obstacle_meshes.end(); ++p) {
                     (*p)->set_ambient_color(glm::vec3(1));
                 }
             } else {
                 glPolygonMode(GL_FRONT, GL_FILL);
-                for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-                    (*p)->set_ambient_color(glm::vec3(0));
-                }
+                boid_mesh->set_ambient_color(glm::vec3(0));
                 for(std::vector<vt::Mesh*>::iterator p = obstacle_meshes.begin(); p != obstacle_meshes.end(); ++p) {
                     (*p)->set_ambient_color(glm::vec3(0));
                 }
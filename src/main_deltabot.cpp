@@ -46,6 +46,7 @@
 #include <Material.h>
 #include <Mesh.h>
 #include <Modifiers.h>
+#include <ParallelMechanism.h>
 #include <PrimitiveFactory.h>
 #include <Program.h>
 #include <Scene.h>
@@ -145,6 +146,13 @@ struct IK_Leg
 
 std::vector<IK_Leg*> ik_legs;
 
+// short pitch link + pump act as the forearm
+vt::DeltaRobot delta_robot(IK_LEG_RADIUS,
+                           IK_FOOTING_RADIUS,
+                           IK_SEGMENT_0_LENGTH,
+                           IK_SEGMENT_1_LENGTH + IK_SEGMENT_2_LENGTH,
+                           IK_LEG_COUNT);
+
 static void create_linked_segments(vt::Scene*              scene,
                                    std::vector<vt::Mesh*>* ik_meshes,
                                    std::string             name,
@@ -404,17 +412,24 @@ void onTick()
     body->get_transform(); // ensure transform is updated
     target_index = (target_index + 1) % origin_frame_values.size();
     if(user_input) {
+        // closed form shoulders -- ccd only settles the wrist (whole leg if out of reach)
+        float angles[IK_LEG_COUNT];
+        bool is_reachable = delta_robot.solve_ik(body->get_origin() - base->get_origin(), angles);
         std::stringstream ss;
         int leg_index = 0;
         for(std::vector<IK_Leg*>::iterator r = ik_legs.begin(); r != ik_legs.end(); ++r) {
             std::vector<vt::Mesh*> &ik_meshes = (*r)->m_ik_meshes;
-            ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_meshes[0],
-                                                          glm::vec3(0, 0, IK_SEGMENT_2_LENGTH),
-                                                          (*r)->m_target->in_abs_system(),
-                                                          NULL,
-                                                          IK_ITERS,
-                                                          ACCEPT_END_EFFECTOR_DISTANCE,
-                                                          ACCEPT_AVG_ANGLE_DISTANCE);
+            if(is_reachable) {
+                ik_meshes[0]->set_euler(glm::vec3(0, angles[leg_index], 0));
+            }
+            ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik(vt::TransformObject::IK_TYPE_CCD,
+                                                      is_reachable ? ik_meshes[1] : ik_meshes[0],
+                                                      glm::vec3(0, 0, IK_SEGMENT_2_LENGTH),
+                                                      (*r)->m_target->in_abs_system(),
+                                                      NULL,
+                                                      IK_ITERS,
+                                                      ACCEPT_END_EFFECTOR_DISTANCE,
+                                                      ACCEPT_AVG_ANGLE_DISTANCE);
             ss << "Leg #" << leg_index << ": Pitch=" << EULER_PITCH(ik_meshes[0]->get_euler());
             if(r != --ik_legs.end()) {
                 ss << ", ";
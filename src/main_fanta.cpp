@@ -41,6 +41,7 @@
 #include <Camera.h>
 #include <File3ds.h>
 #include <FrameBuffer.h>
+#include <IKSession.h>
 #include <KeyframeMgr.h>
 #include <Light.h>
 #include <Material.h>
@@ -70,6 +71,7 @@
 #define IK_BASE_LENGTH               0.5
 #define IK_BASE_WIDTH                0.5
 #define IK_ITERS                     1
+#define IK_MAX_ITERS                 10
 #define IK_SEGMENT_COUNT             5
 #define IK_SEGMENT_HEIGHT            0.125
 #define IK_SEGMENT_LENGTH            1.25
@@ -122,6 +124,9 @@ bool show_bbox        = false,
 
 bool angle_constraint = false;
 
+vt::TransformObject::ik_type_t ik_type = vt::TransformObject::IK_TYPE_CCD;
+const char* ik_type_names[] = {"ccd", "fabrik", "jacobian", "analytic"};
+
 float prev_zoom         = 0,
       zoom              = 1,
       ortho_dolly_speed = 0.1;
@@ -135,6 +140,7 @@ vt::Mesh *ik_base  = NULL,
 std::vector<vt::Mesh*> ik_meshes;
 std::vector<vt::Mesh*> ik_meshes2;
 std::vector<vt::Mesh*> ik_meshes3;
+vt::IKSession* ik_session = NULL;
 
 std::vector<vt::Mesh*> tray_meshes;
 std::vector<vt::Mesh*> tray_meshes2;
@@ -473,11 +479,16 @@ int init_resources()
     std::vector<glm::vec3> &origin_keyframe_values2 = vt::Scene::instance()->m_debug_object_context[object_id2].m_debug_origin_keyframe_values;
     vt::KeyframeMgr::instance()->export_keyframe_values_for_object(object_id2, &origin_keyframe_values2, NULL, NULL, true);
 
+    ik_session = new vt::IKSession(IK_ITERS, IK_MAX_ITERS);
+
     return 1;
 }
 
 int deinit_resources()
 {
+    if(ik_session) {
+        delete ik_session;
+    }
     return 1;
 }
 
@@ -503,7 +514,11 @@ void onTick()
         ss << std::setprecision(2) << std::fixed << fps << " FPS, "
             << "Mouse: {" << mouse_drag.x << ", " << mouse_drag.y << "}, "
             << "Yaw=" << EULER_YAW(euler) << ", Pitch=" << EULER_PITCH(euler) << ", Radius=" << orbit_radius << ", "
-            << "Zoom=" << zoom;
+            << "Zoom=" << zoom << ", "
+            << "IK=" << ik_type_names[ik_type] << ", "
+            << "Iters=" << ik_meshes[IK_SEGMENT_COUNT - 1]->m_debug_ik_iters << ", "
+            << "Residual=" << ik_meshes[IK_SEGMENT_COUNT - 1]->m_debug_ik_residual << ", "
+            << "Skips=" << ik_session->get_skip_count() << "/" << ik_session->get_skip_count() + ik_session->get_solve_count();
         //ss << "Width=" << camera->get_width() << ", Width=" << camera->get_height();
         glutSetWindowTitle(ss.str().c_str());
     }
@@ -540,27 +555,30 @@ void onTick()
         if(angle_constraint) {
             end_effector_euler = glm::vec3(0, -1, 0);
         }
-        ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_meshes[0],
-                                                      glm::vec3(0, 0, IK_SEGMENT_LENGTH),
-                                                      tray_handles[4]->in_abs_system(),
-                                                      angle_constraint ? &end_effector_euler : NULL,
-                                                      IK_ITERS,
-                                                      ACCEPT_END_EFFECTOR_DISTANCE,
-                                                      ACCEPT_AVG_ANGLE_DISTANCE);
-        ik_meshes2[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_meshes2[0],
-                                                       glm::vec3(0, 0, IK_SEGMENT_LENGTH),
-                                                       tray_handles[3]->in_abs_system(),
-                                                       angle_constraint ? &end_effector_euler : NULL,
-                                                       IK_ITERS,
-                                                       ACCEPT_END_EFFECTOR_DISTANCE,
-                                                       ACCEPT_AVG_ANGLE_DISTANCE);
-        ik_meshes3[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_meshes3[0],
-                                                       glm::vec3(0, 0, IK_SEGMENT_LENGTH),
-                                                       tray_handles[1]->in_abs_system(),
-                                                       angle_constraint ? &end_effector_euler : NULL,
-                                                       IK_ITERS,
-                                                       ACCEPT_END_EFFECTOR_DISTANCE,
-                                                       ACCEPT_AVG_ANGLE_DISTANCE);
+        ik_session->solve(ik_meshes[IK_SEGMENT_COUNT - 1],
+                          ik_type,
+                          ik_meshes[0],
+                          glm::vec3(0, 0, IK_SEGMENT_LENGTH),
+                          tray_handles[4]->in_abs_system(),
+                          angle_constraint ? &end_effector_euler : NULL,
+                          ACCEPT_END_EFFECTOR_DISTANCE,
+                          ACCEPT_AVG_ANGLE_DISTANCE);
+        ik_session->solve(ik_meshes2[IK_SEGMENT_COUNT - 1],
+                          ik_type,
+                          ik_meshes2[0],
+                          glm::vec3(0, 0, IK_SEGMENT_LENGTH),
+                          tray_handles[3]->in_abs_system(),
+                          angle_constraint ? &end_effector_euler : NULL,
+                          ACCEPT_END_EFFECTOR_DISTANCE,
+                          ACCEPT_AVG_ANGLE_DISTANCE);
+        ik_session->solve(ik_meshes3[IK_SEGMENT_COUNT - 1],
+                          ik_type,
+                          ik_meshes3[0],
+                          glm::vec3(0, 0, IK_SEGMENT_LENGTH),
+                          tray_handles[1]->in_abs_system(),
+                          angle_constraint ? &end_effector_euler : NULL,
+                          ACCEPT_END_EFFECTOR_DISTANCE,
+                          ACCEPT_AVG_ANGLE_DISTANCE);
         user_input = false;
     }
     static int angle = 0;
@@ -631,6 +649,11 @@ void onKeyboard(unsigned char key, int x, int y)
         case 'h': // help
             show_help = !show_help;
             break;
+        case 'i': // ik solver
+            ik_type = static_cast<vt::TransformObject::ik_type_t>((ik_type + 1) % vt::TransformObject::IK_TYPE_COUNT);
+            std::cout << "IK solver: " << ik_type_names[ik_type] << std::endl;
+            user_input = true;
+            break;
         case 'l': // lights
             show_lights = !show_lights;
             break;
@@ -356,7 +356,6 @@ void onSpecial(int key, int x, int y)
             break;
         case GLUT_KEY_HOME:
             dummy->set_euler(glm::vec3(0));
-            dummy->get_transform(true); // TODO: why is this necessary?
             user_input = true;
             break;
         case GLUT_KEY_LEFT:
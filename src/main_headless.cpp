@@ -0,0 +1,217 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glm/glm.hpp>
+
+#include <Simulation.h>
+#include <BoidSimulation.h>
+#include <NBodySimulation.h>
+#include <Trajectory.h>
+#include <Util.h>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <new>
+
+#ifndef BOID_COUNT
+    #define BOID_COUNT 80
+#endif
+#ifndef STEP_COUNT
+    #define STEP_COUNT 1000
+#endif
+#define RANDOM_SEED 0
+
+#define BOID_INIT_SCATTER_MAX glm::vec3(5)
+#define BOID_INIT_SCATTER_MIN glm::vec3(-5)
+
+#define OBSTACLE_COUNT            4
+#define OBSTACLE_DIM_MAX          glm::vec3(10, 0.1, 10)
+#define OBSTACLE_DIM_MIN          glm::vec3(5, 0.1, 5)
+#define OBSTACLE_INIT_SCATTER_MAX glm::vec3(5)
+#define OBSTACLE_INIT_SCATTER_MIN glm::vec3(-5)
+
+#define OCTREE_ORIGIN glm::vec3(-5)
+#define OCTREE_DIM    glm::vec3(10)
+
+// every heap allocation in the process goes through here -- steady-state steps should add none
+static std::atomic<unsigned long> heap_allocation_count(0);
+
+void* operator new(size_t size)
+{
+    heap_allocation_count++;
+    void* ptr = malloc(size ? size : 1);
+    if(!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+static float rand_unit()
+{
+    return static_cast<float>(rand()) / RAND_MAX;
+}
+
+static vt::Simulation* create_boid_simulation(int agent_count, float dt)
+{
+    vt::BoidSimulation* simulation = new vt::BoidSimulation(OCTREE_ORIGIN, OCTREE_DIM, vt::BoidParams(), dt);
+    for(int i = 0; i < agent_count; i++) {
+        simulation->add_agent(glm::vec3(0), glm::vec3(0), 0);
+    }
+    simulation->randomize_agents(BOID_INIT_SCATTER_MIN, BOID_INIT_SCATTER_MAX);
+    for(int i = 0; i < OBSTACLE_COUNT; i++) {
+        glm::vec3 dim = MIX(OBSTACLE_DIM_MIN, OBSTACLE_DIM_MAX, glm::vec3(rand_unit(), rand_unit(), rand_unit()));
+        glm::vec3 origin = MIX(OBSTACLE_INIT_SCATTER_MIN, OBSTACLE_INIT_SCATTER_MAX, glm::vec3(rand_unit(), rand_unit(), rand_unit()));
+        glm::vec3 euler(-180 + rand_unit() * 360,
+                        -90  + rand_unit() * 90,
+                        -180 + rand_unit() * 360);
+        simulation->add_obstacle(origin, euler, -dim * 0.5f, dim * 0.5f);
+    }
+    simulation->set_target(glm::vec3(2.5));
+    return simulation;
+}
+
+static vt::Simulation* create_nbody_simulation(int agent_count, float dt, float theta)
+{
+    vt::NBodyParams params;
+    if(theta < 0) {
+        params.m_gravity_model = vt::GRAVITY_MODEL_NEAREST_NEIGHBORS;
+    } else {
+        params.m_theta = theta;
+    }
+    vt::NBodySimulation* simulation = new vt::NBodySimulation(OCTREE_ORIGIN, OCTREE_DIM, params, dt);
+    for(int i = 0; i < agent_count; i++) {
+        simulation->add_agent(glm::vec3(0), glm::vec3(0));
+    }
+    simulation->randomize_agents(BOID_INIT_SCATTER_MIN, BOID_INIT_SCATTER_MAX);
+    return simulation;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2 || (strcmp(argv[1], "boids") && strcmp(argv[1], "nbody"))) {
+        fprintf(stderr, "usage: %s boids|nbody [agent_count] [step_count] [dt] [theta (nbody only, < 0 for nearest neighbors)] [thread_count (0 for all)] [trajectory_filename]\n", argv[0]);
+        return 1;
+    }
+    int   agent_count  = (argc > 2) ? atoi(argv[2]) : BOID_COUNT;
+    int   step_count   = (argc > 3) ? atoi(argv[3]) : STEP_COUNT;
+    float dt           = (argc > 4) ? atof(argv[4]) : SIMULATION_TICK_DT;
+    float theta        = (argc > 5) ? atof(argv[5]) : vt::NBodyParams().m_theta;
+    int   thread_count = (argc > 6) ? atoi(argv[6]) : 1;
+    const char* trajectory_filename = (argc > 7) ? argv[7] : NULL;
+    if(agent_count <= 0 || step_count <= 0 || dt <= 0 || thread_count < 0) {
+        fprintf(stderr, "Error: agent_count, step_count and dt must be positive, thread_count must not be negative\n");
+        return 1;
+    }
+
+    srand(RANDOM_SEED);
+    vt::Simulation* simulation = !strcmp(argv[1], "boids") ? create_boid_simulation(agent_count, dt)
+                                                           : create_nbody_simulation(agent_count, dt, theta);
+    simulation->set_thread_count(thread_count);
+
+    vt::TrajectoryWriter trajectory_writer;
+    if(trajectory_filename && !trajectory_writer.open(trajectory_filename, agent_count, vt::TRAJECTORY_MODE_DELTA, dt)) {
+        fprintf(stderr, "Error: cannot write %s\n", trajectory_filename);
+        delete simulation;
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    unsigned long warm_heap_allocation_count = 0;
+    double        record_time                = 0;
+    for(int i = 0; i < step_count; i++) {
+        simulation->step(dt);
+        if(trajectory_writer.is_open()) {
+            std::chrono::steady_clock::time_point record_start_time = std::chrono::steady_clock::now();
+            trajectory_writer.write_frame(simulation);
+            record_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - record_start_time).count();
+        }
+        if(!i) {
+            warm_heap_allocation_count = heap_allocation_count; // first step sizes every buffer
+        }
+    }
+    unsigned long steady_heap_allocation_count = heap_allocation_count - warm_heap_allocation_count;
+    std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+    double elapsed_time = std::chrono::duration<double>(end_time - start_time).count();
+
+    printf("%s: agents=%d, steps=%d, dt=%g, threads=%d, elapsed=%.3fs, %.2f steps/sec, %.0f agent-steps/sec\n",
+           argv[1],
+           agent_count,
+           step_count,
+           dt,
+           simulation->get_thread_count(),
+           elapsed_time,
+           step_count / elapsed_time,
+           static_cast<double>(agent_count) * step_count / elapsed_time);
+
+    // identical for any thread count -- handy for checking determinism
+    glm::vec3 checksum(0);
+    for(int i = 0; i < static_cast<int>(simulation->get_agent_count()); i++) {
+        checksum += simulation->get_agent_origin(i);
+    }
+    printf("checksum: %.9g %.9g %.9g\n", checksum.x, checksum.y, checksum.z);
+    printf("heap allocations after first step: %lu (%.2f per step)\n",
+           steady_heap_allocation_count,
+           (step_count > 1) ? static_cast<double>(steady_heap_allocation_count) / (step_count - 1) : 0);
+    if(vt::BoidSimulation* boid_simulation = dynamic_cast<vt::BoidSimulation*>(simulation)) {
+        printf("polarization: %.9g, flocking: %d, avoiding obstacles: %d, collisions: %d\n",
+               boid_simulation->get_polarization(),
+               boid_simulation->get_behavior_count(vt::BoidStore::BOID_BEHAVIOR_FLOCKING),
+               boid_simulation->get_behavior_count(vt::BoidStore::BOID_BEHAVIOR_AVOID_OBSTACLE),
+               boid_simulation->get_collision_count());
+    }
+    if(vt::NBodySimulation* nbody_simulation = dynamic_cast<vt::NBodySimulation*>(simulation)) {
+        printf("kinetic energy: %.9g\n", nbody_simulation->get_kinetic_energy());
+    }
+
+    // read the last frame back -- should match the checksum to within quantization
+    if(trajectory_writer.is_open()) {
+        size_t   frame_count = trajectory_writer.get_frame_count();
+        uint64_t byte_count  = trajectory_writer.get_byte_count();
+        if(!trajectory_writer.close()) {
+            fprintf(stderr, "Error: cannot write %s\n", trajectory_filename);
+            delete simulation;
+            return 1;
+        }
+        printf("trajectory: %s, frames=%lu, %.1f bytes/agent-frame, recording=%.2f%% of step time\n",
+               trajectory_filename,
+               static_cast<unsigned long>(frame_count),
+               static_cast<double>(byte_count) / (static_cast<double>(agent_count) * frame_count),
+               100 * record_time / (elapsed_time - record_time));
+        vt::TrajectoryReader trajectory_reader;
+        if(trajectory_reader.open(trajectory_filename) && trajectory_reader.seek(trajectory_reader.get_frame_count() - 1)) {
+            glm::vec3 replay_checksum(0);
+            for(int i = 0; i < trajectory_reader.get_object_count(); i++) {
+                replay_checksum += trajectory_reader.get_origin(i);
+            }
+            printf("replay checksum: %.9g %.9g %.9g\n", replay_checksum.x, replay_checksum.y, replay_checksum.z);
+        } else {
+            fprintf(stderr, "Error: cannot read %s\n", trajectory_filename);
+        }
+    }
+
+    delete simulation;
+    return 0;
+}
@@ -41,6 +41,7 @@
 #include <Camera.h>
 #include <File3ds.h>
 #include <FrameBuffer.h>
+#include <IKScheduler.h>
 #include <KeyframeMgr.h>
 #include <Light.h>
 #include <Material.h>
@@ -137,6 +138,7 @@ struct IK_Leg
 };
 
 std::vector<IK_Leg*> ik_legs;
+vt::IKScheduler* ik_scheduler = NULL;
 
 static void create_linked_segments(vt::Scene*              scene,
                                    std::vector<vt::Mesh*>* ik_meshes,
@@ -269,6 +271,7 @@ int init_resources()
         ik_legs.push_back(ik_leg);
         angle += (360 / IK_LEG_COUNT);
     }
+    ik_scheduler = new vt::IKScheduler();
 
     long object_id = 0;
     vt::KeyframeMgr::instance()->insert_keyframe(object_id, vt::MotionTrack::MOTION_TYPE_ORIGIN, 0,   new vt::Keyframe(glm::vec3( PATH_RADIUS, PATH_LOW_HEIGHT,   PATH_RADIUS), true));
@@ -287,6 +290,9 @@ int init_resources()
 
 int deinit_resources()
 {
+    if(ik_scheduler) {
+        delete ik_scheduler;
+    }
     return 1;
 }
 
@@ -369,16 +375,20 @@ void onTick()
     body->get_transform(); // ensure transform is updated
     target_index = (target_index + 1) % origin_frame_values.size();
     if(user_input) {
+        ik_scheduler->clear();
         for(std::vector<IK_Leg*>::iterator r = ik_legs.begin(); r != ik_legs.end(); ++r) {
             std::vector<vt::Mesh*> &ik_meshes = (*r)->m_ik_meshes;
-            ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd((*r)->m_joint,
-                                                          glm::vec3(0, 0, IK_SEGMENT_LENGTH),
-                                                          (*r)->m_target,
-                                                          NULL,
-                                                          IK_ITERS,
-                                                          ACCEPT_END_EFFECTOR_DISTANCE,
-                                                          ACCEPT_AVG_ANGLE_DISTANCE);
+            ik_scheduler->add_chain(ik_meshes[IK_SEGMENT_COUNT - 1],
+                                    vt::TransformObject::IK_TYPE_ANALYTIC,
+                                    (*r)->m_joint,
+                                    glm::vec3(0, 0, IK_SEGMENT_LENGTH),
+                                    (*r)->m_target,
+                                    NULL,
+                                    IK_ITERS,
+                                    ACCEPT_END_EFFECTOR_DISTANCE,
+                                    ACCEPT_AVG_ANGLE_DISTANCE);
         }
+        ik_scheduler->solve(); // legs share only the body, so they solve concurrently
         user_input = false;
     }
     static int angle = 0;
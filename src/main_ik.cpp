@@ -114,6 +114,9 @@ bool show_bbox        = false,
 
 bool angle_constraint = false;
 
+vt::TransformObject::ik_type_t ik_type = vt::TransformObject::IK_TYPE_CCD;
+const char* ik_type_names[] = {"ccd", "fabrik", "jacobian", "analytic"};
+
 float prev_zoom         = 0,
       zoom              = 1,
       ortho_dolly_speed = 0.1;
@@ -270,7 +273,10 @@ void onTick()
         ss << std::setprecision(2) << std::fixed << fps << " FPS, "
             << "Mouse: {" << mouse_drag.x << ", " << mouse_drag.y << "}, "
             << "Yaw=" << EULER_YAW(euler) << ", Pitch=" << EULER_PITCH(euler) << ", Radius=" << orbit_radius << ", "
-            << "Zoom=" << zoom;
+            << "Zoom=" << zoom << ", "
+            << "IK=" << ik_type_names[ik_type] << ", "
+            << "Iters=" << ik_meshes[IK_SEGMENT_COUNT - 1]->m_debug_ik_iters << ", "
+            << "Residual=" << ik_meshes[IK_SEGMENT_COUNT - 1]->m_debug_ik_residual;
         //ss << "Width=" << camera->get_width() << ", Width=" << camera->get_height();
         glutSetWindowTitle(ss.str().c_str());
     }
@@ -311,13 +317,14 @@ void onTick()
                 end_effector_euler = glm::vec3(0, -1, 0);
             }
         }
-        ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_meshes[1],
-                                                      glm::vec3(0, 0, IK_SEGMENT_LENGTH),
-                                                      targets[target_index],
-                                                      angle_constraint ? &end_effector_euler : NULL,
-                                                      IK_ITERS,
-                                                      ACCEPT_END_EFFECTOR_DISTANCE,
-                                                      ACCEPT_AVG_ANGLE_DISTANCE);
+        ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik(ik_type,
+                                                  ik_meshes[1],
+                                                  glm::vec3(0, 0, IK_SEGMENT_LENGTH),
+                                                  targets[target_index],
+                                                  angle_constraint ? &end_effector_euler : NULL,
+                                                  IK_ITERS,
+                                                  ACCEPT_END_EFFECTOR_DISTANCE,
+                                                  ACCEPT_AVG_ANGLE_DISTANCE);
         user_input = false;
     }
     static int angle = 0;
@@ -374,6 +381,11 @@ void onKeyboard(unsigned char key, int x, int y)
         case 'h': // help
             show_help = !show_help;
             break;
+        case 'i': // ik solver
+            ik_type = static_cast<vt::TransformObject::ik_type_t>((ik_type + 1) % vt::TransformObject::IK_TYPE_COUNT);
+            std::cout << "IK solver: " << ik_type_names[ik_type] << std::endl;
+            user_input = true;
+            break;
         case 'l': // lights
             show_lights = !show_lights;
             break;
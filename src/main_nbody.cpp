@@ -43,15 +43,18 @@
 #include <Octree.h>
 #include <File3ds.h>
 #include <FrameBuffer.h>
+#include <InstancedMesh.h>
 #include <Light.h>
 #include <Material.h>
 #include <Mesh.h>
 #include <Modifiers.h>
+#include <NBodySimulation.h>
 #include <Octree.h>
 #include <PrimitiveFactory.h>
 #include <Program.h>
 #include <Scene.h>
 #include <Shader.h>
+#include <Simulation.h>
 #include <ShaderContext.h>
 #include <Texture.h>
 #include <Util.h>
@@ -67,6 +70,8 @@
 
 #define BOID_NEAREST_NEIGHBOR_RADIUS 10
 
+#define SIMULATION_THREAD_COUNT 0 // 0 -- one per hardware thread
+
 #define BOID_COUNT            100
 #define BOID_DIM              glm::vec3(0.0625, 0.0625, 0.0625)
 #define BOID_INIT_SCATTER_MAX glm::vec3(5)
@@ -80,6 +85,8 @@
 #define OCTREE_DIM                  glm::vec3(10)
 
 #define GRAVITATIONAL_CONSTANT 0.00001f
+#define BARNES_HUT_THETA       0.5f
+#define BARNES_HUT_SOFTENING   0.05f
 
 #define HEATMAP_NEAR_DIST 0
 #define HEATMAP_FAR_DIST  5
@@ -92,8 +99,10 @@ int init_screen_width  = 800,
     init_screen_height = 600;
 vt::Camera  *camera         = NULL;
 vt::Octree  *octree         = NULL;
+vt::NBodySimulation* nbody_simulation = NULL;
 vt::Mesh    *mesh_skybox    = NULL,
             *box            = NULL;
+vt::InstancedMesh* boid_mesh = NULL; // one draw call for all bodies
 vt::Light   *light          = NULL,
             *light2         = NULL,
             *light3         = NULL;
@@ -138,52 +147,38 @@ int angle_delta = 1;
 int target_index = 7;
 glm::vec3 targets[8];
 
-std::vector<vt::Mesh*> boid_meshes;
-glm::vec3 boid_origin[BOID_COUNT];
-glm::vec3 boid_velocity[BOID_COUNT];
-
-static void randomize_boids(std::vector<vt::Mesh*>* meshes,
-                            glm::vec3               scatter_min,
-                            glm::vec3               scatter_max)
+static void randomize_boids(vt::NBodySimulation* nbody_simulation,
+                            glm::vec3            scatter_min,
+                            glm::vec3            scatter_max)
 {
-    size_t boid_count = meshes->size();
-    for(int i = 0; i < static_cast<int>(boid_count); i++) {
-        glm::vec3 rand_vec(static_cast<float>(rand()) / RAND_MAX,
-                           static_cast<float>(rand()) / RAND_MAX,
-                           static_cast<float>(rand()) / RAND_MAX);
-        boid_origin[i] = MIX(scatter_min, scatter_max, rand_vec);
-        glm::vec3 rand_vec2(static_cast<float>(rand()) / RAND_MAX,
-                            static_cast<float>(rand()) / RAND_MAX,
-                            static_cast<float>(rand()) / RAND_MAX);
-        boid_velocity[i] = MIX(glm::vec3(-BOID_FORWARD_SPEED_MAX), glm::vec3(BOID_FORWARD_SPEED_MAX), rand_vec2);
-    }
+    nbody_simulation->randomize_agents(scatter_min,
+                                       scatter_max);
 }
 
-static void create_boids(vt::Scene*              scene,
-                         std::vector<vt::Mesh*>* boid_meshes,
-                         int                     boid_count,
-                         glm::vec3               scatter_min,
-                         glm::vec3               scatter_max,
-                         glm::vec3               box_dim,
-                         std::string             name)
+static void create_boids(vt::Scene*           scene,
+                         vt::NBodySimulation* nbody_simulation,
+                         int                  boid_count,
+                         glm::vec3            scatter_min,
+                         glm::vec3            scatter_max,
+                         glm::vec3            box_dim,
+                         std::string          name)
 {
-    if(!scene || !boid_meshes) {
+    if(!scene || !nbody_simulation) {
         return;
     }
     srand(time(NULL));
+    vt::Mesh* mesh = vt::PrimitiveFactory::create_tetrahedron(name);
+    mesh->center_axis();
+    mesh->set_scale(box_dim);
+    mesh->flatten();
+    mesh->center_axis();
+    boid_mesh = new vt::InstancedMesh(name, mesh, boid_count);
+    delete mesh;
+    scene->add_mesh(boid_mesh);
     for(int i = 0; i < boid_count; i++) {
-        std::stringstream ss;
-        ss << i;
-        //ss << name << "_" << i;
-        vt::Mesh* mesh = vt::PrimitiveFactory::create_tetrahedron(ss.str());
-        mesh->center_axis();
-        mesh->set_scale(box_dim);
-        mesh->flatten();
-        mesh->center_axis();
-        scene->add_mesh(mesh);
-        boid_meshes->push_back(mesh);
+        nbody_simulation->add_agent(glm::vec3(0), glm::vec3(0));
     }
-    randomize_boids(boid_meshes,
+    randomize_boids(nbody_simulation,
                     scatter_min,
                     scatter_max);
 }
@@ -215,11 +210,48 @@ static glm::vec3 lerp_heatmap(float value,
     return heatmap_colors[heatmap_color_last_index];
 }
 
+// rendering follows the simulation, never the other way around
+class NBodyMeshObserver : public vt::SimulationObserver
+{
+public:
+    void on_step(vt::Simulation* simulation)
+    {
+        vt::NBodySimulation* _nbody_simulation = static_cast<vt::NBodySimulation*>(simulation);
+        if(!boid_mesh) {
+            return;
+        }
+        boid_mesh->m_debug_lines.clear();
+        int n = boid_mesh->get_instance_count();
+        for(int index = 0; index < n; index++) {
+            glm::vec3 self_object_pos = _nbody_simulation->get_agent_origin(index);
+            boid_mesh->set_instance_transform(index, self_object_pos, _nbody_simulation->get_agent_orientation(index));
+            if(show_guide_wires) {
+                m_nearest_k_indices.clear();
+                _nbody_simulation->find_neighbors(index, &m_nearest_k_indices);
+                for(std::vector<long>::iterator q = m_nearest_k_indices.begin(); q != m_nearest_k_indices.end(); ++q) {
+                    if(*q == index) { // ignore self
+                        continue;
+                    }
+                    glm::vec3 other_object_pos = _nbody_simulation->get_agent_origin(*q);
+                    float dist = glm::distance(self_object_pos, other_object_pos);
+                    glm::vec3 color = lerp_heatmap(dist, HEATMAP_NEAR_DIST, HEATMAP_FAR_DIST, true);
+                    boid_mesh->m_debug_lines.push_back(std::make_tuple(self_object_pos, other_object_pos, color, 1));
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<long> m_nearest_k_indices;
+};
+
+NBodyMeshObserver nbody_mesh_observer;
+
 int init_resources()
 {
     glm::vec3 target_origin(-2.5, -2.5, -2.5);
     glm::vec3 target_dim(5, 5, 5);
-    vt::PrimitiveFactory::get_box_corners(targets, &target_origin, &target_dim);
+    vt::get_box_corners(targets, &target_origin, &target_dim);
 
     vt::Scene* scene = vt::Scene::instance();
 
@@ -232,6 +264,12 @@ int init_resources()
     scene->add_material(ambient_material);
     scene->set_wireframe_material(ambient_material);
 
+    vt::Material* ambient_instanced_material = new vt::Material("ambient_instanced",
+                                                                "src/shaders/ambient_instanced.v.glsl",
+                                                                "src/shaders/ambient_instanced.f.glsl");
+    scene->add_material(ambient_instanced_material);
+    scene->set_wireframe_instanced_material(ambient_instanced_material);
+
     vt::Material* skybox_material = new vt::Material("skybox",
                                                      "src/shaders/skybox.v.glsl",
                                                      "src/shaders/skybox.f.glsl",
@@ -243,6 +281,11 @@ int init_resources()
                                                     "src/shaders/phong.f.glsl");
     scene->add_material(phong_material);
 
+    vt::Material* phong_instanced_material = new vt::Material("phong_instanced",
+                                                              "src/shaders/phong_instanced.v.glsl",
+                                                              "src/shaders/phong_instanced.f.glsl");
+    scene->add_material(phong_instanced_material);
+
     texture_skybox = new vt::Texture("skybox_texture",
                                      "data/SaintPetersSquare2/posx.png",
                                      "data/SaintPetersSquare2/negx.png",
@@ -256,7 +299,22 @@ int init_resources()
     glm::vec3 origin = glm::vec3(0);
     camera = new vt::Camera("camera", origin + glm::vec3(0, 0, orbit_radius), origin);
     scene->set_camera(camera);
-    octree = new vt::Octree(OCTREE_ORIGIN, OCTREE_DIM);
+    vt::NBodyParams nbody_params;
+#if 1
+    nbody_params.m_gravity_model           = vt::GRAVITY_MODEL_BARNES_HUT;
+    nbody_params.m_theta                   = BARNES_HUT_THETA;
+    nbody_params.m_softening               = BARNES_HUT_SOFTENING;
+#else
+    nbody_params.m_gravity_model           = vt::GRAVITY_MODEL_NEAREST_NEIGHBORS;
+#endif
+    nbody_params.m_nearest_neighbor_radius = BOID_NEAREST_NEIGHBOR_RADIUS;
+    nbody_params.m_nearest_neighbor_count  = BOID_NEAREST_NEIGHBOR_COUNT;
+    nbody_params.m_forward_speed_max       = BOID_FORWARD_SPEED_MAX;
+    nbody_params.m_gravitational_constant  = GRAVITATIONAL_CONSTANT;
+    nbody_simulation = new vt::NBodySimulation(OCTREE_ORIGIN, OCTREE_DIM, nbody_params);
+    nbody_simulation->set_thread_count(SIMULATION_THREAD_COUNT);
+    nbody_simulation->add_observer(&nbody_mesh_observer);
+    octree = nbody_simulation->get_octree();
     scene->set_octree(octree);
     box = vt::PrimitiveFactory::create_box("octree", OCTREE_DIM.x, OCTREE_DIM.y, OCTREE_DIM.z);
     box->center_axis();
@@ -274,19 +332,15 @@ int init_resources()
     mesh_skybox->set_color_texture_index(mesh_skybox->get_material()->get_texture_index_by_name("skybox_texture"));
 
     create_boids(scene,
-                 &boid_meshes,
+                 nbody_simulation,
                  BOID_COUNT,
                  BOID_INIT_SCATTER_MIN,
                  BOID_INIT_SCATTER_MAX,
                  BOID_DIM,
                  "boid");
-    long index = 0;
-    for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-        (*p)->set_material(phong_material);
-        (*p)->set_ambient_color(glm::vec3(0));
-        octree->insert(index, (*p)->get_origin());
-        index++;
-    }
+    boid_mesh->set_material(phong_instanced_material);
+    boid_mesh->set_ambient_color(glm::vec3(0));
+    nbody_mesh_observer.on_step(nbody_simulation);
 
     scene->m_debug_targets.push_back(std::make_tuple(targets[target_index], glm::vec3(1, 0, 1), 1, 1));
 
@@ -295,6 +349,10 @@ int init_resources()
 
 int deinit_resources()
 {
+    if(nbody_simulation) {
+        vt::Scene::instance()->set_octree(NULL);
+        delete nbody_simulation;
+    }
     return 1;
 }
 
@@ -306,6 +364,7 @@ void onIdle()
 void onTick()
 {
     static unsigned int prev_tick = 0;
+    static unsigned int prev_sim_tick = 0;
     static unsigned int frames = 0;
     unsigned int tick = glutGet(GLUT_ELAPSED_TIME);
     unsigned int delta_time = tick - prev_tick;
@@ -326,79 +385,12 @@ void onTick()
     }
     frames++;
     if(!do_animation) {
+        prev_sim_tick = tick;
         return;
     }
 
-    // clear
-    //octree->clear();
-
-    long index = 0;
-    for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-        vt::Mesh* self_object = *p;
-
-        // keep boids in octree
-        boid_origin[index] = box->wrap(boid_origin[index]);
-        glm::vec3 self_object_pos = boid_origin[index];
-        self_object->set_origin(self_object_pos);
-
-        // add/update
-        if(octree->exists(index)) {
-            octree->move(index, self_object_pos);
-        } else {
-            octree->insert(index, self_object_pos);
-        }
-        index++;
-    }
-
-    // rebalance
-    octree->rebalance();
-
-    long index2 = 0;
-    for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-        vt::Mesh* self_object     = *p;
-        glm::vec3 self_object_pos = self_object->get_origin();
-
-        self_object->m_debug_lines.clear();
-
-        // flocking behavior
-        std::vector<long> nearest_k_indices;
-        if(octree->find(self_object_pos,
-                        BOID_NEAREST_NEIGHBOR_COUNT,
-                        &nearest_k_indices,
-                        BOID_NEAREST_NEIGHBOR_RADIUS))
-        {
-            glm::vec3 group_centroid(0);
-            for(std::vector<long>::iterator q = nearest_k_indices.begin(); q != nearest_k_indices.end(); ++q) {
-                if(*q == index2) { // ignore self
-                    continue;
-                }
-                vt::Mesh* other_object     = boid_meshes[*q];
-                glm::vec3 other_object_pos = other_object->get_origin();
-
-                // collect stats
-                group_centroid += other_object_pos;
-                float dist = glm::distance(self_object_pos, other_object_pos);
-                glm::vec3 color = lerp_heatmap(dist, HEATMAP_NEAR_DIST, HEATMAP_FAR_DIST, true);
-                self_object->m_debug_lines.push_back(std::make_tuple(self_object_pos, other_object_pos, color, 1));
-            }
-            if(nearest_k_indices.size()) {
-                group_centroid *= (1.0f / nearest_k_indices.size());
-                float mass = nearest_k_indices.size();
-                float dist = glm::distance(group_centroid, self_object_pos);
-                if(dist < EPSILON) {
-                    index2++;
-                    continue;
-                }
-                float force = GRAVITATIONAL_CONSTANT * mass / pow(dist, 2);
-                boid_velocity[index2] += vt::safe_normalize(group_centroid - self_object_pos) * force;
-
-                // apply speed limit
-                boid_velocity[index2] = vt::safe_normalize(boid_velocity[index2]) * std::min(glm::length(boid_velocity[index2]), BOID_FORWARD_SPEED_MAX);
-            }
-        }
-        boid_origin[index2] += boid_velocity[index2];
-        index2++;
-    }
+    nbody_simulation->advance((tick - prev_sim_tick) * 0.001f);
+    prev_sim_tick = tick;
 
     static int angle = 0;
     angle = (angle + angle_delta) % 360;
@@ -464,10 +456,10 @@ void onKeyboard(unsigned char key, int x, int y)
             }
             break;
         case 'r': // reset
-            randomize_boids(&boid_meshes,
+            randomize_boids(nbody_simulation,
                             BOID_INIT_SCATTER_MIN,
                             BOID_INIT_SCATTER_MAX);
-            octree->clear();
+            nbody_mesh_observer.on_step(nbody_simulation);
             break;
         case 's': // paths
             show_paths = !show_paths;
@@ -476,14 +468,10 @@ void onKeyboard(unsigned char key, int x, int y)
             wireframe_mode = !wireframe_mode;
             if(wireframe_mode) {
                 glPolygonMode(GL_FRONT, GL_LINE);
-                for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-                    (*p)->set_ambient_color(glm::vec3(1));
-                }
+                boid_mesh->set_ambient_color(glm::vec3(1));
             } else {
                 glPolygonMode(GL_FRONT, GL_FILL);
-                for(std::vector<vt::Mesh*>::iterator p = boid_meshes.begin(); p != boid_meshes.end(); ++p) {
-                    (*p)->set_ambient_color(glm::vec3(0));
-                }
+                boid_mesh->set_ambient_color(glm::vec3(0));
             }
             break;
         case 'x': // axis
@@ -85,6 +85,8 @@
 
 #define FRAMES_PER_SEGMENT 40
 
+#define AGENT_RADIUS 0.5f
+
 //#define DEBUG 1
 
 const char* DEFAULT_CAPTION = "";
@@ -124,6 +126,7 @@ bool show_bbox        = false,
      wireframe_mode   = false,
      show_guide_wires = true,
      show_paths       = true,
+     shortcut_paths   = true,
      show_axis        = false,
      show_axis_labels = false,
      do_animation     = true,
@@ -144,6 +147,9 @@ int angle_delta = 1;
 int target_index = 7;
 glm::vec3 targets[8];
 
+vt::PRM::sample_type_t sample_type = vt::PRM::SAMPLE_TYPE_UNIFORM;
+const char* sample_type_names[] = {"uniform", "halton", "sobol", "gaussian", "bridge"};
+
 std::vector<vt::Mesh*> obstacle_meshes;
 
 static void randomize_meshes(std::vector<vt::Mesh*>* meshes,
@@ -201,11 +207,11 @@ static void randomize_prm(vt::Scene*              scene,
                           std::vector<vt::Mesh*>* obstacle_meshes)
 {
     prm->clear();
-    prm->randomize_waypoints(n);
-    prm->connect_waypoints(k, radius);
     for(std::vector<vt::Mesh*>::iterator t = obstacle_meshes->begin(); t != obstacle_meshes->end(); ++t) {
-        prm->add_obstacle(*t);
+        prm->add_obstacle(*t); // NOTE: obstacle-biased samplers need obstacles first
     }
+    prm->randomize_waypoints(n, sample_type);
+    prm->connect_waypoints(k, radius);
     prm->prune_edges();
 
     scene->m_debug_targets.clear();
@@ -243,13 +249,18 @@ static void update_target(glm::vec3 target)
     std::get<vt::Scene::DEBUG_TARGET_ORIGIN>(scene->m_debug_targets[1]) = nearest_waypoint->get_origin();
     std::set<int> path_indices;
     std::vector<int> path;
+    std::vector<glm::vec3> path_values;
     if(prm->find_shortest_path(glm::vec3(0), nearest_waypoint->get_origin(), &path) && path.size() > 1) {
+        path_indices.insert(path.begin(), path.end());
+        prm->export_path_values(path, &path_values);
+        if(shortcut_paths) {
+            prm->shortcut_path(&path_values);
+        }
         vt::KeyframeMgr::instance()->clear();
         long object_id = 0;
         int frame = 0;
-        for(std::vector<int>::iterator p = path.begin(); p != path.end(); ++p) {
-            path_indices.insert(*p);
-            vt::KeyframeMgr::instance()->insert_keyframe(object_id, vt::MotionTrack::MOTION_TYPE_ORIGIN, frame, new vt::Keyframe(prm->at(*p)->get_origin(), true));
+        for(std::vector<glm::vec3>::iterator p = path_values.begin(); p != path_values.end(); ++p) {
+            vt::KeyframeMgr::instance()->insert_keyframe(object_id, vt::MotionTrack::MOTION_TYPE_ORIGIN, frame, new vt::Keyframe(*p, true));
             frame += FRAMES_PER_SEGMENT;
         }
         vt::KeyframeMgr::instance()->insert_keyframe(object_id, vt::MotionTrack::MOTION_TYPE_ORIGIN, frame, new vt::Keyframe(targets[target_index], true));
@@ -282,20 +293,25 @@ static void update_target(glm::vec3 target)
         glm::vec3 p2 = prm->at(p2_index)->get_origin();
         scene->m_debug_lines.push_back(std::make_tuple(p1, p2, color, linewidth));
     }
+    if(shortcut_paths) {
+        for(int i = 0; i < static_cast<int>(path_values.size()) - 1; i++) {
+            scene->m_debug_lines.push_back(std::make_tuple(path_values[i], path_values[i + 1], glm::vec3(1, 1, 0), 4));
+        }
+    }
 }
 
 int init_resources()
 {
     glm::vec3 target_origin(-2.5, -2.5, -2.5);
     glm::vec3 target_dim(5, 5, 5);
-    vt::PrimitiveFactory::get_box_corners(targets, &target_origin, &target_dim);
+    vt::get_box_corners(targets, &target_origin, &target_dim);
 
     vt::Scene* scene = vt::Scene::instance();
 
     mesh_skybox = vt::PrimitiveFactory::create_viewport_quad("grid");
     scene->set_skybox(mesh_skybox);
 
-    sphere = vt::PrimitiveFactory::create_sphere("sphere", 16, 16,  0.5);
+    sphere = vt::PrimitiveFactory::create_sphere("sphere", 16, 16,  AGENT_RADIUS);
     scene->add_mesh(sphere);
 
     vt::Material* ambient_material = new vt::Material("ambient",
@@ -370,7 +386,8 @@ int init_resources()
     obstacle_meshes.push_back(box);
 #endif
 
-    prm = new vt::PRM(octree);
+    prm = new vt::PRM(octree, rand());
+    prm->set_agent_radius(AGENT_RADIUS);
     randomize_prm(scene,
                   prm,
                   WAYPOINT_COUNT,
@@ -511,6 +528,10 @@ void onKeyboard(unsigned char key, int x, int y)
         case 'b': // bbox
             show_bbox = !show_bbox;
             break;
+        case 'c': // shortcut paths
+            shortcut_paths = !shortcut_paths;
+            user_input = true;
+            break;
         case 'f': // frame rate
             show_fps = !show_fps;
             if(!show_fps) {
@@ -531,6 +552,17 @@ void onKeyboard(unsigned char key, int x, int y)
         case 'l': // lights
             show_lights = !show_lights;
             break;
+        case 'm': // sample type
+            sample_type = static_cast<vt::PRM::sample_type_t>((sample_type + 1) % vt::PRM::SAMPLE_TYPE_COUNT);
+            std::cout << "Sample type: " << sample_type_names[sample_type] << std::endl;
+            randomize_prm(vt::Scene::instance(),
+                          prm,
+                          WAYPOINT_COUNT,
+                          WAYPOINT_NEAREST_NEIGHBOR_COUNT,
+                          WAYPOINT_NEAREST_NEIGHBOR_RADIUS,
+                          &obstacle_meshes);
+            user_input = true;
+            break;
         case 'n': // normals
             show_normals = !show_normals;
             break;
@@ -41,6 +41,7 @@
 #include <Camera.h>
 #include <File3ds.h>
 #include <FrameBuffer.h>
+#include <IKSession.h>
 #include <KeyframeMgr.h>
 #include <Light.h>
 #include <Material.h>
@@ -69,6 +70,7 @@
 #define IK_BASE_LENGTH               0.5
 #define IK_BASE_WIDTH                0.5
 #define IK_ITERS                     1
+#define IK_MAX_ITERS                 10
 #define IK_RAIL_HEIGHT               0.25
 #define IK_RAIL_LENGTH               5
 #define IK_RAIL_WIDTH                0.125
@@ -126,6 +128,9 @@ bool show_bbox        = false,
 
 bool angle_constraint = false;
 
+vt::TransformObject::ik_type_t ik_type = vt::TransformObject::IK_TYPE_CCD;
+const char* ik_type_names[] = {"ccd", "fabrik", "jacobian", "analytic"};
+
 float prev_zoom         = 0,
       zoom              = 1,
       ortho_dolly_speed = 0.1;
@@ -149,6 +154,7 @@ vt::Mesh *ground         = NULL,
          *ik_base        = NULL;
 
 std::vector<vt::Mesh*> ik_meshes;
+vt::IKSession* ik_session = NULL;
 
 static void create_linked_segments(vt::Scene*              scene,
                                    std::vector<vt::Mesh*>* ik_meshes,
@@ -331,11 +337,16 @@ int init_resources()
 
     onSpecial(GLUT_KEY_HOME, 0, 0);
 
+    ik_session = new vt::IKSession(IK_ITERS, IK_MAX_ITERS);
+
     return 1;
 }
 
 int deinit_resources()
 {
+    if(ik_session) {
+        delete ik_session;
+    }
     return 1;
 }
 
@@ -361,7 +372,11 @@ void onTick()
         ss << std::setprecision(2) << std::fixed << fps << " FPS, "
             << "Mouse: {" << mouse_drag.x << ", " << mouse_drag.y << "}, "
             << "Yaw=" << EULER_YAW(euler) << ", Pitch=" << EULER_PITCH(euler) << ", Radius=" << orbit_radius << ", "
-            << "Zoom=" << zoom;
+            << "Zoom=" << zoom << ", "
+            << "IK=" << ik_type_names[ik_type] << ", "
+            << "Iters=" << ik_meshes[IK_SEGMENT_COUNT - 1]->m_debug_ik_iters << ", "
+            << "Residual=" << ik_meshes[IK_SEGMENT_COUNT - 1]->m_debug_ik_residual << ", "
+            << "Skips=" << ik_session->get_skip_count() << "/" << ik_session->get_skip_count() + ik_session->get_solve_count();
         //ss << "Width=" << camera->get_width() << ", Width=" << camera->get_height();
         glutSetWindowTitle(ss.str().c_str());
     }
@@ -375,14 +390,15 @@ void onTick()
     std::vector<glm::vec3> &origin_frame_values = vt::Scene::instance()->m_debug_object_context[object_id].m_debug_origin_frame_values;
     if(origin_frame_values.size()) {
         static int frame_target_index = 0;
-        ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_hrail,
-                                                      glm::vec3(0, 0, IK_SEGMENT_LENGTH),
-                                                      glm::vec3(vt::Scene::instance()->m_debug_object_context[object_id].m_transform *
-                                                                glm::vec4(origin_frame_values[frame_target_index + 1], 1)),
-                                                      angle_constraint ? &end_effector_dir : NULL,
-                                                      IK_ITERS,
-                                                      ACCEPT_END_EFFECTOR_DISTANCE,
-                                                      ACCEPT_AVG_ANGLE_DISTANCE);
+        ik_session->solve(ik_meshes[IK_SEGMENT_COUNT - 1],
+                          ik_type,
+                          ik_hrail,
+                          glm::vec3(0, 0, IK_SEGMENT_LENGTH),
+                          glm::vec3(vt::Scene::instance()->m_debug_object_context[object_id].m_transform *
+                                    glm::vec4(origin_frame_values[frame_target_index + 1], 1)),
+                          angle_constraint ? &end_effector_dir : NULL,
+                          ACCEPT_END_EFFECTOR_DISTANCE,
+                          ACCEPT_AVG_ANGLE_DISTANCE);
         frame_target_index = (frame_target_index + 1) % (origin_frame_values.size() - 1);
     }
     ik_vrail->set_origin(ik_vrail_dummy->get_origin());
@@ -438,6 +454,10 @@ void onKeyboard(unsigned char key, int x, int y)
         case 'h': // help
             show_help = !show_help;
             break;
+        case 'i': // ik solver
+            ik_type = static_cast<vt::TransformObject::ik_type_t>((ik_type + 1) % vt::TransformObject::IK_TYPE_COUNT);
+            std::cout << "IK solver: " << ik_type_names[ik_type] << std::endl;
+            break;
         case 'l': // lights
             show_lights = !show_lights;
             break;
@@ -43,12 +43,16 @@
 #include <File3ds.h>
 #include <FilePng.h>
 #include <FrameBuffer.h>
+#include <IKBatch.h>
+#include <IKScheduler.h>
+#include <KinematicChain.h>
 #include <Light.h>
 #include <Material.h>
 #include <Mesh.h>
 #include <Modifiers.h>
 #include <PrimitiveFactory.h>
 #include <Program.h>
+#include <ReachabilityMap.h>
 #include <Scene.h>
 #include <Shader.h>
 #include <ShaderContext.h>
@@ -72,10 +76,12 @@
 #define BOX_LENGTH                     0.5
 #define BOX_SPEED                      0.05f
 #define BOX_WIDTH                      0.25
+#define IK_BATCH_ITERS                 20
 #define IK_ITERS                       1
 #define IK_LEG_COUNT                   8
 #define IK_LEG_MAX_LIFT_HEIGHT         (BOX_ELEVATION * 0.5)
 #define IK_LEG_RADIUS                  (BOX_LENGTH * 0.5)
+#define IK_REACH_TOLERANCE             (IK_SEGMENT_LENGTH * 0.1)
 #define IK_SEGMENT_COUNT               3
 #define IK_SEGMENT_HEIGHT              0.05
 #define IK_SEGMENT_LENGTH              0.5
@@ -84,12 +90,20 @@
 #define LEG_OUTER_RADIUS               1
 #define LERP_PARABOLIC_DOWN_ARC(alpha) (-pow((alpha) * 2 - 1, 2) + 1)
 #define MAX_LEG_CORRECTION_SPREAD      (PI * 0.25)
+#define REACH_MAP_FILENAME_PREFIX      "spider_leg_"
+#define REACH_MAP_SAMPLE_COUNT         200000
+#define REACH_MAP_VOXEL_SIZE           0.05
 #define TERRAIN_COLS                   100
 #define TERRAIN_HEIGHT                 1
 #define TERRAIN_LENGTH                 10
 #define TERRAIN_ROWS                   100
 #define TERRAIN_WIDTH                  10
 
+// reach map cache lives with the build outputs -- override with -DREACH_MAP_CACHE_PATH=...
+#ifndef REACH_MAP_CACHE_PATH
+    #define REACH_MAP_CACHE_PATH "build"
+#endif
+
 const char* DEFAULT_CAPTION = "";
 
 int init_screen_width  = 800,
@@ -153,9 +167,12 @@ struct IK_Leg
     glm::vec3              m_from_point;
     glm::vec3              m_to_point;
     float                  m_alpha;
+    vt::ReachabilityMap    m_reachability_map; // in dummy space
+    vt::IKBatch*           m_ik_batch;         // reused by every foothold search
 };
 
 std::vector<IK_Leg*> ik_legs;
+vt::IKScheduler* ik_scheduler = NULL;
 
 static void create_linked_segments(vt::Scene*              scene,
                                    std::vector<vt::Mesh*>* ik_meshes,
@@ -363,14 +380,45 @@ static int find_nearest_target_for_leg(std::vector<glm::vec3> &leg_targets,
                                        IK_Leg                 &ik_leg)
 {
     std::vector<vt::Mesh*> &ik_meshes = ik_leg.m_ik_meshes;
+
+    // reject footholds outside the precomputed workspace in O(1) each
+    std::vector<int> candidate_indices;
+    const glm::mat4 &base_inverse_transform = ik_leg.m_joint->get_parent()->get_inverse_transform();
+    for(std::set<int>::iterator p = available_target_indices.begin(); p != available_target_indices.end(); ++p) {
+        if(ik_leg.m_reachability_map.is_reachable(base_inverse_transform, leg_targets[*p])) {
+            candidate_indices.push_back(*p);
+        }
+    }
+
+    // test remaining candidates for reachability in one batch
+    vt::IKBatch &ik_batch = *ik_leg.m_ik_batch;
+    ik_batch.set_base_transform(ik_leg.m_joint->get_parent()->get_transform());
+    ik_batch.resize(candidate_indices.size());
+    ik_batch.reset_values();
+    int n = 0;
+    for(std::vector<int>::iterator p = candidate_indices.begin(); p != candidate_indices.end(); ++p) {
+        ik_batch.set_target(n++, leg_targets[*p]);
+    }
+    ik_batch.solve(IK_BATCH_ITERS, IK_REACH_TOLERANCE);
+
     float best_distance = LEG_OUTER_RADIUS;
     int   best_index    = -1;
-    for(std::set<int>::iterator p = available_target_indices.begin(); p != available_target_indices.end(); ++p) {
+    bool  best_is_reachable = false;
+    n = 0;
+    for(std::vector<int>::iterator p = candidate_indices.begin(); p != candidate_indices.end(); ++p) {
+        bool is_reachable = ik_batch.is_converged(n++);
+        if(best_is_reachable && !is_reachable) {
+            continue; // reachable targets take precedence
+        }
         float distance = glm::distance(leg_targets[*p], ik_meshes[0]->in_abs_system());
         //float distance = glm::distance(leg_targets[*p], ik_meshes[IK_SEGMENT_COUNT - 1]->in_abs_system(glm::vec3(0, 0, IK_SEGMENT_LENGTH)));
-        if(distance < best_distance) {
-            best_distance = distance;
-            best_index    = *p;
+        if(distance >= LEG_OUTER_RADIUS) {
+            continue;
+        }
+        if(distance < best_distance || (is_reachable && !best_is_reachable)) {
+            best_distance     = distance;
+            best_index        = *p;
+            best_is_reachable = is_reachable;
         }
     }
     return best_index;
@@ -495,9 +543,27 @@ int init_resources()
             }
             leg_segment_index++;
         }
+
+        // workspace map is cached on disk, rebuilt only if leg geometry changed
+        vt::KinematicChain ik_chain;
+        ik_chain.build_from(ik_leg->m_joint, ik_meshes[IK_SEGMENT_COUNT - 1], glm::vec3(0, 0, IK_SEGMENT_LENGTH));
+        std::stringstream reach_map_filename_ss;
+        reach_map_filename_ss << REACH_MAP_CACHE_PATH << "/" << REACH_MAP_FILENAME_PREFIX << i << ".bin";
+        vt::ReachabilityMap &reachability_map = ik_leg->m_reachability_map;
+        if(!reachability_map.load(reach_map_filename_ss.str()) ||
+           reachability_map.get_signature() != vt::ReachabilityMap::get_signature(ik_chain, REACH_MAP_VOXEL_SIZE, REACH_MAP_SAMPLE_COUNT))
+        {
+            reachability_map.build(ik_chain, REACH_MAP_VOXEL_SIZE, REACH_MAP_SAMPLE_COUNT);
+            if(!reachability_map.save(reach_map_filename_ss.str())) {
+                fprintf(stderr, "Warning: cannot write %s, reach map will be rebuilt next run\n", reach_map_filename_ss.str().c_str());
+            }
+        }
+        ik_leg->m_ik_batch = new vt::IKBatch(ik_chain);
+
         ik_legs.push_back(ik_leg);
         angle += (360 / IK_LEG_COUNT);
     }
+    ik_scheduler = new vt::IKScheduler();
 
     scene->m_debug_targets.resize(IK_LEG_COUNT + 1);
     std::get<vt::Scene::DEBUG_TARGET_ORIGIN>(   scene->m_debug_targets[0]) = box->get_origin();
@@ -509,6 +575,12 @@ int init_resources()
 
 int deinit_resources()
 {
+    for(std::vector<IK_Leg*>::iterator p = ik_legs.begin(); p != ik_legs.end(); ++p) {
+        delete (*p)->m_ik_batch;
+    }
+    if(ik_scheduler) {
+        delete ik_scheduler;
+    }
     if(height_map_pixel_data) {
         delete[] height_map_pixel_data;
     }
@@ -655,21 +727,25 @@ void onTick()
         }
         user_input = false;
     }
+    ik_scheduler->clear();
     for(std::vector<IK_Leg*>::iterator r = ik_legs.begin(); r != ik_legs.end(); ++r) {
         std::vector<vt::Mesh*> &ik_meshes = (*r)->m_ik_meshes;
         glm::vec3 interp_point = MIX((*r)->m_from_point, (*r)->m_to_point, (*r)->m_alpha);
         float leg_lift_height = LERP_PARABOLIC_DOWN_ARC((*r)->m_alpha) * IK_LEG_MAX_LIFT_HEIGHT; // parabolic leg-lift path
-        ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd((*r)->m_joint,
-                                                      glm::vec3(0, 0, IK_SEGMENT_LENGTH),
-                                                      interp_point + glm::vec3(0, leg_lift_height, 0),
-                                                      NULL,
-                                                      IK_ITERS,
-                                                      ACCEPT_END_EFFECTOR_DISTANCE,
-                                                      ACCEPT_AVG_ANGLE_DISTANCE);
+        ik_scheduler->add_chain(ik_meshes[IK_SEGMENT_COUNT - 1],
+                                vt::TransformObject::IK_TYPE_ANALYTIC,
+                                (*r)->m_joint,
+                                glm::vec3(0, 0, IK_SEGMENT_LENGTH),
+                                interp_point + glm::vec3(0, leg_lift_height, 0),
+                                NULL,
+                                IK_ITERS,
+                                ACCEPT_END_EFFECTOR_DISTANCE,
+                                ACCEPT_AVG_ANGLE_DISTANCE);
         if((*r)->m_alpha < 1) {
             (*r)->m_alpha += ANIM_ALPHA_STEP;
         }
     }
+    ik_scheduler->solve(); // legs share only the body, so they solve concurrently
     static int angle = 0;
     angle = (angle + angle_delta) % 360;
 }
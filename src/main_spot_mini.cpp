@@ -488,22 +488,24 @@ void onTick()
             IK_Leg* ik_leg = ik_legs[i];
             std::vector<vt::Mesh*> &ik_meshes = ik_leg->m_ik_meshes;
             if(i == 4) { // end-effector
-                ik_meshes[IK_SEGMENT_COUNT + 1 - 1]->solve_ik_ccd(ik_leg->m_joint,
-                                                                  glm::vec3(0, 0, IK_SEGMENT_LENGTH * 0.33),
-                                                                  ik_leg->m_target,
-                                                                  &end_effector_dir,
-                                                                  IK_ITERS,
-                                                                  ACCEPT_END_EFFECTOR_DISTANCE,
-                                                                  ACCEPT_AVG_ANGLE_DISTANCE);
-            } else {
-                std::vector<glm::vec3> &origin_frame_values = vt::Scene::instance()->m_debug_object_context[i].m_debug_origin_frame_values;
-                ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_leg->m_joint,
-                                                              glm::vec3(0, 0, IK_SEGMENT_LENGTH),
-                                                              origin_frame_values[leg_anim_frame[i] % origin_frame_values.size()],
-                                                              NULL,
+                ik_meshes[IK_SEGMENT_COUNT + 1 - 1]->solve_ik(vt::TransformObject::IK_TYPE_ANALYTIC,
+                                                              ik_leg->m_joint,
+                                                              glm::vec3(0, 0, IK_SEGMENT_LENGTH * 0.33),
+                                                              ik_leg->m_target,
+                                                              &end_effector_dir,
                                                               IK_ITERS,
                                                               ACCEPT_END_EFFECTOR_DISTANCE,
                                                               ACCEPT_AVG_ANGLE_DISTANCE);
+            } else {
+                std::vector<glm::vec3> &origin_frame_values = vt::Scene::instance()->m_debug_object_context[i].m_debug_origin_frame_values;
+                ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik(vt::TransformObject::IK_TYPE_ANALYTIC,
+                                                          ik_leg->m_joint,
+                                                          glm::vec3(0, 0, IK_SEGMENT_LENGTH),
+                                                          origin_frame_values[leg_anim_frame[i] % origin_frame_values.size()],
+                                                          NULL,
+                                                          IK_ITERS,
+                                                          ACCEPT_END_EFFECTOR_DISTANCE,
+                                                          ACCEPT_AVG_ANGLE_DISTANCE);
                 leg_anim_frame[i]++;
                 if(leg_anim_frame[i] > leg_anim_frame_range[i].second) {
                     leg_anim_frame[i] = leg_anim_frame_range[i].first;
@@ -46,6 +46,7 @@
 #include <Material.h>
 #include <Mesh.h>
 #include <Modifiers.h>
+#include <ParallelMechanism.h>
 #include <PrimitiveFactory.h>
 #include <Program.h>
 #include <Scene.h>
@@ -140,6 +141,7 @@ struct IK_Leg
 };
 
 std::vector<IK_Leg*> ik_legs;
+vt::StewartPlatform stewart_platform;
 
 static void create_linked_segments(vt::Scene*              scene,
                                    std::vector<vt::Mesh*>* ik_meshes,
@@ -287,6 +289,10 @@ int init_resources()
             leg_segment_index++;
         }
         ik_legs.push_back(ik_leg);
+        stewart_platform.add_leg(ik_leg->m_target,
+                                 ik_leg->m_joint->get_origin(),
+                                 IK_SEGMENT_LENGTH,
+                                 IK_SEGMENT_LENGTH * 2);
     }
 
     long object_id = 0;
@@ -392,6 +398,18 @@ void onTick()
             std::vector<vt::Mesh*> &ik_meshes = (*q)->m_ik_meshes;
             ik_meshes[0]->set_origin((*q)->m_joint->in_abs_system());
         }
+#if 1
+        // closed form -- each actuator points from its platform anchor at its base anchor
+        float lengths[IK_LEG_COUNT];
+        stewart_platform.solve_ik(body->get_transform(), lengths);
+        int leg_index = 0;
+        for(std::vector<IK_Leg*>::iterator r = ik_legs.begin(); r != ik_legs.end(); ++r) {
+            std::vector<vt::Mesh*> &ik_meshes = (*r)->m_ik_meshes;
+            ik_meshes[0]->set_euler(vt::offset_to_euler((*r)->m_target - ik_meshes[0]->get_origin()));
+            ik_meshes[1]->set_origin(glm::vec3(0, 0, lengths[leg_index] - IK_SEGMENT_LENGTH)); // clamped by joint constraints
+            leg_index++;
+        }
+#else
         for(std::vector<IK_Leg*>::iterator r = ik_legs.begin(); r != ik_legs.end(); ++r) {
             std::vector<vt::Mesh*> &ik_meshes = (*r)->m_ik_meshes;
             ik_meshes[IK_SEGMENT_COUNT - 1]->solve_ik_ccd(ik_meshes[0],
@@ -402,6 +420,7 @@ void onTick()
                                                           ACCEPT_END_EFFECTOR_DISTANCE,
                                                           ACCEPT_AVG_ANGLE_DISTANCE);
         }
+#endif
         user_input = false;
     }
     static int angle = 0;
@@ -0,0 +1,44 @@
+// This file is part of dexvt-lite.
+// -- 3D Inverse Kinematics (Cyclic Coordinate Descent) with Constraints
+// Copyright (C) 2018 onlyuser <mailto:onlyuser@gmail.com>
+//
+// dexvt-lite is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// dexvt-lite is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with dexvt-lite.  If not, see <http://www.gnu.org/licenses/>.
+
+
+attribute mat4 instance_transform;
+attribute vec3 instance_color;
+attribute vec3 vertex_normal;
+attribute vec3 vertex_position;
+uniform mat4 model_transform;
+uniform mat4 view_proj_transform;
+uniform vec3 camera_pos;
+varying vec3 lerp_normal;
+varying vec3 lerp_instance_color;
+varying vec3 lerp_camera_vector;
+varying vec3 lerp_position_world;
+
+void main()
+{
+    mat4 instance_model_transform = model_transform * instance_transform;
+
+    // instance transforms are rigid -- no inverse transpose needed for normals
+    lerp_normal = normalize(vec3(instance_model_transform * vec4(vertex_normal, 0)));
+
+    vec3 vertex_position_world = vec3(instance_model_transform * vec4(vertex_position, 1));
+    lerp_position_world = vertex_position_world;
+    lerp_camera_vector = camera_pos - vertex_position_world;
+    lerp_instance_color = instance_color;
+
+    gl_Position = view_proj_transform * vec4(vertex_position_world, 1);
+}